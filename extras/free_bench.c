@@ -0,0 +1,218 @@
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/memoman.h"
+
+#ifndef MM_FREE_BENCH_HAVE_CONTE_TLSF
+#define MM_FREE_BENCH_HAVE_CONTE_TLSF 0
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+** free_bench: p50/p99 latency of a single free, memoman (checked and MM_FLAG_UNCHECKED_FREE) vs Conte's tlsf_free.
+**
+** Every allocator replays the same sequence: fill MM_FREE_BENCH_LIVE blocks of mixed sizes, then free them in a
+** shuffled order so frees hit every coalescing case, timing each call. The allocators take turns for
+** MM_FREE_BENCH_TRIALS trials and each keeps its best p50/p99, which filters out noisy neighbours on shared
+** machines. With Conte TLSF available the exit status gates parity: the unchecked p50 and p99 must be within
+** MM_FREE_BENCH_TOLERANCE_PCT percent (plus MM_FREE_BENCH_SLACK_NS for timer granularity) of Conte's.
+*/
+
+#ifndef MM_FREE_BENCH_POOL_BYTES
+#define MM_FREE_BENCH_POOL_BYTES (8u * 1024u * 1024u)
+#endif
+
+#ifndef MM_FREE_BENCH_LIVE
+#define MM_FREE_BENCH_LIVE 4096u
+#endif
+
+#ifndef MM_FREE_BENCH_ROUNDS
+#define MM_FREE_BENCH_ROUNDS 50u
+#endif
+
+#ifndef MM_FREE_BENCH_TRIALS
+#define MM_FREE_BENCH_TRIALS 5u
+#endif
+
+#ifndef MM_FREE_BENCH_TOLERANCE_PCT
+#define MM_FREE_BENCH_TOLERANCE_PCT 10u
+#endif
+
+#ifndef MM_FREE_BENCH_SLACK_NS
+#define MM_FREE_BENCH_SLACK_NS 5u
+#endif
+
+#define SAMPLE_COUNT ((size_t)MM_FREE_BENCH_LIVE * MM_FREE_BENCH_ROUNDS)
+
+#if MM_FREE_BENCH_HAVE_CONTE_TLSF
+typedef void* conte_tlsf_t;
+#define tlsf_t conte_tlsf_t
+#include "../examples/matt_conte/tlsf.h"
+#undef tlsf_t
+#endif
+
+typedef struct bench_ops_t {
+  const char* name;
+  void* (*create)(void* mem, size_t bytes);
+  void* (*alloc)(void* heap, size_t bytes);
+  void (*release)(void* heap, void* ptr);
+} bench_ops_t;
+
+static void* mm_checked_create(void* mem, size_t bytes) {
+  return mm_create_with_pool(mem, bytes);
+}
+
+static void* mm_unchecked_create(void* mem, size_t bytes) {
+  return mm_create_with_pool_ex(mem, bytes, MM_FLAG_UNCHECKED_FREE);
+}
+
+static void* mm_bench_malloc(void* heap, size_t bytes) {
+  return mm_malloc(heap, bytes);
+}
+
+static void mm_bench_free(void* heap, void* ptr) {
+  mm_free(heap, ptr);
+}
+
+#if MM_FREE_BENCH_HAVE_CONTE_TLSF
+static void* conte_create(void* mem, size_t bytes) {
+  return tlsf_create_with_pool(mem, bytes);
+}
+
+static void* conte_malloc(void* heap, size_t bytes) {
+  return tlsf_malloc(heap, bytes);
+}
+
+static void conte_free(void* heap, void* ptr) {
+  tlsf_free(heap, ptr);
+}
+#endif
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+#if defined(CLOCK_MONOTONIC_RAW)
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t lcg_next(uint32_t* state) {
+  *state = (*state * 1664525u) + 1013904223u;
+  return *state;
+}
+
+static int u64_compare(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+typedef struct bench_result_t {
+  uint64_t p50;
+  uint64_t p99;
+  uint64_t max;
+} bench_result_t;
+
+static int run_bench(const bench_ops_t* ops, void* pool, uint64_t* samples, bench_result_t* out) {
+  static void* ptrs[MM_FREE_BENCH_LIVE];
+  static uint32_t order[MM_FREE_BENCH_LIVE];
+  void* heap = ops->create(pool, MM_FREE_BENCH_POOL_BYTES);
+  if (!heap) return 0;
+
+  uint32_t size_rng = 0x12345678u;
+  uint32_t order_rng = 0x87654321u;
+  size_t n = 0;
+  for (uint32_t round = 0; round < MM_FREE_BENCH_ROUNDS; round++) {
+    for (uint32_t i = 0; i < MM_FREE_BENCH_LIVE; i++) {
+      ptrs[i] = ops->alloc(heap, 16u + lcg_next(&size_rng) % 1024u);
+      if (!ptrs[i]) return 0;
+      order[i] = i;
+    }
+    for (uint32_t i = MM_FREE_BENCH_LIVE - 1u; i > 0; i--) {
+      uint32_t j = lcg_next(&order_rng) % (i + 1u);
+      uint32_t t = order[i];
+      order[i] = order[j];
+      order[j] = t;
+    }
+    for (uint32_t i = 0; i < MM_FREE_BENCH_LIVE; i++) {
+      void* ptr = ptrs[order[i]];
+      uint64_t start = now_ns();
+      ops->release(heap, ptr);
+      samples[n++] = now_ns() - start;
+    }
+  }
+
+  qsort(samples, n, sizeof(samples[0]), u64_compare);
+  out->p50 = samples[n / 2];
+  out->p99 = samples[(n * 99) / 100];
+  out->max = samples[n - 1];
+  return 1;
+}
+
+static int within_parity(uint64_t ours, uint64_t theirs) {
+  return ours <= theirs + (theirs * MM_FREE_BENCH_TOLERANCE_PCT) / 100u + MM_FREE_BENCH_SLACK_NS;
+}
+
+int main(void) {
+  static const bench_ops_t benches[] = {
+    {"memoman mm_free (checked)", mm_checked_create, mm_bench_malloc, mm_bench_free},
+    {"memoman mm_free (unchecked)", mm_unchecked_create, mm_bench_malloc, mm_bench_free},
+#if MM_FREE_BENCH_HAVE_CONTE_TLSF
+    {"conte tlsf_free", conte_create, conte_malloc, conte_free},
+#endif
+  };
+  const size_t count = sizeof(benches) / sizeof(benches[0]);
+  bench_result_t results[3];
+
+  void* pool = aligned_alloc(64, MM_FREE_BENCH_POOL_BYTES);
+  uint64_t* samples = malloc(SAMPLE_COUNT * sizeof(uint64_t));
+  if (!pool || !samples) {
+    perror("malloc");
+    return 1;
+  }
+
+  for (size_t i = 0; i < count; i++) results[i].p50 = results[i].p99 = results[i].max = UINT64_MAX;
+  for (unsigned int trial = 0; trial < MM_FREE_BENCH_TRIALS; trial++) {
+    for (size_t i = 0; i < count; i++) {
+      bench_result_t r;
+      memset(pool, 0, MM_FREE_BENCH_POOL_BYTES);
+      if (!run_bench(&benches[i], pool, samples, &r)) {
+        fprintf(stderr, "%s: setup failed\n", benches[i].name);
+        return 1;
+      }
+      if (r.p50 < results[i].p50) results[i].p50 = r.p50;
+      if (r.p99 < results[i].p99) results[i].p99 = r.p99;
+      if (r.max < results[i].max) results[i].max = r.max;
+    }
+  }
+
+  printf("%-30s %8s %8s %8s\n", "free latency (ns, best trial)", "p50", "p99", "max");
+  for (size_t i = 0; i < count; i++) {
+    printf("%-30s %8llu %8llu %8llu\n", benches[i].name, (unsigned long long)results[i].p50,
+           (unsigned long long)results[i].p99, (unsigned long long)results[i].max);
+  }
+
+  int status = 0;
+#if MM_FREE_BENCH_HAVE_CONTE_TLSF
+  const bench_result_t* ours = &results[1];
+  const bench_result_t* conte = &results[2];
+  int ok = within_parity(ours->p50, conte->p50) && within_parity(ours->p99, conte->p99);
+  printf("parity (unchecked vs conte, +%u%% +%uns): %s\n", MM_FREE_BENCH_TOLERANCE_PCT, MM_FREE_BENCH_SLACK_NS,
+         ok ? "PASS" : "FAIL");
+  status = ok ? 0 : 1;
+#else
+  (void)within_parity;
+  printf("parity: skipped (examples/matt_conte/tlsf.c not available)\n");
+#endif
+
+  free(samples);
+  free(pool);
+  return status;
+}
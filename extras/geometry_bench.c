@@ -0,0 +1,120 @@
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/memoman.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+** geometry_bench: one line of fragmentation and latency numbers for the TLSF geometry this binary was built with
+** (MM_SL_INDEX_COUNT_LOG2, MM_ALIGN_SIZE). `make geometry_bench` builds and runs one binary per variant so the
+** lines can be compared directly.
+*/
+
+#ifndef MM_GEOM_POOL_BYTES
+#define MM_GEOM_POOL_BYTES (64u * 1024u * 1024u)
+#endif
+
+#ifndef MM_GEOM_LIVE
+#define MM_GEOM_LIVE 8192u
+#endif
+
+#ifndef MM_GEOM_OPS
+#define MM_GEOM_OPS 2000000u
+#endif
+
+#ifndef MM_SL_INDEX_COUNT_LOG2
+#define MM_SL_INDEX_COUNT_LOG2 5
+#endif
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_next(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* Mostly small requests with a long tail, like a message/queue workload. */
+static size_t pick_size(uint32_t* state) {
+  uint32_t r = rng_next(state);
+  switch (r & 7u) {
+    case 0: return 1024u + (r >> 8) % 15360u;
+    case 1:
+    case 2: return 128u + (r >> 8) % 896u;
+    default: return 8u + (r >> 8) % 120u;
+  }
+}
+
+int main(void) {
+  void* backing = malloc(MM_GEOM_POOL_BYTES);
+  void** ptrs = calloc(MM_GEOM_LIVE, sizeof(void*));
+  size_t* req = calloc(MM_GEOM_LIVE, sizeof(size_t));
+  if (!backing || !ptrs || !req) {
+    perror("malloc");
+    return 1;
+  }
+  tlsf_t alloc = mm_create_with_pool(backing, MM_GEOM_POOL_BYTES);
+  if (!alloc) {
+    fprintf(stderr, "mm_create_with_pool failed\n");
+    return 1;
+  }
+
+  uint32_t rng = 0x9E3779B9u;
+  size_t requested = 0;
+  size_t failed = 0;
+
+  uint64_t start = now_ns();
+  for (uint32_t op = 0; op < MM_GEOM_OPS; op++) {
+    uint32_t slot = rng_next(&rng) % MM_GEOM_LIVE;
+    if (ptrs[slot]) {
+      mm_free(alloc, ptrs[slot]);
+      requested -= req[slot];
+      ptrs[slot] = NULL;
+    }
+    size_t size = pick_size(&rng);
+    ptrs[slot] = mm_malloc(alloc, size);
+    if (ptrs[slot]) {
+      req[slot] = size;
+      requested += size;
+    } else {
+      failed++;
+    }
+  }
+  uint64_t elapsed = now_ns() - start;
+
+  /* Internal waste: payload handed out beyond what was asked for (class rounding + alignment). */
+  size_t granted = 0;
+  for (uint32_t i = 0; i < MM_GEOM_LIVE; i++) {
+    if (ptrs[i]) granted += mm_block_size(ptrs[i]);
+  }
+
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  double internal = requested ? 100.0 * (double)(granted - requested) / (double)requested : 0.0;
+  /* External fragmentation: share of free memory not usable by one request of the largest free class. */
+  double external = st.bytes_free ? 100.0 * (1.0 - (double)st.largest_free_block / (double)st.bytes_free) : 0.0;
+
+  printf("SL=%2d ALIGN=%2zu | control %5zu B | %6.1f ns/op | internal waste %5.2f%% | external frag %5.2f%% | "
+         "failed %zu\n",
+         1 << MM_SL_INDEX_COUNT_LOG2, mm_align_size(), mm_size(), (double)elapsed / (double)MM_GEOM_OPS, internal,
+         external, failed);
+
+  for (uint32_t i = 0; i < MM_GEOM_LIVE; i++) mm_free(alloc, ptrs[i]);
+  mm_destroy(alloc);
+  free(req);
+  free(ptrs);
+  free(backing);
+  return 0;
+}
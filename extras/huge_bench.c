@@ -0,0 +1,210 @@
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/memoman.h"
+#include "../src/memoman_os.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+** huge_bench: dTLB-sensitive pointer chasing over small nodes, per pool type and placement policy.
+**
+** Each configuration builds one MM_HUGE_BENCH_POOL_BYTES pool, allocates small nodes interleaved with large
+** buffers (MM_HUGE_BENCH_LARGE bytes after every MM_HUGE_BENCH_RUN nodes), links the nodes into one random cycle
+** and times MM_HUGE_BENCH_HOPS dependent loads around it. Pool types: base pages (MADV_NOHUGEPAGE) and
+** `mm_huge_map` (MAP_HUGETLB or THP, whichever the machine grants); placement: default splitting and
+** `MM_FLAG_CLUSTER_SMALL`. dTLB load misses come from perf_event_open when the kernel allows it, "n/a" otherwise.
+*/
+
+#ifndef MM_HUGE_BENCH_POOL_BYTES
+#define MM_HUGE_BENCH_POOL_BYTES ((size_t)256 << 20)
+#endif
+
+#ifndef MM_HUGE_BENCH_LARGE
+#define MM_HUGE_BENCH_LARGE 8192u
+#endif
+
+#ifndef MM_HUGE_BENCH_RUN
+#define MM_HUGE_BENCH_RUN 8u
+#endif
+
+#ifndef MM_HUGE_BENCH_HOPS
+#define MM_HUGE_BENCH_HOPS 20000000u
+#endif
+
+typedef struct node_t {
+  struct node_t* next;
+  uint64_t pad[7];
+} node_t;
+
+/* Keeps the chase loop from being optimized away. */
+static node_t* volatile hop_sink;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_next(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* dTLB read misses for this thread; -1 when perf events are unavailable. */
+static int tlb_counter_open(void) {
+#if defined(__linux__)
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static void tlb_counter_start(int fd) {
+#if defined(__linux__)
+  if (fd < 0) return;
+  ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#else
+  (void)fd;
+#endif
+}
+
+static long long tlb_counter_stop(int fd) {
+#if defined(__linux__)
+  if (fd < 0) return -1;
+  ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  long long count = 0;
+  if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) return -1;
+  return count;
+#else
+  (void)fd;
+  return -1;
+#endif
+}
+
+static const char* backing_name(mm_huge_backing_t backing) {
+  switch (backing) {
+    case MM_HUGE_HUGETLB: return "hugetlb";
+    case MM_HUGE_THP: return "thp";
+    default: return "4k";
+  }
+}
+
+static int run(int huge, unsigned int flags, node_t** nodes, size_t max_nodes, int tlb_fd) {
+  static uint8_t ctrl_mem[64 * 1024] __attribute__((aligned(16)));
+  mm_huge_region_t region;
+  memset(&region, 0, sizeof(region));
+  if (huge) {
+    if (!mm_huge_map(&region, MM_HUGE_BENCH_POOL_BYTES, 0)) return 0;
+  } else {
+    void* p = mmap(NULL, MM_HUGE_BENCH_POOL_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return 0;
+#ifdef MADV_NOHUGEPAGE
+    madvise(p, MM_HUGE_BENCH_POOL_BYTES, MADV_NOHUGEPAGE);
+#endif
+    region.base = p;
+    region.bytes = MM_HUGE_BENCH_POOL_BYTES;
+  }
+
+  tlsf_t alloc = mm_create_ex(ctrl_mem, flags);
+  if (!alloc || !mm_add_pool(alloc, region.base, region.bytes)) {
+    munmap(region.base, region.bytes);
+    return 0;
+  }
+
+  /* Interleave until the pool runs out; large buffers stay live so they keep their place. */
+  size_t count = 0;
+  for (;;) {
+    size_t i;
+    for (i = 0; i < MM_HUGE_BENCH_RUN && count < max_nodes; i++) {
+      node_t* n = (node_t*)mm_malloc(alloc, sizeof(node_t));
+      if (!n) break;
+      nodes[count++] = n;
+    }
+    if (i < MM_HUGE_BENCH_RUN || !mm_malloc(alloc, MM_HUGE_BENCH_LARGE)) break;
+  }
+
+  /* One random cycle through every node (Sattolo's shuffle). */
+  uint32_t rng = 0x2545F491u;
+  for (size_t i = count - 1; i > 0; i--) {
+    size_t j = rng_next(&rng) % i;
+    node_t* t = nodes[i];
+    nodes[i] = nodes[j];
+    nodes[j] = t;
+  }
+  for (size_t i = 0; i < count; i++) nodes[i]->next = nodes[(i + 1) % count];
+
+  uintptr_t lo = UINTPTR_MAX, hi = 0;
+  for (size_t i = 0; i < count; i++) {
+    if ((uintptr_t)nodes[i] < lo) lo = (uintptr_t)nodes[i];
+    if ((uintptr_t)nodes[i] > hi) hi = (uintptr_t)nodes[i];
+  }
+
+  node_t* walk = nodes[0];
+  for (size_t i = 0; i < count; i++) walk = walk->next; /* warm up */
+  tlb_counter_start(tlb_fd);
+  uint64_t start = now_ns();
+  for (uint32_t i = 0; i < MM_HUGE_BENCH_HOPS; i++) walk = walk->next;
+  uint64_t elapsed = now_ns() - start;
+  long long misses = tlb_counter_stop(tlb_fd);
+
+  char miss_text[32];
+  if (misses < 0) snprintf(miss_text, sizeof(miss_text), "n/a");
+  else snprintf(miss_text, sizeof(miss_text), "%.3f", (double)misses / (double)MM_HUGE_BENCH_HOPS);
+  hop_sink = walk;
+  printf("%-8s %-8s | %7zu nodes over %7.1f MiB | %6.2f ns/hop | dTLB misses/hop %s\n",
+         huge ? backing_name(region.backing) : "4k", (flags & MM_FLAG_CLUSTER_SMALL) ? "cluster" : "default", count,
+         (double)(hi - lo) / (1024.0 * 1024.0), (double)elapsed / (double)MM_HUGE_BENCH_HOPS, miss_text);
+
+  mm_destroy(alloc);
+  munmap(region.base, region.bytes);
+  return 1;
+}
+
+int main(void) {
+  size_t max_nodes = MM_HUGE_BENCH_POOL_BYTES / sizeof(node_t);
+  node_t** nodes = (node_t**)malloc(max_nodes * sizeof(node_t*));
+  if (!nodes || mm_size() > 64 * 1024) {
+    fprintf(stderr, "huge_bench: setup failed\n");
+    return 1;
+  }
+  int tlb_fd = tlb_counter_open();
+
+  printf("pool     policy   | %zu MiB pool, %u-byte nodes, %u-byte buffer every %u nodes, %u hops\n",
+         MM_HUGE_BENCH_POOL_BYTES >> 20, (unsigned)sizeof(node_t), MM_HUGE_BENCH_LARGE, MM_HUGE_BENCH_RUN,
+         MM_HUGE_BENCH_HOPS);
+  int ok = 1;
+  for (int huge = 0; huge <= 1; huge++) {
+    ok &= run(huge, 0, nodes, max_nodes, tlb_fd);
+    ok &= run(huge, MM_FLAG_CLUSTER_SMALL, nodes, max_nodes, tlb_fd);
+  }
+  if (tlb_fd >= 0) close(tlb_fd);
+  free(nodes);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "mm_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+** Writer state: the open file plus a pointer -> handle map (open addressing, linear probing, backward-shift
+** deletion so there are no tombstones). The map is sized to stay at most half full.
+*/
+typedef struct mm_trace_slot_t {
+  uintptr_t ptr; /* 0 = empty */
+  uint32_t id;
+} mm_trace_slot_t;
+
+struct mm_trace_writer_t {
+  FILE* file;
+  uint64_t start_ns;
+  uint64_t record_count;
+  uint32_t next_id;
+  int failed;
+  mm_trace_slot_t* slots;
+  size_t slot_mask;
+  size_t live;
+};
+
+#define MM_TRACE_INITIAL_SLOTS 4096u
+
+static uint64_t trace_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static size_t trace_hash(uintptr_t ptr, size_t mask) {
+  uint64_t h = (uint64_t)ptr * 0x9E3779B97F4A7C15ull;
+  return (size_t)(h >> 32) & mask;
+}
+
+static void trace_map_put(mm_trace_slot_t* slots, size_t mask, uintptr_t ptr, uint32_t id) {
+  size_t i = trace_hash(ptr, mask);
+  while (slots[i].ptr && slots[i].ptr != ptr) i = (i + 1) & mask;
+  slots[i].ptr = ptr;
+  slots[i].id = id;
+}
+
+static int trace_map_grow(mm_trace_writer_t* w) {
+  size_t count = (w->slot_mask + 1) * 2;
+  mm_trace_slot_t* slots = calloc(count, sizeof(*slots));
+  if (!slots) return 0;
+  for (size_t i = 0; i <= w->slot_mask; i++) {
+    if (w->slots[i].ptr) trace_map_put(slots, count - 1, w->slots[i].ptr, w->slots[i].id);
+  }
+  free(w->slots);
+  w->slots = slots;
+  w->slot_mask = count - 1;
+  return 1;
+}
+
+static void trace_map_insert(mm_trace_writer_t* w, uintptr_t ptr, uint32_t id) {
+  if ((w->live + 1) * 2 > w->slot_mask + 1 && !trace_map_grow(w)) {
+    w->failed = 1;
+    return;
+  }
+  size_t i = trace_hash(ptr, w->slot_mask);
+  while (w->slots[i].ptr && w->slots[i].ptr != ptr) i = (i + 1) & w->slot_mask;
+  if (!w->slots[i].ptr) w->live++;
+  w->slots[i].ptr = ptr;
+  w->slots[i].id = id;
+}
+
+/* Removes `ptr` and returns its handle, or 0 if it was not live. */
+static uint32_t trace_map_take(mm_trace_writer_t* w, uintptr_t ptr) {
+  size_t mask = w->slot_mask;
+  size_t i = trace_hash(ptr, mask);
+  while (w->slots[i].ptr != ptr) {
+    if (!w->slots[i].ptr) return 0;
+    i = (i + 1) & mask;
+  }
+  uint32_t id = w->slots[i].id;
+  w->live--;
+
+  /* Backward-shift: pull later entries of the probe run into the hole unless they already sit at/after home. */
+  size_t hole = i;
+  for (size_t j = (i + 1) & mask; w->slots[j].ptr; j = (j + 1) & mask) {
+    size_t home = trace_hash(w->slots[j].ptr, mask);
+    if (((j - home) & mask) >= ((j - hole) & mask)) {
+      w->slots[hole] = w->slots[j];
+      hole = j;
+    }
+  }
+  w->slots[hole].ptr = 0;
+  return id;
+}
+
+static void trace_write_header(mm_trace_writer_t* w) {
+  mm_trace_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MM_TRACE_MAGIC, sizeof(MM_TRACE_MAGIC));
+  header.version = MM_TRACE_VERSION;
+  header.record_bytes = (uint32_t)sizeof(mm_trace_record_t);
+  header.record_count = w->record_count;
+  header.id_count = w->next_id;
+  if (fwrite(&header, sizeof(header), 1, w->file) != 1) w->failed = 1;
+}
+
+mm_trace_writer_t* mm_trace_writer_open(const char* path) {
+  mm_trace_writer_t* w = calloc(1, sizeof(*w));
+  if (!w) return NULL;
+  w->slots = calloc(MM_TRACE_INITIAL_SLOTS, sizeof(*w->slots));
+  w->file = path ? fopen(path, "wb") : NULL;
+  if (!w->slots || !w->file) {
+    if (w->file) fclose(w->file);
+    free(w->slots);
+    free(w);
+    return NULL;
+  }
+  w->slot_mask = MM_TRACE_INITIAL_SLOTS - 1;
+  w->next_id = 1;
+  w->start_ns = trace_now_ns();
+  trace_write_header(w);
+  return w;
+}
+
+void mm_trace_writer_hook(void* writer, const mm_trace_event_t* event) {
+  mm_trace_writer_t* w = (mm_trace_writer_t*)writer;
+  if (!w || !event) return;
+
+  mm_trace_record_t rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.time_ns = trace_now_ns() - w->start_ns;
+  rec.op = (uint8_t)event->op;
+  rec.size = event->size;
+  rec.align = (uint32_t)event->align;
+
+  switch (event->op) {
+    case MM_OP_REALLOC:
+      /* realloc(NULL, n) is a malloc and realloc(p, 0) a free; record them as such. */
+      if (!event->ptr) {
+        rec.op = MM_OP_MALLOC;
+      } else if (event->size == 0) {
+        rec.op = MM_OP_FREE;
+        rec.id = trace_map_take(w, (uintptr_t)event->ptr);
+        break;
+      } else {
+        rec.src_id = trace_map_take(w, (uintptr_t)event->ptr);
+        rec.id = rec.src_id;
+        if (!event->result) {
+          /* Failed realloc: the old block is still live. */
+          rec.failed = 1;
+          if (rec.src_id) trace_map_insert(w, (uintptr_t)event->ptr, rec.src_id);
+        } else if (rec.src_id) {
+          trace_map_insert(w, (uintptr_t)event->result, rec.src_id);
+        }
+        break;
+      }
+      /* fall through */
+    case MM_OP_MALLOC:
+    case MM_OP_MEMALIGN:
+      if (event->result) {
+        rec.id = w->next_id++;
+        trace_map_insert(w, (uintptr_t)event->result, rec.id);
+      } else {
+        rec.failed = 1;
+      }
+      break;
+    case MM_OP_FREE:
+      rec.id = trace_map_take(w, (uintptr_t)event->ptr);
+      break;
+    default:
+      return;
+  }
+
+  if (fwrite(&rec, sizeof(rec), 1, w->file) != 1) w->failed = 1;
+  w->record_count++;
+}
+
+int mm_trace_writer_close(mm_trace_writer_t* w) {
+  if (!w) return 0;
+  if (fflush(w->file) != 0) w->failed = 1;
+  /* Patch the counts in; a non-seekable output keeps the zero counts and is loaded by length instead. */
+  if (fseek(w->file, 0, SEEK_SET) == 0) trace_write_header(w);
+  if (fclose(w->file) != 0) w->failed = 1;
+  int ok = !w->failed;
+  free(w->slots);
+  free(w);
+  return ok;
+}
+
+int mm_trace_load(const char* path, mm_trace_t* out) {
+  if (!path || !out) return 0;
+  memset(out, 0, sizeof(*out));
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+
+  mm_trace_header_t header;
+  if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, MM_TRACE_MAGIC, sizeof(MM_TRACE_MAGIC)) != 0 ||
+      header.version != MM_TRACE_VERSION || header.record_bytes != sizeof(mm_trace_record_t)) {
+    fclose(f);
+    return 0;
+  }
+
+  size_t cap = header.record_count ? (size_t)header.record_count : 4096u;
+  mm_trace_record_t* records = malloc(cap * sizeof(*records));
+  size_t count = 0;
+  uint32_t id_count = 1;
+  while (records) {
+    if (count == cap) {
+      mm_trace_record_t* grown = realloc(records, cap * 2 * sizeof(*records));
+      if (!grown) break;
+      records = grown;
+      cap *= 2;
+    }
+    size_t got = fread(records + count, sizeof(*records), cap - count, f);
+    /* Handle ids are recomputed so a truncated trace still gets a correctly sized table. */
+    for (size_t i = count; i < count + got; i++) {
+      if (records[i].id >= id_count) id_count = records[i].id + 1;
+    }
+    count += got;
+    if (count < cap) break;
+  }
+  int ok = records && !ferror(f);
+  fclose(f);
+  if (!ok) {
+    free(records);
+    return 0;
+  }
+
+  out->records = records;
+  out->count = count;
+  out->id_count = id_count;
+  return 1;
+}
+
+void mm_trace_unload(mm_trace_t* trace) {
+  if (!trace) return;
+  free(trace->records);
+  memset(trace, 0, sizeof(*trace));
+}
@@ -0,0 +1,65 @@
+#ifndef MM_TRACE_H
+#define MM_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../src/memoman.h"
+
+/*
+** mm_trace: compact binary allocation traces (writer + loader), replayed by `extras/replay`.
+**
+** File layout (native byte order, fixed-width fields):
+** - mm_trace_header_t: magic "MMTRACE", version, record size, record count and handle count. The writer patches
+**   the counts in when the trace is closed; a truncated trace (count 0) is still loadable up to its last whole
+**   record.
+** - mm_trace_record_t[record_count]: one record per heap operation, in heap order.
+**
+** Pointers are not stored. Each live block gets a handle id (1, 2, ...; 0 means "none") when it is allocated; a
+** successful realloc keeps its source handle, so replay only needs a dense id -> pointer table. Timestamps are
+** nanoseconds since the writer was opened and are informational: replay runs the operations back to back.
+*/
+
+#define MM_TRACE_MAGIC "MMTRACE"
+#define MM_TRACE_VERSION 1u
+
+typedef struct mm_trace_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_bytes;
+  uint64_t record_count;
+  uint64_t id_count; /* highest handle id + 1 */
+} mm_trace_header_t;
+
+typedef struct mm_trace_record_t {
+  uint64_t time_ns;
+  uint64_t size;   /* requested bytes (0 for free) */
+  uint32_t id;     /* handle allocated, resized or freed (0 when the call failed or the pointer was unknown) */
+  uint32_t src_id; /* realloc: handle passed in (0 for realloc(NULL, n)) */
+  uint32_t align;  /* memalign alignment */
+  uint8_t op;      /* mm_op_t */
+  uint8_t failed;  /* the traced call returned NULL */
+  uint16_t reserved;
+} mm_trace_record_t;
+
+typedef struct mm_trace_writer_t mm_trace_writer_t;
+
+/* Returns NULL if the file cannot be created. */
+mm_trace_writer_t* mm_trace_writer_open(const char* path);
+/* Trace hook for `mm_set_trace_hook(alloc, mm_trace_writer_hook, writer)`. Allocates from libc, never from the
+** traced instance. */
+void mm_trace_writer_hook(void* writer, const mm_trace_event_t* event);
+/* Flushes, patches the header and frees the writer. Returns 1 if every record reached the file. */
+int mm_trace_writer_close(mm_trace_writer_t* writer);
+
+typedef struct mm_trace_t {
+  mm_trace_record_t* records;
+  size_t count;
+  uint32_t id_count;
+} mm_trace_t;
+
+/* Loads a whole trace into memory. Returns 1 on success. */
+int mm_trace_load(const char* path, mm_trace_t* out);
+void mm_trace_unload(mm_trace_t* trace);
+
+#endif
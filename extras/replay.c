@@ -0,0 +1,408 @@
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/memoman.h"
+#include "mm_trace.h"
+
+#ifndef MM_REPLAY_HAVE_CONTE_TLSF
+#define MM_REPLAY_HAVE_CONTE_TLSF 0
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+** replay: deterministic replay of an mm_trace file (see mm_trace.h) against memoman, Conte TLSF and libc malloc.
+**
+**   ./extras/bin/replay app.trace [memoman|conte|malloc ...]
+**   ./extras/bin/replay --record out.trace [ops]    (synthetic trace recorded through the memoman trace hook)
+**
+** Every backend runs in its own forked process so heap state and peak RSS do not leak between them. Each replays
+** the trace twice: an untimed pass for throughput and peak footprint, then a pass timing every call for per-op
+** p50/p99/p99.9/max. Peak footprint is the VmHWM growth over the pass (reset through /proc/self/clear_refs), so it
+** counts allocator metadata and every page the allocator touched. Pool allocators get an MM_REPLAY_POOL_MB
+** reservation mapped with MAP_NORESERVE: only touched pages count.
+**
+** Records that failed in the original run are skipped (they did not change the heap); a call that fails during
+** replay is counted and its handle stays unmapped, so later operations on it are skipped too.
+*/
+
+#ifndef MM_REPLAY_POOL_MB
+#define MM_REPLAY_POOL_MB 1024u
+#endif
+
+#ifndef MM_REPLAY_RECORD_OPS
+#define MM_REPLAY_RECORD_OPS 1000000u
+#endif
+
+#ifndef MM_REPLAY_RECORD_LIVE
+#define MM_REPLAY_RECORD_LIVE 4096u
+#endif
+
+typedef struct replay_api_t {
+  const char* name;
+  int (*init_fn)(void* pool, size_t bytes); /* returns nonzero */
+  void (*destroy_fn)(void);
+  void* (*malloc_fn)(size_t size);
+  void (*free_fn)(void* ptr);
+  void* (*realloc_fn)(void* ptr, size_t size);
+  void* (*memalign_fn)(size_t alignment, size_t size);
+  int uses_pool;
+} replay_api_t;
+
+static tlsf_t g_mm;
+
+static int mm_backend_init(void* pool, size_t bytes) {
+  g_mm = mm_create_with_pool(pool, bytes);
+  return g_mm != NULL;
+}
+static void mm_backend_destroy(void) { mm_destroy(g_mm); }
+static void* mm_backend_malloc(size_t size) { return mm_malloc(g_mm, size); }
+static void mm_backend_free(void* ptr) { mm_free(g_mm, ptr); }
+static void* mm_backend_realloc(void* ptr, size_t size) { return mm_realloc(g_mm, ptr, size); }
+static void* mm_backend_memalign(size_t a, size_t size) { return mm_memalign(g_mm, a, size); }
+
+static int sys_backend_init(void* pool, size_t bytes) {
+  (void)pool;
+  (void)bytes;
+  return 1;
+}
+static void sys_backend_destroy(void) {}
+static void* sys_backend_malloc(size_t size) { return malloc(size); }
+static void sys_backend_free(void* ptr) { free(ptr); }
+static void* sys_backend_realloc(void* ptr, size_t size) { return realloc(ptr, size); }
+static void* sys_backend_memalign(size_t a, size_t size) {
+  void* p = NULL;
+  if (a < sizeof(void*)) a = sizeof(void*);
+  return posix_memalign(&p, a, size) == 0 ? p : NULL;
+}
+
+static const replay_api_t g_replay_apis[] = {
+  {"memoman", mm_backend_init, mm_backend_destroy, mm_backend_malloc, mm_backend_free, mm_backend_realloc,
+   mm_backend_memalign, 1},
+  {"malloc", sys_backend_init, sys_backend_destroy, sys_backend_malloc, sys_backend_free, sys_backend_realloc,
+   sys_backend_memalign, 0},
+};
+
+#if MM_REPLAY_HAVE_CONTE_TLSF
+typedef void* conte_tlsf_t;
+#define tlsf_t conte_tlsf_t
+#include "../examples/matt_conte/tlsf.h"
+#undef tlsf_t
+
+static conte_tlsf_t g_conte;
+
+static int conte_backend_init(void* pool, size_t bytes) {
+  g_conte = tlsf_create_with_pool(pool, bytes);
+  return g_conte != NULL;
+}
+static void conte_backend_destroy(void) { tlsf_destroy(g_conte); }
+static void* conte_backend_malloc(size_t size) { return tlsf_malloc(g_conte, size); }
+static void conte_backend_free(void* ptr) { tlsf_free(g_conte, ptr); }
+static void* conte_backend_realloc(void* ptr, size_t size) { return tlsf_realloc(g_conte, ptr, size); }
+static void* conte_backend_memalign(size_t a, size_t size) { return tlsf_memalign(g_conte, a, size); }
+
+static const replay_api_t g_conte_api = {"conte", conte_backend_init, conte_backend_destroy, conte_backend_malloc,
+                                         conte_backend_free, conte_backend_realloc, conte_backend_memalign, 1};
+#endif
+
+static const replay_api_t* replay_backend_by_name(const char* name) {
+  for (size_t i = 0; i < sizeof(g_replay_apis) / sizeof(g_replay_apis[0]); i++) {
+    if (!strcmp(name, g_replay_apis[i].name)) return &g_replay_apis[i];
+  }
+#if MM_REPLAY_HAVE_CONTE_TLSF
+  if (!strcmp(name, "conte")) return &g_conte_api;
+#endif
+  return NULL;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int u64_compare(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+/* VmRSS/VmHWM in KiB from /proc/self/status; 0 where unavailable. */
+static size_t proc_status_kib(const char* key) {
+  FILE* f = fopen("/proc/self/status", "r");
+  if (!f) return 0;
+  char line[256];
+  size_t value = 0;
+  size_t key_len = strlen(key);
+  while (fgets(line, sizeof(line), f)) {
+    if (!strncmp(line, key, key_len) && line[key_len] == ':') {
+      value = (size_t)strtoull(line + key_len + 1, NULL, 10);
+      break;
+    }
+  }
+  fclose(f);
+  return value;
+}
+
+static int reset_peak_rss(void) {
+  FILE* f = fopen("/proc/self/clear_refs", "w");
+  if (!f) return 0;
+  int ok = fputs("5", f) >= 0;
+  return (fclose(f) == 0) && ok;
+}
+
+typedef struct replay_samples_t {
+  uint64_t* ns[MM_OP_COUNT];
+  size_t count[MM_OP_COUNT];
+} replay_samples_t;
+
+/* One pass over the trace; `samples` (optional) receives the duration of every call. Returns failed calls. */
+static size_t replay_pass(const replay_api_t* api, const mm_trace_t* trace, void** table, replay_samples_t* samples) {
+  size_t failed = 0;
+  for (size_t i = 0; i < trace->count; i++) {
+    const mm_trace_record_t* rec = &trace->records[i];
+    if (rec->failed) continue;
+    uint64_t t0 = samples ? now_ns() : 0;
+    void* p = NULL;
+    switch (rec->op) {
+      case MM_OP_MALLOC:
+        p = table[rec->id] = api->malloc_fn((size_t)rec->size);
+        break;
+      case MM_OP_MEMALIGN:
+        p = table[rec->id] = api->memalign_fn(rec->align, (size_t)rec->size);
+        break;
+      case MM_OP_REALLOC:
+        if (!table[rec->src_id]) continue;
+        p = api->realloc_fn(table[rec->src_id], (size_t)rec->size);
+        if (p) table[rec->id] = p;
+        break;
+      case MM_OP_FREE:
+        if (!table[rec->id]) continue;
+        api->free_fn(table[rec->id]);
+        table[rec->id] = NULL;
+        break;
+      default:
+        continue;
+    }
+    if (samples) {
+      uint64_t dt = now_ns() - t0;
+      samples->ns[rec->op][samples->count[rec->op]++] = dt;
+    }
+    if (!p && rec->op != MM_OP_FREE) failed++;
+  }
+  for (uint32_t id = 1; id < trace->id_count; id++) {
+    if (table[id]) api->free_fn(table[id]);
+    table[id] = NULL;
+  }
+  return failed;
+}
+
+static void replay_backend(const replay_api_t* api, const mm_trace_t* trace) {
+  static const char* const op_names[MM_OP_COUNT] = {"malloc", "free", "realloc", "memalign"};
+  size_t pool_bytes = api->uses_pool ? (size_t)MM_REPLAY_POOL_MB << 20 : 0;
+  void* pool = NULL;
+  if (pool_bytes) {
+    pool = mmap(NULL, pool_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pool == MAP_FAILED) {
+      perror("mmap");
+      exit(1);
+    }
+  }
+
+  /* Everything the passes touch besides the heap is allocated and faulted in before the RSS baseline. */
+  void** table = calloc(trace->id_count, sizeof(void*));
+  int ok = table != NULL;
+  replay_samples_t samples;
+  memset(&samples, 0, sizeof(samples));
+  size_t op_total[MM_OP_COUNT] = {0};
+  for (size_t i = 0; i < trace->count; i++) {
+    if (trace->records[i].op < MM_OP_COUNT && !trace->records[i].failed) op_total[trace->records[i].op]++;
+  }
+  for (int op = 0; op < MM_OP_COUNT; op++) {
+    samples.ns[op] = malloc((op_total[op] + 1) * sizeof(uint64_t));
+    if (samples.ns[op]) memset(samples.ns[op], 0, (op_total[op] + 1) * sizeof(uint64_t));
+    else ok = 0;
+  }
+  if (!ok) {
+    fprintf(stderr, "%s: out of memory\n", api->name);
+    exit(1);
+  }
+
+  if (!api->init_fn(pool, pool_bytes)) {
+    fprintf(stderr, "%s: init failed\n", api->name);
+    exit(1);
+  }
+  int have_hwm = reset_peak_rss();
+  size_t rss_before = proc_status_kib("VmRSS");
+  uint64_t start = now_ns();
+  size_t failed = replay_pass(api, trace, table, NULL);
+  uint64_t elapsed = now_ns() - start;
+  size_t hwm = proc_status_kib("VmHWM");
+  api->destroy_fn();
+
+  if (pool) madvise(pool, pool_bytes, MADV_DONTNEED);
+  if (!api->init_fn(pool, pool_bytes)) exit(1);
+  replay_pass(api, trace, table, &samples);
+  api->destroy_fn();
+
+  size_t ops = 0;
+  for (int op = 0; op < MM_OP_COUNT; op++) ops += samples.count[op];
+  printf("%s: %zu ops in %.1f ms (%.1f Mops/s), ", api->name, ops, (double)elapsed / 1e6,
+         elapsed ? (double)ops * 1e3 / (double)elapsed : 0.0);
+  if (have_hwm && hwm >= rss_before) printf("peak footprint %zu KiB", hwm - rss_before);
+  else printf("peak footprint n/a");
+  printf(", %zu failed\n", failed);
+
+  printf("  %-9s %10s %8s %8s %8s %10s\n", "op (ns)", "count", "p50", "p99", "p99.9", "max");
+  for (int op = 0; op < MM_OP_COUNT; op++) {
+    size_t n = samples.count[op];
+    if (!n) continue;
+    uint64_t* s = samples.ns[op];
+    qsort(s, n, sizeof(uint64_t), u64_compare);
+    printf("  %-9s %10zu %8llu %8llu %8llu %10llu\n", op_names[op], n, (unsigned long long)s[n / 2],
+           (unsigned long long)s[(n * 99) / 100], (unsigned long long)s[(n * 999) / 1000],
+           (unsigned long long)s[n - 1]);
+  }
+  fflush(stdout);
+}
+
+static void print_trace_summary(const char* path, const mm_trace_t* trace) {
+  size_t counts[MM_OP_COUNT] = {0};
+  size_t skipped = 0;
+  uint64_t live = 0;
+  uint64_t peak = 0;
+  uint64_t* sizes = calloc(trace->id_count, sizeof(uint64_t));
+  for (size_t i = 0; i < trace->count; i++) {
+    const mm_trace_record_t* rec = &trace->records[i];
+    if (rec->op >= MM_OP_COUNT || rec->failed) {
+      skipped++;
+      continue;
+    }
+    counts[rec->op]++;
+    if (!sizes || !rec->id) continue;
+    live -= sizes[rec->id];
+    sizes[rec->id] = (rec->op == MM_OP_FREE) ? 0 : rec->size;
+    live += sizes[rec->id];
+    if (live > peak) peak = live;
+  }
+  free(sizes);
+  printf("trace %s: %zu records (malloc %zu, free %zu, realloc %zu, memalign %zu, %zu failed/skipped), "
+         "peak requested %llu KiB\n",
+         path, trace->count, counts[MM_OP_MALLOC], counts[MM_OP_FREE], counts[MM_OP_REALLOC], counts[MM_OP_MEMALIGN],
+         skipped, (unsigned long long)(peak >> 10));
+}
+
+static uint32_t xorshift32(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* Records a mixed synthetic workload (the soak test's op mix) through the memoman trace hook. */
+static int record_synthetic(const char* path, unsigned long ops) {
+  size_t pool_bytes = (size_t)64 << 20;
+  void* pool = malloc(pool_bytes);
+  void** live = calloc(MM_REPLAY_RECORD_LIVE, sizeof(void*));
+  tlsf_t alloc = pool ? mm_create_with_pool(pool, pool_bytes) : NULL;
+  mm_trace_writer_t* writer = mm_trace_writer_open(path);
+  if (!alloc || !live || !writer) {
+    fprintf(stderr, "record: setup failed (%s)\n", path);
+    return 1;
+  }
+  mm_set_trace_hook(alloc, mm_trace_writer_hook, writer);
+
+  uint32_t rng = 0xC0FFEEu;
+  for (unsigned long i = 0; i < ops; i++) {
+    uint32_t r = xorshift32(&rng);
+    uint32_t slot = (r >> 8) % MM_REPLAY_RECORD_LIVE;
+    size_t size = (r & 3u) ? 8u + (xorshift32(&rng) % 512u) : 512u + (xorshift32(&rng) % 16384u);
+    if (!live[slot]) {
+      live[slot] = (r & 0x30u) == 0x30u ? mm_memalign(alloc, (size_t)64 << (r >> 28 & 3u), size)
+                                        : mm_malloc(alloc, size);
+    } else if ((r & 0xC0u) == 0xC0u) {
+      void* p = mm_realloc(alloc, live[slot], size);
+      if (p) live[slot] = p;
+    } else {
+      mm_free(alloc, live[slot]);
+      live[slot] = NULL;
+    }
+  }
+  for (uint32_t i = 0; i < MM_REPLAY_RECORD_LIVE; i++) mm_free(alloc, live[i]);
+
+  mm_set_trace_hook(alloc, NULL, NULL);
+  int ok = mm_trace_writer_close(writer);
+  mm_destroy(alloc);
+  free(live);
+  free(pool);
+  if (!ok) fprintf(stderr, "record: write failed (%s)\n", path);
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && !strcmp(argv[1], "--record")) {
+    unsigned long ops = argc >= 4 ? strtoul(argv[3], NULL, 10) : MM_REPLAY_RECORD_OPS;
+    return record_synthetic(argv[2], ops);
+  }
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s TRACE [memoman|conte|malloc ...]\n       %s --record TRACE [ops]\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  mm_trace_t trace;
+  if (!mm_trace_load(argv[1], &trace)) {
+    fprintf(stderr, "%s: not a readable mm_trace file\n", argv[1]);
+    return 1;
+  }
+  print_trace_summary(argv[1], &trace);
+
+  const replay_api_t* backends[8];
+  size_t count = 0;
+  if (argc > 2) {
+    for (int i = 2; i < argc && count < 8; i++) {
+      const replay_api_t* api = replay_backend_by_name(argv[i]);
+      if (!api) {
+        fprintf(stderr, "unknown or unavailable backend: %s\n", argv[i]);
+        return 2;
+      }
+      backends[count++] = api;
+    }
+  } else {
+    backends[count++] = &g_replay_apis[0];
+#if MM_REPLAY_HAVE_CONTE_TLSF
+    backends[count++] = &g_conte_api;
+#endif
+    backends[count++] = &g_replay_apis[1];
+  }
+
+  int status = 0;
+  for (size_t i = 0; i < count; i++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      replay_backend(backends[i], &trace);
+      _exit(0);
+    }
+    int wstatus = 0;
+    if (waitpid(pid, &wstatus, 0) < 0 || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+      fprintf(stderr, "%s: replay failed\n", backends[i]->name);
+      status = 1;
+    }
+  }
+
+  mm_trace_unload(&trace);
+  return status;
+}
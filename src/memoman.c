@@ -4,7 +4,14 @@
 #include <limits.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
 #include "memoman.h"
 
@@ -16,7 +23,7 @@ typedef struct mm_allocator_t mm_allocator_t;
 **
 ** Pool-based TLSF allocator targeting TLSF 3.1 semantics:
 ** - O(1) hot-path operations (bounded by FL/SL bitmaps).
-** - No OS allocation APIs in core (caller provides memory pools).
+** - No OS allocation APIs in core (caller provides memory pools); `mm_trim` only madvises free pages away.
 ** - Free-list pointers live in the user payload when a block is free.
 */
 
@@ -30,6 +37,68 @@ typedef struct mm_allocator_t mm_allocator_t;
 /* C99-compatible compile-time assertions. */
 #define MM_STATIC_ASSERT(cond, name) typedef char mm_static_assert_##name[(cond) ? 1 : -1]
 
+/*
+** Build-time geometry (override with -D; the defaults match TLSF 3.1).
+**
+** - MM_ALIGN_SIZE: payload alignment and size granularity. A power of two, at least `sizeof(void*)` and at most
+**   16 (the slab and thread-cache classes are 16-byte steps). Above `sizeof(size_t)` the size word is padded to
+**   MM_ALIGN_SIZE bytes so payloads stay aligned; e.g. 16 gives SIMD-ready payloads for 8 more bytes per block.
+** - MM_SL_INDEX_COUNT_LOG2: log2 of the second-level classes per power of two (1..6). Fewer classes mean smaller
+**   bitmaps and lists but a coarser good-fit (up to 1/2^N of internal waste per request).
+** - MM_FL_INDEX_MAX: log2 of the block size limit (at most 63 on 64-bit). The default caps blocks at 4 GiB; raise
+**   it (e.g. 40 for 1 TiB) for heaps with larger pools.
+** - MM_BITMAP_64: use `uint64_t` first/second-level bitmaps. Selected automatically when the geometry has more
+**   than 32 first- or second-level classes; otherwise the bitmaps stay `unsigned int` as in TLSF 3.1.
+**
+** All of these must be integer literals: the header padding and bitmap width are decided by the preprocessor.
+*/
+#if SIZE_MAX > 0xffffffffu
+#define MM_SIZE_T_BYTES 8
+#else
+#define MM_SIZE_T_BYTES 4
+#endif
+
+#ifndef MM_ALIGN_SIZE
+#define MM_ALIGN_SIZE MM_SIZE_T_BYTES
+#endif
+#ifndef MM_SL_INDEX_COUNT_LOG2
+#define MM_SL_INDEX_COUNT_LOG2 5
+#endif
+#ifndef MM_FL_INDEX_MAX
+#if UINTPTR_MAX > 0xffffffffu
+#define MM_FL_INDEX_MAX 32
+#else
+#define MM_FL_INDEX_MAX 30
+#endif
+#endif
+
+#if MM_ALIGN_SIZE > MM_SIZE_T_BYTES
+#define MM_HEADER_PAD_BYTES (MM_ALIGN_SIZE - MM_SIZE_T_BYTES)
+#else
+#define MM_HEADER_PAD_BYTES 0
+#endif
+
+#if MM_ALIGN_SIZE >= 16
+#define MM_ALIGN_SIZE_LOG2 4
+#elif MM_ALIGN_SIZE >= 8
+#define MM_ALIGN_SIZE_LOG2 3
+#else
+#define MM_ALIGN_SIZE_LOG2 2
+#endif
+
+#if !defined(MM_BITMAP_64) && \
+    (MM_SL_INDEX_COUNT_LOG2 > 5 || (MM_FL_INDEX_MAX - MM_SL_INDEX_COUNT_LOG2 - MM_ALIGN_SIZE_LOG2 + 1) > 32)
+#define MM_BITMAP_64 1
+#endif
+
+#if defined(MM_BITMAP_64)
+typedef uint64_t mm_bitmap_t;
+#else
+typedef unsigned int mm_bitmap_t;
+#endif
+#define MM_BITMAP_BITS ((int)(sizeof(mm_bitmap_t) * 8))
+#define MM_BIT(i) ((mm_bitmap_t)1 << (i))
+
 /*
 ** Block Layout (TLSF 3.1 semantics)
 **
@@ -42,12 +111,47 @@ typedef struct mm_allocator_t mm_allocator_t;
 **
 ** Free block:
 **   [prev_phys] [ size|flags ] [ next_free ] [ prev_free ] [ payload slack ]
+**
+** With MM_HEADER_PAD_BYTES the size word is followed by that much padding before the payload.
+*/
+
+/*
+** Relative links (MM_RELATIVE_LINKS).
+**
+** By default free-list links, list heads, prev_phys footers and pool bounds are plain pointers. With
+** -DMM_RELATIVE_LINKS=1 each one stores the signed distance from the field to its target instead (0 = NULL), so a
+** heap whose control block and pools move together stays valid at any base address: a shared segment can be
+** mapped at a different address in every process. Every link load or store costs one extra add.
 */
+#ifndef MM_RELATIVE_LINKS
+#define MM_RELATIVE_LINKS 0
+#endif
+
+#if MM_RELATIVE_LINKS
+#define MM_LINK(type) intptr_t
+#define LINK_LOAD(type, field) ((type*)link_resolve(&(field)))
+#define LINK_STORE(field, target) link_encode(&(field), (target))
+
+static inline void* link_resolve(const intptr_t* field) {
+  return *field ? (void*)((uintptr_t)field + (uintptr_t)*field) : NULL;
+}
+
+static inline void link_encode(intptr_t* field, const void* target) {
+  *field = target ? (intptr_t)((uintptr_t)target - (uintptr_t)field) : 0;
+}
+#else
+#define MM_LINK(type) type*
+#define LINK_LOAD(type, field) (field)
+#define LINK_STORE(field, target) ((field) = (target))
+#endif
 
 typedef struct tlsf_block_t {
   size_t size; /* LSBs used for flags (TLSF_BLOCK_FREE, TLSF_PREV_FREE) */
-  struct tlsf_block_t* next_free;
-  struct tlsf_block_t* prev_free;
+#if MM_HEADER_PAD_BYTES > 0
+  unsigned char header_pad[MM_HEADER_PAD_BYTES];
+#endif
+  MM_LINK(struct tlsf_block_t) next_free;
+  MM_LINK(struct tlsf_block_t) prev_free;
 } tlsf_block_t;
 
 /*
@@ -59,17 +163,24 @@ typedef struct tlsf_block_t {
 #define MM_MAX_POOLS 32
 
 typedef struct mm_pool_desc_t {
-  char* start;
-  char* end;
+  MM_LINK(char) start;
+  MM_LINK(char) end;
   size_t bytes;
   size_t live_allocations;
   int active;
-  struct mm_pool_desc_t* next_global;
-  struct mm_pool_desc_t* prev_global;
+  struct mm_pool_desc_t* next_global; /* process-wide registry link (see pool_registry_add) */
 } mm_pool_desc_t;
 
-/* The block header exposed to used blocks is a single size word. */
-#define BLOCK_HEADER_OVERHEAD sizeof(size_t)
+static inline char* pool_start(const mm_pool_desc_t* desc) {
+  return LINK_LOAD(char, ((mm_pool_desc_t*)desc)->start);
+}
+
+static inline char* pool_end(const mm_pool_desc_t* desc) {
+  return LINK_LOAD(char, ((mm_pool_desc_t*)desc)->end);
+}
+
+/* The block header exposed to used blocks is a single size word (plus padding up to MM_ALIGN_SIZE). */
+#define BLOCK_HEADER_OVERHEAD (sizeof(size_t) + MM_HEADER_PAD_BYTES)
 #define BLOCK_START_OFFSET BLOCK_HEADER_OVERHEAD
 
 /* Flags stored in the size word. */
@@ -77,8 +188,8 @@ typedef struct mm_pool_desc_t {
 #define TLSF_PREV_FREE    (size_t)2
 #define TLSF_SIZE_MASK    (~(TLSF_BLOCK_FREE | TLSF_PREV_FREE))
 
-/* Default alignment (TLSF uses ALIGN_SIZE; we key off size_t). */
-#define ALIGNMENT         sizeof(size_t)
+/* Payload alignment (TLSF's ALIGN_SIZE); defaults to size_t. */
+#define ALIGNMENT         ((size_t)MM_ALIGN_SIZE)
 
 /* Derived minimum payload required for a free block (TLSF 3.1 semantics):
 ** - `next_free`/`prev_free` stored at payload start (2 pointers).
@@ -89,14 +200,10 @@ typedef struct mm_pool_desc_t {
 #define MM_MIN_FREE_PAYLOAD_BYTES (MM_FREELIST_LINKS_BYTES + MM_PREV_PHYS_FOOTER_BYTES)
 #define TLSF_MIN_BLOCK_SIZE ((MM_MIN_FREE_PAYLOAD_BYTES + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
 
-/* TLSF-style mapping configuration (defaults match TLSF 3.1). */
-#define SL_INDEX_COUNT_LOG2 5
+/* TLSF-style mapping configuration (see MM_SL_INDEX_COUNT_LOG2/MM_FL_INDEX_MAX above). */
+#define SL_INDEX_COUNT_LOG2 MM_SL_INDEX_COUNT_LOG2
 #define SL_INDEX_COUNT (1 << SL_INDEX_COUNT_LOG2)
-#if UINTPTR_MAX > 0xffffffffu
-#define FL_INDEX_MAX 32
-#else
-#define FL_INDEX_MAX 30
-#endif
+#define FL_INDEX_MAX MM_FL_INDEX_MAX
 #define MM_ALIGN_SHIFT \
   ((ALIGNMENT == 1) ? 0 : (ALIGNMENT == 2) ? 1 : (ALIGNMENT == 4) ? 2 : \
    (ALIGNMENT == 8) ? 3 : (ALIGNMENT == 16) ? 4 : (ALIGNMENT == 32) ? 5 : -1)
@@ -111,55 +218,270 @@ static const size_t BLOCK_SIZE_MAX = (size_t)1 << FL_INDEX_MAX;
 #define TLSF_FLI_OFFSET   FL_INDEX_SHIFT
 #define TLSF_FLI_MAX      FL_INDEX_COUNT
 
+/*
+** Slab configuration (MM_FLAG_SLAB).
+**
+** Slabs are MM_SLAB_BYTES blocks carved from the TLSF heap with `mm_memalign` (aligned to their own size) and
+** split into equal header-less slots of one size class. At most MM_SLAB_MAX slabs exist per allocator; beyond
+** that, small requests fall back to the TLSF path.
+*/
+#ifndef MM_SLAB_BYTES
+#define MM_SLAB_BYTES 16384
+#endif
+#ifndef MM_SLAB_MAX
+#define MM_SLAB_MAX 64
+#endif
+#define MM_SLAB_CLASS_COUNT 16
+#define MM_SLAB_MAX_SIZE 512
+#define MM_SLAB_SLOT_MIN 16
+#define MM_SLAB_BITMAP_WORDS (((MM_SLAB_BYTES / MM_SLAB_SLOT_MIN) + 63) / 64)
+
+/*
+** Latency histogram configuration (MM_LATENCY).
+**
+** Log-linear buckets: values below MM_LAT_SUB_COUNT map to themselves; above that every power of two
+** [2^e, 2^(e+1)) is split into MM_LAT_SUB_COUNT equal steps, the same shape as the TLSF size mapping.
+*/
+#ifndef MM_LATENCY
+#define MM_LATENCY 0
+#endif
+#define MM_LAT_SUB_BITS 4
+#define MM_LAT_SUB_COUNT (1 << MM_LAT_SUB_BITS)
+#define MM_LAT_MAX_LOG2 32
+#define MM_LAT_BUCKETS (MM_LAT_SUB_COUNT * (MM_LAT_MAX_LOG2 - MM_LAT_SUB_BITS + 1))
+
+typedef struct mm_latency_hist_t {
+  uint64_t min;
+  uint64_t max;
+  uint64_t total;
+  uint64_t count;
+  uint64_t buckets[MM_LAT_BUCKETS];
+} mm_latency_hist_t;
+
+#ifndef MM_CACHE_LINE
+#define MM_CACHE_LINE 64
+#endif
+
 struct mm_allocator_t {
-  tlsf_block_t block_null;
-  unsigned int fl_bitmap;
-  unsigned int sl_bitmap[FL_INDEX_COUNT];
-  tlsf_block_t* blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+  mm_bitmap_t fl_bitmap;
+  mm_bitmap_t sl_bitmap[FL_INDEX_COUNT];
+  MM_LINK(tlsf_block_t) blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
   size_t current_free_size;
   size_t total_pool_size;
   mm_pool_desc_t pools[MM_MAX_POOLS];
+  /* Active pool slots sorted by start address (pointer -> pool lookup index). */
+  unsigned char pool_order[MM_MAX_POOLS];
+  size_t pool_count;
+  /* Creation flags (MM_FLAG_*) and the per-instance ticket lock used by MM_FLAG_THREAD_SAFE. */
+  unsigned int flags;
+  unsigned int lock_next;
+  unsigned int lock_owner;
+  /* Slab front end (MM_FLAG_SLAB): slabs sorted by address, plus per-class lists of slabs with free slots. */
+  unsigned int slab_count;
+  struct mm_slab_t* slab_index[MM_SLAB_MAX];
+  struct mm_slab_t* slab_partial[MM_SLAB_CLASS_COUNT];
+  /* Incremental counters behind `mm_get_stats` (derived fields are filled in at query time). */
+  mm_stats_t stats;
+  /* Trace hook (`mm_set_trace_hook`), called under the lock after every heap operation. */
+  mm_trace_hook trace_hook;
+  void* trace_user;
+  /* Handle table (`mm_handles_attach`), NULL unless handles are in use. */
+  struct mm_handle_table_t* handles;
+  /* Persistence (`mm_attach`): build layout signature, own address when created (absolute links), root slot. */
+  uint64_t signature;
+  void* base;
+  MM_LINK(void) root;
+  /*
+  ** Remote frees (MM_FLAG_REMOTE_FREE): the lock-free stack other threads push onto and the owning thread's tag, on
+  ** a cache line of their own so pushes do not bounce the lines the lock holder writes on every call.
+  */
+  unsigned int remote_ticks; /* allocation calls since the last drain (under the lock) */
+  unsigned char remote_pad_before[MM_CACHE_LINE];
+  void* remote_head;
+  uintptr_t owner_thread;
+  unsigned char remote_pad_after[MM_CACHE_LINE - sizeof(void*) - sizeof(uintptr_t)];
+#if MM_LATENCY
+  /* Per-operation latency histograms behind `mm_get_latency` (indexed by mm_op_t). */
+  mm_latency_hist_t latency[MM_OP_COUNT];
+#endif
+};
+
+/* Slab header; the slots follow at MM_SLAB_HEADER_BYTES (see the slab front end below). */
+typedef struct mm_slab_t {
+  struct mm_slab_t* next_partial;
+  struct mm_slab_t* prev_partial;
+  unsigned int slot_size;
+  unsigned int capacity;
+  unsigned int free_count;
+  unsigned int cls;
+  uint64_t free_bits[MM_SLAB_BITMAP_WORDS]; /* 1 = slot free */
+} mm_slab_t;
+
+#define MM_SLAB_HEADER_BYTES ((sizeof(mm_slab_t) + 15) & ~(size_t)15)
+
+static const unsigned int g_slab_class_size[MM_SLAB_CLASS_COUNT] = {
+  16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
 };
 
+/*
+** Locking.
+**
+** Instances created with MM_FLAG_THREAD_SAFE serialize every public entry point on a ticket lock stored in the
+** control block. The uncontended path is a single atomic fetch-add (no syscalls), tickets are granted in FIFO
+** order so waiting time is bounded by the number of contending threads, and instances created without the flag
+** never touch an atomic. Waiters spin briefly, then yield so an oversubscribed machine still makes progress.
+*/
+#ifndef MM_LOCK_SPIN_LIMIT
+#define MM_LOCK_SPIN_LIMIT 1024
+#endif
+
+static inline void mm_cpu_relax(unsigned int* spins) {
+  if (++*spins < MM_LOCK_SPIN_LIMIT) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+    return;
+  }
+  *spins = 0;
+#if defined(__unix__) || defined(__APPLE__)
+  sched_yield();
+#endif
+}
+
+static inline void mm_lock(mm_allocator_t* ctrl) {
+  if (!(ctrl->flags & MM_FLAG_THREAD_SAFE)) return;
+  unsigned int ticket = __atomic_fetch_add(&ctrl->lock_next, 1u, __ATOMIC_RELAXED);
+  unsigned int spins = 0;
+  while (__atomic_load_n(&ctrl->lock_owner, __ATOMIC_ACQUIRE) != ticket) mm_cpu_relax(&spins);
+}
+
+static inline void mm_unlock(mm_allocator_t* ctrl) {
+  if (!(ctrl->flags & MM_FLAG_THREAD_SAFE)) return;
+  /* Only the holder writes `lock_owner`, so a plain read is enough before publishing the next ticket. */
+  __atomic_store_n(&ctrl->lock_owner, ctrl->lock_owner + 1u, __ATOMIC_RELEASE);
+}
+
+/* Identifies the calling thread (for MM_FLAG_REMOTE_FREE ownership) by the address of a thread-local byte. */
+static __thread char mm_thread_tag;
+
+static inline uintptr_t mm_thread_id(void) {
+  return (uintptr_t)&mm_thread_tag;
+}
+
+/*
+** Process-wide pool registry (pool_t -> descriptor for `mm_walk_pool`/`mm_validate_pool`).
+**
+** Singly linked so that publishing a pool never writes into another allocator's descriptors:
+** - add: lock-free CAS push at the head.
+** - lookup: lock-free traversal inside a reader section.
+** - remove: unlinks under `g_pool_registry_lock`, then waits for in-flight readers to drain before returning, so
+**   the caller may release the descriptor's memory (e.g. after `mm_destroy`) as soon as the call returns.
+*/
 static mm_pool_desc_t* g_pool_list = NULL;
+static unsigned int g_pool_registry_lock = 0;
+static unsigned int g_pool_registry_readers = 0;
 
 static void pool_registry_add(mm_pool_desc_t* desc) {
   if (!desc) return;
-  desc->prev_global = NULL;
-  desc->next_global = g_pool_list;
-  if (g_pool_list) g_pool_list->prev_global = desc;
-  g_pool_list = desc;
+  mm_pool_desc_t* head = __atomic_load_n(&g_pool_list, __ATOMIC_ACQUIRE);
+  /* Re-creating an allocator in place (without mm_destroy) can hand us a descriptor that is already the head. */
+  if (head == desc) return;
+  do {
+    desc->next_global = head;
+  } while (!__atomic_compare_exchange_n(&g_pool_list, &head, desc, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
 }
 
 static void pool_registry_remove(mm_pool_desc_t* desc) {
   if (!desc) return;
-  if (desc->prev_global) desc->prev_global->next_global = desc->next_global;
-  else if (g_pool_list == desc) g_pool_list = desc->next_global;
-  if (desc->next_global) desc->next_global->prev_global = desc->prev_global;
+  unsigned int spins = 0;
+  while (__atomic_exchange_n(&g_pool_registry_lock, 1u, __ATOMIC_ACQUIRE)) mm_cpu_relax(&spins);
+
+  mm_pool_desc_t* head = __atomic_load_n(&g_pool_list, __ATOMIC_ACQUIRE);
+  if (head == desc) {
+    /* A concurrent push may move the head; fall back to unlinking from the predecessor. */
+    if (!__atomic_compare_exchange_n(&g_pool_list, &head, desc->next_global, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+      head = __atomic_load_n(&g_pool_list, __ATOMIC_ACQUIRE);
+    } else {
+      head = NULL;
+    }
+  }
+  for (mm_pool_desc_t* prev = head; prev; prev = prev->next_global) {
+    if (prev->next_global == desc) {
+      __atomic_store_n(&prev->next_global, desc->next_global, __ATOMIC_RELEASE);
+      break;
+    }
+  }
+
+  __atomic_store_n(&g_pool_registry_lock, 0u, __ATOMIC_RELEASE);
+
+  /*
+  ** Grace period: readers may still be standing on `desc`; its `next_global` stays intact until they leave. The
+  ** fence pairs with the reader's seq_cst increment: either that reader's list load sees the unlink, or this load
+  ** sees the reader.
+  */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  while (__atomic_load_n(&g_pool_registry_readers, __ATOMIC_ACQUIRE) != 0) mm_cpu_relax(&spins);
   desc->next_global = NULL;
-  desc->prev_global = NULL;
 }
 
 static mm_pool_desc_t* pool_desc_from_global(pool_t pool) {
-  for (mm_pool_desc_t* desc = g_pool_list; desc; desc = desc->next_global) {
-    if (pool == (pool_t)desc->start) return desc;
+  mm_pool_desc_t* found = NULL;
+  __atomic_fetch_add(&g_pool_registry_readers, 1u, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  for (mm_pool_desc_t* desc = __atomic_load_n(&g_pool_list, __ATOMIC_ACQUIRE); desc;
+       desc = __atomic_load_n(&desc->next_global, __ATOMIC_ACQUIRE)) {
+    if (pool == (pool_t)pool_start(desc)) {
+      found = desc;
+      break;
+    }
   }
-  return NULL;
+  __atomic_fetch_sub(&g_pool_registry_readers, 1u, __ATOMIC_RELEASE);
+  return found;
 }
 
 /* Compile-time invariants. */
 MM_STATIC_ASSERT((ALIGNMENT & (ALIGNMENT - 1)) == 0, alignment_power_of_two);
 MM_STATIC_ASSERT(ALIGNMENT >= sizeof(void*), alignment_ge_pointer);
 MM_STATIC_ASSERT(MM_ALIGN_SHIFT >= 0, alignment_shift_supported);
-MM_STATIC_ASSERT(BLOCK_HEADER_OVERHEAD == sizeof(size_t), header_overhead_is_size);
+MM_STATIC_ASSERT(ALIGNMENT <= 16, alignment_le_slab_and_tcache_step);
+MM_STATIC_ASSERT(ALIGNMENT >= 4, alignment_leaves_flag_bits);
+MM_STATIC_ASSERT(BLOCK_HEADER_OVERHEAD == ((sizeof(size_t) > ALIGNMENT) ? sizeof(size_t) : ALIGNMENT),
+                 header_overhead_is_size_word);
+MM_STATIC_ASSERT((BLOCK_HEADER_OVERHEAD % ALIGNMENT) == 0, header_keeps_payload_aligned);
 MM_STATIC_ASSERT(BLOCK_START_OFFSET == BLOCK_HEADER_OVERHEAD, payload_starts_after_size);
 MM_STATIC_ASSERT(offsetof(tlsf_block_t, next_free) == BLOCK_START_OFFSET, freelist_links_in_payload);
 MM_STATIC_ASSERT(offsetof(tlsf_block_t, prev_free) == (BLOCK_START_OFFSET + sizeof(void*)), freelist_prev_in_payload);
 MM_STATIC_ASSERT((TLSF_MIN_BLOCK_SIZE % ALIGNMENT) == 0, min_block_aligned);
 MM_STATIC_ASSERT(TLSF_MIN_BLOCK_SIZE >= (2 * sizeof(void*)), min_block_has_freelist_links);
 MM_STATIC_ASSERT(TLSF_MIN_BLOCK_SIZE >= (3 * sizeof(void*)), min_block_has_prev_footer);
-MM_STATIC_ASSERT(SL_INDEX_COUNT <= (sizeof(unsigned int) * 8), sl_bitmap_fits_uint);
-MM_STATIC_ASSERT(FL_INDEX_COUNT <= (sizeof(unsigned int) * 8), fl_bitmap_fits_uint);
+MM_STATIC_ASSERT(SL_INDEX_COUNT_LOG2 >= 1, sl_index_count_log2_positive);
+MM_STATIC_ASSERT(SL_INDEX_COUNT <= MM_BITMAP_BITS, sl_bitmap_fits_word);
+MM_STATIC_ASSERT(FL_INDEX_MAX > FL_INDEX_SHIFT, fl_index_max_above_small_blocks);
+MM_STATIC_ASSERT(FL_INDEX_MAX < (int)(sizeof(size_t) * 8), fl_index_max_fits_size_t);
+MM_STATIC_ASSERT(FL_INDEX_COUNT <= MM_BITMAP_BITS, fl_bitmap_fits_word);
+MM_STATIC_ASSERT((1 << MM_ALIGN_SIZE_LOG2) == MM_ALIGN_SIZE, align_size_log2_matches);
+/* Sizes below SMALL_BLOCK_SIZE map linearly: one second-level class per ALIGNMENT step. */
+MM_STATIC_ASSERT((((size_t)1 << FL_INDEX_SHIFT) / SL_INDEX_COUNT) == ALIGNMENT, small_classes_step_by_alignment);
+MM_STATIC_ASSERT(MM_MAX_POOLS <= (UCHAR_MAX + 1), pool_order_fits_uchar);
+MM_STATIC_ASSERT((MM_SLAB_BYTES & (MM_SLAB_BYTES - 1)) == 0, slab_bytes_power_of_two);
+MM_STATIC_ASSERT(MM_SLAB_BYTES >= 8 * MM_SLAB_MAX_SIZE, slab_holds_several_max_slots);
+/* `mm_create_with_pool` places the first pool MM_CONTROL_BYTES after the control block. */
+#define MM_CONTROL_BYTES ((sizeof(mm_allocator_t) + 15) & ~(size_t)15)
+MM_STATIC_ASSERT((MM_CONTROL_BYTES % ALIGNMENT) == 0, control_bytes_keep_pool_aligned);
+
+/*
+** Layout signature stored in every control block and checked by `mm_attach`: a magic plus everything that changes
+** how the control block and block headers are laid out (control block size, geometry, link mode).
+*/
+#define MM_LAYOUT_MAGIC 0x6d6d6870u /* "mmhp" */
+
+static inline uint64_t layout_signature(void) {
+  return ((uint64_t)MM_LAYOUT_MAGIC << 32) | ((uint64_t)(sizeof(mm_allocator_t) & 0x3ffff) << 14) |
+         ((uint64_t)(MM_RELATIVE_LINKS != 0) << 13) | ((uint64_t)(MM_BITMAP_BITS == 64) << 12) |
+         ((uint64_t)MM_ALIGN_SIZE_LOG2 << 9) | ((uint64_t)SL_INDEX_COUNT_LOG2 << 6) | (uint64_t)FL_INDEX_MAX;
+}
 
 static inline size_t align_size(size_t size) {
   return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
@@ -168,16 +490,24 @@ static inline size_t align_size(size_t size) {
 /*
 ** Bit operations (ffs/fls).
 **
-** Note: our bitmaps are `unsigned int`, mirroring TLSF 3.1.
+** Bitmaps are `mm_bitmap_t`: `unsigned int` as in TLSF 3.1, or `uint64_t` with MM_BITMAP_64.
 */
-static inline int fls_u32(unsigned int word) {
+static inline int fls_bitmap(mm_bitmap_t word) {
   if (!word) return -1;
+#if defined(MM_BITMAP_64)
+  return 63 - __builtin_clzll((unsigned long long)word);
+#else
   return 31 - __builtin_clz(word);
+#endif
 }
 
-static inline int ffs_u32(unsigned int word) {
+static inline int ffs_bitmap(mm_bitmap_t word) {
   if (!word) return -1;
+#if defined(MM_BITMAP_64)
+  return __builtin_ctzll((unsigned long long)word);
+#else
   return __builtin_ctz(word);
+#endif
 }
 
 static inline int fls_sizet(size_t word) {
@@ -185,7 +515,7 @@ static inline int fls_sizet(size_t word) {
 #if SIZE_MAX > 0xffffffffu
   return 63 - __builtin_clzll((unsigned long long)word);
 #else
-  return fls_u32((unsigned int)word);
+  return 31 - __builtin_clz((unsigned int)word);
 #endif
 }
 
@@ -223,11 +553,38 @@ static inline void block_set_prev_used(tlsf_block_t* block) {
 }
 
 static inline tlsf_block_t* block_prev(tlsf_block_t* block) {
-  return *((tlsf_block_t**)((char*)block - sizeof(tlsf_block_t*)));
+  MM_LINK(tlsf_block_t)* footer = (MM_LINK(tlsf_block_t)*)((char*)block - sizeof(*footer));
+  return LINK_LOAD(tlsf_block_t, *footer);
 }
 
 static inline void block_set_prev(tlsf_block_t* block, tlsf_block_t* prev) {
-  *((tlsf_block_t**)((char*)block - sizeof(tlsf_block_t*))) = prev;
+  MM_LINK(tlsf_block_t)* footer = (MM_LINK(tlsf_block_t)*)((char*)block - sizeof(*footer));
+  LINK_STORE(*footer, prev);
+}
+
+/* Free-list links and list heads (see MM_RELATIVE_LINKS). */
+static inline tlsf_block_t* free_next(tlsf_block_t* block) {
+  return LINK_LOAD(tlsf_block_t, block->next_free);
+}
+
+static inline tlsf_block_t* free_prev(tlsf_block_t* block) {
+  return LINK_LOAD(tlsf_block_t, block->prev_free);
+}
+
+static inline void free_set_next(tlsf_block_t* block, tlsf_block_t* next) {
+  LINK_STORE(block->next_free, next);
+}
+
+static inline void free_set_prev(tlsf_block_t* block, tlsf_block_t* prev) {
+  LINK_STORE(block->prev_free, prev);
+}
+
+static inline tlsf_block_t* list_head(mm_allocator_t* ctrl, int fl, int sl) {
+  return LINK_LOAD(tlsf_block_t, ctrl->blocks[fl][sl]);
+}
+
+static inline void list_set_head(mm_allocator_t* ctrl, int fl, int sl, tlsf_block_t* block) {
+  LINK_STORE(ctrl->blocks[fl][sl], block);
 }
 
 /*
@@ -259,48 +616,96 @@ static inline void mapping_search(size_t size, int* fli, int* sli) {
   mapping_insert(size, fli, sli);
 }
 
+/*
+** Bounded best fit (MM_FLAG_BEST_FIT, or every instance with -DMM_BEST_FIT=1).
+**
+** Good fit rounds the request up to the next class so that any head block fits, which skips the blocks in the
+** request's own class that are only slightly larger. Best-fit mode first scans at most MM_BEST_FIT_SCAN blocks of
+** that exact class and takes the smallest one that fits (stopping at an exact match), then falls back to good fit.
+** The extra cost is bounded by the scan length, so the search stays O(1).
+*/
+#ifndef MM_BEST_FIT
+#define MM_BEST_FIT 0
+#endif
+
+#ifndef MM_BEST_FIT_SCAN
+#define MM_BEST_FIT_SCAN 8
+#endif
+
+MM_STATIC_ASSERT(MM_BEST_FIT_SCAN >= 1, best_fit_scan_nonzero);
+
+static inline tlsf_block_t* search_exact_class(mm_allocator_t* ctrl, size_t size, int* fli, int* sli) {
+  int fl, sl;
+  mapping_insert(size, &fl, &sl);
+  if (fl >= FL_INDEX_COUNT || !(ctrl->sl_bitmap[fl] & MM_BIT(sl))) return NULL;
+
+  tlsf_block_t* best = NULL;
+  size_t best_size = SIZE_MAX;
+  tlsf_block_t* block = list_head(ctrl, fl, sl);
+  for (unsigned int i = 0; block && i < MM_BEST_FIT_SCAN; i++, block = free_next(block)) {
+    size_t candidate = block_size(block);
+    if (candidate < size || candidate >= best_size) continue;
+    best = block;
+    best_size = candidate;
+    if (candidate == size) break;
+  }
+  if (best) {
+    *fli = fl;
+    *sli = sl;
+  }
+  return best;
+}
+
 static inline tlsf_block_t* search_suitable_block(mm_allocator_t* ctrl, size_t size, int* fli, int* sli) {
+  if (MM_BEST_FIT || (ctrl->flags & MM_FLAG_BEST_FIT)) {
+    tlsf_block_t* fit = search_exact_class(ctrl, size, fli, sli);
+    if (fit) return fit;
+  }
+
   mapping_search(size, fli, sli);
 
   int fl = *fli;
   int sl = *sli;
+  /* Requests just below BLOCK_SIZE_MAX round up past the last first-level class. */
+  if (fl >= FL_INDEX_COUNT) return NULL;
 
-  unsigned int sl_map = ctrl->sl_bitmap[fl] & (~0U << sl);
+  mm_bitmap_t sl_map = ctrl->sl_bitmap[fl] & (~(mm_bitmap_t)0 << sl);
   if (!sl_map) {
-    const unsigned int fl_map = ctrl->fl_bitmap & (~0U << (fl + 1));
+    /* A full-width FL bitmap has no classes above its top bit (and a shift by the width is undefined). */
+    const mm_bitmap_t fl_map = (fl + 1 < MM_BITMAP_BITS) ? ctrl->fl_bitmap & (~(mm_bitmap_t)0 << (fl + 1)) : 0;
     if (!fl_map) return NULL;
-    fl = ffs_u32(fl_map);
+    fl = ffs_bitmap(fl_map);
     *fli = fl;
     sl_map = ctrl->sl_bitmap[fl];
   }
 
-  sl = ffs_u32(sl_map);
+  sl = ffs_bitmap(sl_map);
   *sli = sl;
-  return ctrl->blocks[fl][sl];
+  return list_head(ctrl, fl, sl);
 }
 
 /*
 ** Free list operations.
 */
 static void remove_free_block_direct(mm_allocator_t* ctrl, tlsf_block_t* block, int fl, int sl) {
-  tlsf_block_t* prev = block->prev_free;
-  tlsf_block_t* next = block->next_free;
+  tlsf_block_t* prev = free_prev(block);
+  tlsf_block_t* next = free_next(block);
 
   if (prev) {
-    prev->next_free = next;
+    free_set_next(prev, next);
   } else {
-    ctrl->blocks[fl][sl] = next;
+    list_set_head(ctrl, fl, sl, next);
   }
 
   if (next) {
-    next->prev_free = prev;
+    free_set_prev(next, prev);
   }
 
   /* If the list is now empty, update the bitmaps. */
-  if (!ctrl->blocks[fl][sl]) {
-    ctrl->sl_bitmap[fl] &= ~(1U << sl);
+  if (!list_head(ctrl, fl, sl)) {
+    ctrl->sl_bitmap[fl] &= ~MM_BIT(sl);
     if (ctrl->sl_bitmap[fl] == 0) {
-      ctrl->fl_bitmap &= ~(1U << fl);
+      ctrl->fl_bitmap &= ~MM_BIT(fl);
     }
   }
   ctrl->current_free_size -= block_size(block);
@@ -312,26 +717,121 @@ static void remove_free_block(mm_allocator_t* ctrl, tlsf_block_t* block) {
   remove_free_block_direct(ctrl, block, fl, sl);
 }
 
+/*
+** Address-ordered free lists (MM_FLAG_ADDRESS_ORDERED, or every instance with -DMM_ADDRESS_ORDERED=1).
+**
+** The default LIFO insert reuses the most recently freed block, which over a long uptime spreads live data over
+** every pool. Keeping each class list sorted by address makes allocation take the lowest block of a class, so
+** the heap packs towards low addresses and high pools empty out. Insertion walks the class list: O(blocks in
+** that class) instead of O(1).
+*/
+#ifndef MM_ADDRESS_ORDERED
+#define MM_ADDRESS_ORDERED 0
+#endif
+
 static void insert_free_block(mm_allocator_t* ctrl, tlsf_block_t* block) {
   int fl, sl;
   mapping_insert(block_size(block), &fl, &sl);
 
-  tlsf_block_t* head = ctrl->blocks[fl][sl];
-  block->next_free = head;
-  block->prev_free = NULL;
+  tlsf_block_t* prev = NULL;
+  tlsf_block_t* next = list_head(ctrl, fl, sl);
+  if (MM_ADDRESS_ORDERED || (ctrl->flags & MM_FLAG_ADDRESS_ORDERED)) {
+    while (next && (uintptr_t)next < (uintptr_t)block) {
+      prev = next;
+      next = free_next(next);
+    }
+  }
+  free_set_next(block, next);
+  free_set_prev(block, prev);
 
-  if (head) {
-    head->prev_free = block;
+  if (next) {
+    free_set_prev(next, block);
   }
 
-  ctrl->blocks[fl][sl] = block;
+  if (prev) {
+    free_set_next(prev, block);
+  } else {
+    list_set_head(ctrl, fl, sl, block);
+  }
 
   /* Update bitmaps. */
-  ctrl->sl_bitmap[fl] |= (1U << sl);
-  ctrl->fl_bitmap |= (1U << fl);
+  ctrl->sl_bitmap[fl] |= MM_BIT(sl);
+  ctrl->fl_bitmap |= MM_BIT(fl);
   ctrl->current_free_size += block_size(block);
 }
 
+/* Used-byte accounting for `mm_get_stats`. */
+static inline void stats_add_in_use(mm_allocator_t* ctrl, size_t bytes) {
+  ctrl->stats.bytes_in_use += bytes;
+  if (ctrl->stats.bytes_in_use > ctrl->stats.peak_bytes_in_use) {
+    ctrl->stats.peak_bytes_in_use = ctrl->stats.bytes_in_use;
+  }
+}
+
+/*
+** Latency recording (MM_LATENCY).
+**
+** The public wrappers read the timer before taking the lock and record after the operation, still under the lock,
+** so the histogram sees what the caller sees (lock wait included) without needing its own synchronization.
+*/
+static inline uint64_t latency_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline unsigned int latency_bucket(uint64_t ticks) {
+  if (ticks < MM_LAT_SUB_COUNT) return (unsigned int)ticks;
+  if (ticks >> MM_LAT_MAX_LOG2) return MM_LAT_BUCKETS - 1;
+  int e = 63 - __builtin_clzll((unsigned long long)ticks);
+  unsigned int sub = (unsigned int)(ticks >> (e - MM_LAT_SUB_BITS)) & (MM_LAT_SUB_COUNT - 1);
+  return (unsigned int)(e - MM_LAT_SUB_BITS + 1) * MM_LAT_SUB_COUNT + sub;
+}
+
+/* Largest value that maps to `bucket` (the last bucket also holds everything beyond 2^MM_LAT_MAX_LOG2). */
+static inline uint64_t latency_bucket_upper(unsigned int bucket) {
+  if (bucket < MM_LAT_SUB_COUNT) return bucket;
+  if (bucket == MM_LAT_BUCKETS - 1) return UINT64_MAX;
+  unsigned int e = bucket / MM_LAT_SUB_COUNT + MM_LAT_SUB_BITS - 1;
+  uint64_t step = (uint64_t)1 << (e - MM_LAT_SUB_BITS);
+  uint64_t lower = (uint64_t)(MM_LAT_SUB_COUNT + bucket % MM_LAT_SUB_COUNT) * step;
+  return lower + step - 1;
+}
+
+#if MM_LATENCY
+#define MM_LATENCY_START(t0) uint64_t t0 = latency_now()
+#define MM_LATENCY_RECORD(ctrl, op, t0) latency_record((ctrl), (op), latency_now() - (t0))
+
+static inline void latency_record(mm_allocator_t* ctrl, mm_op_t op, uint64_t ticks) {
+  mm_latency_hist_t* hist = &ctrl->latency[op];
+  if (hist->count == 0 || ticks < hist->min) hist->min = ticks;
+  if (ticks > hist->max) hist->max = ticks;
+  hist->total += ticks;
+  hist->count++;
+  hist->buckets[latency_bucket(ticks)]++;
+}
+#else
+#define MM_LATENCY_START(t0) ((void)0)
+#define MM_LATENCY_RECORD(ctrl, op, t0) ((void)0)
+#endif
+
+static inline void trace_emit(mm_allocator_t* ctrl, mm_op_t op, void* ptr, void* result, size_t size,
+                              size_t align) {
+  if (!ctrl->trace_hook) return;
+  mm_trace_event_t event = {op, ptr, result, size, align};
+  ctrl->trace_hook(ctrl->trace_user, &event);
+}
+
 static inline void* block_to_user(tlsf_block_t* block) {
   return (void*)((char*)block + BLOCK_START_OFFSET);
 }
@@ -343,26 +843,59 @@ static inline tlsf_block_t* user_to_block(void* ptr) {
 
 /*
 ** Pool handle helpers.
+**
+** `pool_order` keeps the active pool slots sorted by start address so pointer -> pool resolution is a
+** branch-free binary search (at most log2(MM_MAX_POOLS) steps) instead of a scan over every slot.
 */
+static inline mm_pool_desc_t* pool_desc_for_addr(mm_allocator_t* ctrl, uintptr_t addr) {
+  size_t n = ctrl->pool_count;
+  if (!n) return NULL;
+
+  const unsigned char* order = ctrl->pool_order;
+  size_t base = 0;
+  while (n > 1) {
+    size_t half = n >> 1;
+    base = ((uintptr_t)pool_start(&ctrl->pools[order[base + half]]) <= addr) ? base + half : base;
+    n -= half;
+  }
+
+  mm_pool_desc_t* desc = &ctrl->pools[order[base]];
+  if (addr < (uintptr_t)pool_start(desc) || addr >= (uintptr_t)pool_end(desc)) return NULL;
+  return desc;
+}
+
 static mm_pool_desc_t* pool_desc_from_handle(mm_allocator_t* ctrl, pool_t pool) {
   if (!ctrl || !pool) return NULL;
-  for (size_t i = 0; i < MM_MAX_POOLS; i++) {
-    mm_pool_desc_t* desc = &ctrl->pools[i];
-    if (!desc->active) continue;
-    if (pool == (pool_t)desc->start) return desc;
-  }
-  return NULL;
+  mm_pool_desc_t* desc = pool_desc_for_addr(ctrl, (uintptr_t)pool);
+  if (!desc || pool != (pool_t)pool_start(desc)) return NULL;
+  return desc;
 }
 
-static mm_pool_desc_t* pool_desc_for_block(mm_allocator_t* ctrl, const tlsf_block_t* block) {
+static inline mm_pool_desc_t* pool_desc_for_block(mm_allocator_t* ctrl, const tlsf_block_t* block) {
   if (!ctrl || !block) return NULL;
-  uintptr_t addr = (uintptr_t)block;
-  for (size_t i = 0; i < MM_MAX_POOLS; i++) {
-    mm_pool_desc_t* p = &ctrl->pools[i];
-    if (!p->active) continue;
-    if (addr >= (uintptr_t)p->start && addr < (uintptr_t)p->end) return p;
+  return pool_desc_for_addr(ctrl, (uintptr_t)block);
+}
+
+static void pool_index_insert(mm_allocator_t* ctrl, mm_pool_desc_t* desc) {
+  unsigned char slot = (unsigned char)(desc - ctrl->pools);
+  size_t i = ctrl->pool_count;
+  while (i > 0 && (uintptr_t)pool_start(&ctrl->pools[ctrl->pool_order[i - 1]]) > (uintptr_t)pool_start(desc)) {
+    ctrl->pool_order[i] = ctrl->pool_order[i - 1];
+    i--;
+  }
+  ctrl->pool_order[i] = slot;
+  ctrl->pool_count++;
+}
+
+static void pool_index_remove(mm_allocator_t* ctrl, mm_pool_desc_t* desc) {
+  unsigned char slot = (unsigned char)(desc - ctrl->pools);
+  size_t n = ctrl->pool_count;
+  for (size_t i = 0; i < n; i++) {
+    if (ctrl->pool_order[i] != slot) continue;
+    memmove(&ctrl->pool_order[i], &ctrl->pool_order[i + 1], n - i - 1);
+    ctrl->pool_count--;
+    return;
   }
-  return NULL;
 }
 
 
@@ -394,13 +927,13 @@ static inline tlsf_block_t* block_next_safe(mm_allocator_t* ctrl, tlsf_block_t*
 static inline int mm_block_ptr_in_pool(const mm_pool_desc_t* desc, const tlsf_block_t* block) {
   if (!desc || !block) return 0;
   uintptr_t addr = (uintptr_t)block;
-  return addr >= (uintptr_t)desc->start && addr < (uintptr_t)desc->end;
+  return addr >= (uintptr_t)pool_start(desc) && addr < (uintptr_t)pool_end(desc);
 }
 
 static inline int mm_block_header_sane(const mm_pool_desc_t* desc, const tlsf_block_t* block) {
-  if (!desc || !desc->start || !desc->end) return 0;
+  if (!desc || !pool_start(desc) || !pool_end(desc)) return 0;
   if (desc->bytes == 0) return 0;
-  if (desc->end <= desc->start) return 0;
+  if (pool_end(desc) <= pool_start(desc)) return 0;
   if (!mm_block_ptr_in_pool(desc, block)) return 0;
 
   size_t sz = block_size((tlsf_block_t*)block);
@@ -408,7 +941,7 @@ static inline int mm_block_header_sane(const mm_pool_desc_t* desc, const tlsf_bl
   if ((sz % ALIGNMENT) != 0) return 0;
 
   uintptr_t block_addr = (uintptr_t)block;
-  uintptr_t end_addr = (uintptr_t)desc->end;
+  uintptr_t end_addr = (uintptr_t)pool_end(desc);
   if (block_addr > end_addr) return 0;
   if ((end_addr - block_addr) < BLOCK_HEADER_OVERHEAD) return 0;
 
@@ -416,7 +949,7 @@ static inline int mm_block_header_sane(const mm_pool_desc_t* desc, const tlsf_bl
   if (sz > max_payload) return 0;
   if (sz > SIZE_MAX - BLOCK_HEADER_OVERHEAD) return 0;
 
-  tlsf_block_t* epilogue = (tlsf_block_t*)((char*)desc->end - BLOCK_HEADER_OVERHEAD);
+  tlsf_block_t* epilogue = (tlsf_block_t*)((char*)pool_end(desc) - BLOCK_HEADER_OVERHEAD);
   uintptr_t end = block_addr + BLOCK_HEADER_OVERHEAD + sz;
   if (end < block_addr) return 0;
   if (end > (uintptr_t)epilogue) return 0;
@@ -432,13 +965,18 @@ static inline int mm_block_header_sane(const mm_pool_desc_t* desc, const tlsf_bl
 #define MM_DEBUG_ABORT_ON_DOUBLE_FREE 0
 #endif
 
+/* A double remote free leaks every block queued before it (see remote_cut_cycle), so it aborts by default. */
+#if !defined(MM_DEBUG_ABORT_ON_REMOTE_CYCLE)
+#define MM_DEBUG_ABORT_ON_REMOTE_CYCLE 1
+#endif
+
 static tlsf_block_t* mm_debug_find_block_for_ptr(mm_allocator_t* ctrl, mm_pool_desc_t* desc, const void* ptr) {
   (void)ctrl;
   if (!desc || !ptr) return NULL;
 
   if (((uintptr_t)ptr % ALIGNMENT) != 0) return NULL;
-  tlsf_block_t* epilogue = (tlsf_block_t*)((char*)desc->end - BLOCK_HEADER_OVERHEAD);
-  tlsf_block_t* block = (tlsf_block_t*)desc->start;
+  tlsf_block_t* epilogue = (tlsf_block_t*)((char*)pool_end(desc) - BLOCK_HEADER_OVERHEAD);
+  tlsf_block_t* block = (tlsf_block_t*)pool_start(desc);
 
   size_t max_steps = (desc->bytes / ALIGNMENT) + 2;
   for (size_t step = 0; step < max_steps; step++) {
@@ -461,8 +999,8 @@ static tlsf_block_t* mm_debug_find_containing_block(mm_allocator_t* ctrl, mm_poo
   if (!desc || !ptr) return NULL;
   if (((uintptr_t)ptr % ALIGNMENT) != 0) return NULL;
 
-  tlsf_block_t* epilogue = (tlsf_block_t*)((char*)desc->end - BLOCK_HEADER_OVERHEAD);
-  tlsf_block_t* block = (tlsf_block_t*)desc->start;
+  tlsf_block_t* epilogue = (tlsf_block_t*)((char*)pool_end(desc) - BLOCK_HEADER_OVERHEAD);
+  tlsf_block_t* block = (tlsf_block_t*)pool_start(desc);
 
   size_t max_steps = (desc->bytes / ALIGNMENT) + 2;
   for (size_t step = 0; step < max_steps; step++) {
@@ -501,11 +1039,10 @@ static inline mm_ptr_check_t mm_ptr_to_block_checked(
   if (!ctrl || !ptr) return MM_PTR_INVALID;
 
   if (((uintptr_t)ptr % ALIGNMENT) != 0) return MM_PTR_INVALID;
+  if ((uintptr_t)ptr < (uintptr_t)BLOCK_START_OFFSET) return MM_PTR_INVALID;
 
-  pool_t pool = mm_get_pool_for_ptr((tlsf_t)ctrl, ptr);
-  if (!pool) return MM_PTR_INVALID;
-
-  mm_pool_desc_t* pool_desc = pool_desc_from_handle(ctrl, pool);
+  /* Single index lookup (the block header must live in the same pool as the payload). */
+  mm_pool_desc_t* pool_desc = pool_desc_for_addr(ctrl, (uintptr_t)ptr - (uintptr_t)BLOCK_START_OFFSET);
   if (!pool_desc) return MM_PTR_INVALID;
   if (out_pool_desc) *out_pool_desc = pool_desc;
 
@@ -570,6 +1107,45 @@ static inline tlsf_block_t* split_block(mm_allocator_t* ctrl, tlsf_block_t* bloc
   return remainder;
 }
 
+/*
+** Small-block clustering (MM_FLAG_CLUSTER_SMALL, or every instance with -DMM_CLUSTER_SMALL=1).
+**
+** A split normally carves the request from the low end of a free block, so small and large blocks alternate along
+** a pool and every huge page a small-object workload touches also holds large payloads. With clustering, requests
+** of at least MM_CLUSTER_LARGE bytes are carved from the high end instead: small blocks pack upwards from the
+** bottom of each free region and large ones downwards from the top, and pointer chasing over small objects
+** stays within fewer (huge) pages.
+*/
+#ifndef MM_CLUSTER_SMALL
+#define MM_CLUSTER_SMALL 0
+#endif
+
+#ifndef MM_CLUSTER_LARGE
+#define MM_CLUSTER_LARGE 4096
+#endif
+
+static inline int cluster_from_top(const mm_allocator_t* ctrl, size_t size) {
+  return size >= MM_CLUSTER_LARGE && (MM_CLUSTER_SMALL || (ctrl->flags & MM_FLAG_CLUSTER_SMALL));
+}
+
+/*
+** Like split_block, but `size` comes from the high end: returns that block and leaves `block` as the free rest.
+** The caller marks it used and clears PREV_FREE on its successor, as after split_block.
+*/
+static inline tlsf_block_t* split_block_high(tlsf_block_t* block, size_t size) {
+  size_t block_total_size = block_size(block);
+  if (block_total_size < size + BLOCK_HEADER_OVERHEAD + TLSF_MIN_BLOCK_SIZE) return NULL;
+
+  size_t remainder_size = block_total_size - size - BLOCK_HEADER_OVERHEAD;
+  block_set_size(block, remainder_size);
+
+  tlsf_block_t* upper = (tlsf_block_t*)((char*)block + BLOCK_HEADER_OVERHEAD + remainder_size);
+  upper->size = size;
+  block_set_prev_free(upper); /* The low part stays free. */
+  block_set_prev(upper, block);
+  return upper;
+}
+
 static inline tlsf_block_t* coalesce(mm_allocator_t* ctrl, tlsf_block_t* block) {
   mm_pool_desc_t* pool_desc = pool_desc_for_block(ctrl, block);
   if (!pool_desc) return block;
@@ -624,8 +1200,9 @@ static inline tlsf_block_t* coalesce(mm_allocator_t* ctrl, tlsf_block_t* block)
 ** Validation is allowed to be O(n) in block count; it is not used on the hot path in release builds.
 */
 
-int mm_validate(tlsf_t tlsf) {
-  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+static int validate_pool_impl(mm_pool_desc_t* desc);
+
+static int validate_impl(mm_allocator_t* ctrl) {
   if (!ctrl) return 0;
 
 #define CHECK(cond, msg) do { \
@@ -639,10 +1216,48 @@ int mm_validate(tlsf_t tlsf) {
   for (size_t i = 0; i < MM_MAX_POOLS; i++) {
     if (!ctrl->pools[i].active) continue;
     pools_bytes += ctrl->pools[i].bytes;
-    CHECK(mm_validate_pool((pool_t)ctrl->pools[i].start), "Pool validation failed");
+    CHECK(validate_pool_impl(&ctrl->pools[i]), "Pool validation failed");
   }
   CHECK(pools_bytes == ctrl->total_pool_size, "total_pool_size does not match sum of pools");
 
+  /* 1b. Pool index: every active slot exactly once, sorted by start address. */
+  {
+    size_t active = 0;
+    for (size_t i = 0; i < MM_MAX_POOLS; i++) {
+      if (ctrl->pools[i].active) active++;
+    }
+    CHECK(ctrl->pool_count == active, "Pool index count mismatch");
+    for (size_t i = 0; i < ctrl->pool_count; i++) {
+      CHECK(ctrl->pool_order[i] < MM_MAX_POOLS, "Pool index slot out of range");
+      CHECK(ctrl->pools[ctrl->pool_order[i]].active, "Pool index references inactive slot");
+      if (i > 0) {
+        CHECK(pool_end(&ctrl->pools[ctrl->pool_order[i - 1]]) <= pool_start(&ctrl->pools[ctrl->pool_order[i]]),
+          "Pool index not sorted");
+      }
+    }
+  }
+
+  /* 1c. Slab index: sorted, each slab a used block whose bitmap agrees with its free count. */
+  {
+    CHECK(ctrl->slab_count <= MM_SLAB_MAX, "Slab count out of range");
+    for (unsigned int i = 0; i < ctrl->slab_count; i++) {
+      mm_slab_t* slab = ctrl->slab_index[i];
+      CHECK(((uintptr_t)slab & (MM_SLAB_BYTES - 1)) == 0, "Slab misaligned");
+      if (i > 0) CHECK((uintptr_t)ctrl->slab_index[i - 1] < (uintptr_t)slab, "Slab index not sorted");
+      CHECK(pool_desc_for_block(ctrl, user_to_block(slab)) != NULL, "Slab outside any pool");
+      CHECK(!block_is_free(user_to_block(slab)), "Slab backed by a free block");
+      CHECK(block_size(user_to_block(slab)) >= MM_SLAB_BYTES, "Slab block too small");
+      CHECK(slab->cls < MM_SLAB_CLASS_COUNT, "Slab class out of range");
+      CHECK(slab->slot_size == g_slab_class_size[slab->cls], "Slab slot size mismatch");
+      unsigned int free_slots = 0;
+      for (unsigned int w = 0; w < MM_SLAB_BITMAP_WORDS; w++) {
+        free_slots += (unsigned int)__builtin_popcountll(slab->free_bits[w]);
+      }
+      CHECK(free_slots == slab->free_count, "Slab free count mismatch");
+      CHECK(slab->free_count <= slab->capacity, "Slab free count exceeds capacity");
+    }
+  }
+
   /*
   ** 2. Physical walk: collect free-block counts per bucket.
   ** This is O(n) in block count and avoids per-block list searches (which can be O(n^2)).
@@ -652,12 +1267,13 @@ int mm_validate(tlsf_t tlsf) {
 
   size_t phys_free_blocks = 0;
   size_t phys_free_bytes = 0;
+  size_t phys_used_bytes = 0;
   for (size_t i = 0; i < MM_MAX_POOLS; i++) {
     mm_pool_desc_t* desc = &ctrl->pools[i];
     if (!desc->active) continue;
 
-    tlsf_block_t* block = (tlsf_block_t*)desc->start;
-    tlsf_block_t* epilogue = (tlsf_block_t*)(desc->end - BLOCK_HEADER_OVERHEAD);
+    tlsf_block_t* block = (tlsf_block_t*)pool_start(desc);
+    tlsf_block_t* epilogue = (tlsf_block_t*)(pool_end(desc) - BLOCK_HEADER_OVERHEAD);
 
     size_t max_steps = (desc->bytes / ALIGNMENT) + 2;
     for (size_t step = 0; step < max_steps; step++) {
@@ -672,6 +1288,8 @@ int mm_validate(tlsf_t tlsf) {
         phys_counts[fl][sl]++;
         phys_free_blocks++;
         phys_free_bytes += sz;
+      } else {
+        phys_used_bytes += sz;
       }
 
       tlsf_block_t* next = (tlsf_block_t*)((char*)block + BLOCK_HEADER_OVERHEAD + sz);
@@ -682,21 +1300,21 @@ int mm_validate(tlsf_t tlsf) {
 
   /* 3. Bitmap structure consistency. */
   {
-    const unsigned int fl_mask = (TLSF_FLI_MAX >= (int)(sizeof(unsigned int) * 8))
-      ? ~0u
-      : ((1u << TLSF_FLI_MAX) - 1u);
+    const mm_bitmap_t fl_mask = (TLSF_FLI_MAX >= MM_BITMAP_BITS)
+      ? ~(mm_bitmap_t)0
+      : (MM_BIT(TLSF_FLI_MAX) - 1u);
     CHECK((ctrl->fl_bitmap & ~fl_mask) == 0, "FL bitmap has out-of-range bits");
 
-    const unsigned int sl_mask = (TLSF_SLI_COUNT >= (int)(sizeof(unsigned int) * 8))
-      ? ~0u
-      : ((1u << TLSF_SLI_COUNT) - 1u);
+    const mm_bitmap_t sl_mask = (TLSF_SLI_COUNT >= MM_BITMAP_BITS)
+      ? ~(mm_bitmap_t)0
+      : (MM_BIT(TLSF_SLI_COUNT) - 1u);
 
     for (int fl = 0; fl < TLSF_FLI_MAX; fl++) {
       CHECK((ctrl->sl_bitmap[fl] & ~sl_mask) == 0, "SL bitmap has out-of-range bits");
       if (ctrl->sl_bitmap[fl]) {
-        CHECK((ctrl->fl_bitmap & (1u << fl)) != 0, "FL bitmap cleared but SL bitmap nonzero");
+        CHECK((ctrl->fl_bitmap & MM_BIT(fl)) != 0, "FL bitmap cleared but SL bitmap nonzero");
       } else {
-        CHECK((ctrl->fl_bitmap & (1u << fl)) == 0, "FL bitmap set but SL bitmap zero");
+        CHECK((ctrl->fl_bitmap & MM_BIT(fl)) == 0, "FL bitmap set but SL bitmap zero");
       }
     }
   }
@@ -710,10 +1328,10 @@ int mm_validate(tlsf_t tlsf) {
 
   for (int fl = 0; fl < TLSF_FLI_MAX; fl++) {
     for (int sl = 0; sl < TLSF_SLI_COUNT; sl++) {
-       tlsf_block_t* block = ctrl->blocks[fl][sl];
+       tlsf_block_t* block = list_head(ctrl, fl, sl);
 
        /* Bitmap consistency. */
-       int has_bit = (ctrl->sl_bitmap[fl] & (1U << sl)) != 0;
+       int has_bit = (ctrl->sl_bitmap[fl] & MM_BIT(sl)) != 0;
        if (block) {
          CHECK(has_bit, "Bitmap cleared but list not empty");
        } else {
@@ -727,16 +1345,22 @@ int mm_validate(tlsf_t tlsf) {
 
        while (walk) {
          CHECK(count++ < max_list_nodes, "Infinite loop detected in free list");
+         /* Containment first: a stray link (e.g. in a heap reopened by mm_attach) must not be dereferenced. */
+         mm_pool_desc_t* desc = pool_desc_for_block(ctrl, walk);
+         CHECK(desc != NULL, "Free list block not contained by any pool");
+         CHECK((uintptr_t)walk >= (uintptr_t)pool_start(desc), "Free list block outside pool start");
+         CHECK((uintptr_t)walk < (uintptr_t)pool_end(desc), "Free list block outside pool end");
+         CHECK(((uintptr_t)walk % ALIGNMENT) == 0, "Free list block misaligned");
+         /* A link into the middle of a block reads an arbitrary size word: keep the next header in the pool too. */
+         size_t room = (size_t)((uintptr_t)pool_end(desc) - (uintptr_t)walk);
+         CHECK(room >= 2 * BLOCK_HEADER_OVERHEAD + TLSF_MIN_BLOCK_SIZE, "Free list block too close to pool end");
+         CHECK(block_size(walk) <= room - 2 * BLOCK_HEADER_OVERHEAD, "Free block runs past pool end");
+
          CHECK(block_is_free(walk), "Used block found in free list");
-         CHECK(walk->prev_free == list_prev, "Free list prev pointer broken");
+         CHECK(free_prev(walk) == list_prev, "Free list prev pointer broken");
          CHECK((block_size(walk) % ALIGNMENT) == 0, "Free block size unaligned");
          CHECK(block_size(walk) >= TLSF_MIN_BLOCK_SIZE, "Free block too small");
-         CHECK(walk->next_free != walk, "Self-loop detected in free list");
-
-         mm_pool_desc_t* desc = pool_desc_for_block(ctrl, walk);
-         CHECK(desc != NULL, "Free list block not contained by any pool");
-         CHECK((uintptr_t)walk >= (uintptr_t)desc->start, "Free list block outside pool start");
-         CHECK((uintptr_t)walk < (uintptr_t)desc->end, "Free list block outside pool end");
+         CHECK(free_next(walk) != walk, "Self-loop detected in free list");
 
          /* Prev-physical linkage: next block must mark prev as free and point back. */
          tlsf_block_t* phys_next = block_next_safe(ctrl, walk);
@@ -754,13 +1378,14 @@ int mm_validate(tlsf_t tlsf) {
          free_list_bytes += block_size(walk);
 
          list_prev = walk;
-         walk = walk->next_free;
+         walk = free_next(walk);
        }
 
     }
   }
 
   CHECK(phys_free_bytes == ctrl->current_free_size, "current_free_size mismatch");
+  CHECK(phys_used_bytes == ctrl->stats.bytes_in_use, "bytes_in_use mismatch");
   CHECK(phys_free_bytes == free_list_bytes, "Free list bytes mismatch");
   CHECK(phys_free_blocks == free_list_blocks, "Free list blocks mismatch");
 
@@ -774,21 +1399,17 @@ int mm_validate(tlsf_t tlsf) {
   return 1;
 }
 
-int mm_validate_pool(pool_t pool) {
-  if (!pool) return 0;
-
-  mm_pool_desc_t* desc = pool_desc_from_global(pool);
-  if (!desc) return 0;
+static int validate_pool_impl(mm_pool_desc_t* desc) {
   if (!desc->active) return 0;
-  if (!desc->start || !desc->end) return 0;
+  if (!pool_start(desc) || !pool_end(desc)) return 0;
   if (desc->bytes == 0) return 0;
-  if (desc->end != (desc->start + (ptrdiff_t)desc->bytes)) return 0;
+  if (pool_end(desc) != (pool_start(desc) + (ptrdiff_t)desc->bytes)) return 0;
 
-  tlsf_block_t* block = (tlsf_block_t*)desc->start;
-  tlsf_block_t* epilogue = (tlsf_block_t*)(desc->end - BLOCK_HEADER_OVERHEAD);
+  tlsf_block_t* block = (tlsf_block_t*)pool_start(desc);
+  tlsf_block_t* epilogue = (tlsf_block_t*)(pool_end(desc) - BLOCK_HEADER_OVERHEAD);
 
-  if ((uintptr_t)desc->start % ALIGNMENT != 0) return 0;
-  if ((uintptr_t)desc->end % ALIGNMENT != 0) return 0;
+  if ((uintptr_t)pool_start(desc) % ALIGNMENT != 0) return 0;
+  if ((uintptr_t)pool_end(desc) % ALIGNMENT != 0) return 0;
 
   if (block_is_free(epilogue)) return 0;
   if (block_size(epilogue) != 0) return 0;
@@ -848,6 +1469,14 @@ int mm_validate_pool(pool_t pool) {
   return 1;
 }
 
+int mm_validate_pool(pool_t pool) {
+  if (!pool) return 0;
+
+  mm_pool_desc_t* desc = pool_desc_from_global(pool);
+  if (!desc) return 0;
+  return validate_pool_impl(desc);
+}
+
 int mm_check(tlsf_t alloc) {
   return mm_validate(alloc) ? 0 : 1;
 }
@@ -868,7 +1497,7 @@ static void mm_check_integrity(mm_allocator_t* ctrl) {
   static size_t counter = 0;
   counter++;
   if ((counter & (((size_t)1u << MM_DEBUG_VALIDATE_SHIFT) - 1u)) == 0) {
-    assert(mm_validate(ctrl) && "Heap integrity check failed");
+    assert(validate_impl(ctrl) && "Heap integrity check failed");
   }
 }
 #else
@@ -876,35 +1505,278 @@ static void mm_check_integrity(mm_allocator_t* ctrl) {
 #endif
 
 /*
-** Public API.
+** Slab front end (MM_FLAG_SLAB).
+**
+** Requests up to MM_SLAB_MAX_SIZE are served from slabs: a slab header followed by equal slots, with a free-slot
+** bitmap instead of per-object headers. `mm_free`/`mm_realloc` recognise slab pointers by rounding down to the
+** slab alignment and binary-searching `slab_index` (a range check skips the search when no slab can match).
+** A slab that becomes empty is returned to the TLSF heap unless it is the only slab of its class with free slots.
 */
-tlsf_t mm_create(void* mem) {
-  /* Control-only create (TLSF-style): does not implicitly consume remaining bytes as a pool. */
-  if (!mem) return NULL;
-  /* Ensure provided memory is aligned. */
-  if ((uintptr_t)mem % ALIGNMENT != 0) return NULL;
+static inline unsigned int slab_class_for_size(size_t bytes) {
+  if (bytes <= 128) return (unsigned int)((bytes + 15) >> 4) - 1u;
+  if (bytes <= 256) return 8u + (unsigned int)((bytes - 129) >> 5);
+  return 12u + (unsigned int)((bytes - 257) >> 6);
+}
 
-  mm_allocator_t* allocator = (mm_allocator_t*)mem;
-  memset(allocator, 0, sizeof(mm_allocator_t));
+static inline unsigned char* slab_slots(mm_slab_t* slab) {
+  return (unsigned char*)slab + MM_SLAB_HEADER_BYTES;
+}
 
-  return (tlsf_t)allocator;
+static mm_slab_t* slab_lookup(mm_allocator_t* ctrl, const void* ptr) {
+  unsigned int n = ctrl->slab_count;
+  if (!n) return NULL;
+  uintptr_t base = (uintptr_t)ptr & ~(uintptr_t)(MM_SLAB_BYTES - 1);
+  if (base < (uintptr_t)ctrl->slab_index[0] || base > (uintptr_t)ctrl->slab_index[n - 1]) return NULL;
+
+  mm_slab_t* const* index = ctrl->slab_index;
+  unsigned int lo = 0;
+  while (n > 1) {
+    unsigned int half = n >> 1;
+    lo = ((uintptr_t)index[lo + half] <= base) ? lo + half : lo;
+    n -= half;
+  }
+  return ((uintptr_t)index[lo] == base) ? index[lo] : NULL;
 }
 
-tlsf_t mm_create_with_pool(void* mem, size_t bytes) {
+static void slab_partial_push(mm_allocator_t* ctrl, mm_slab_t* slab) {
+  mm_slab_t* head = ctrl->slab_partial[slab->cls];
+  slab->prev_partial = NULL;
+  slab->next_partial = head;
+  if (head) head->prev_partial = slab;
+  ctrl->slab_partial[slab->cls] = slab;
+}
+
+static void slab_partial_remove(mm_allocator_t* ctrl, mm_slab_t* slab) {
+  if (slab->prev_partial) slab->prev_partial->next_partial = slab->next_partial;
+  else ctrl->slab_partial[slab->cls] = slab->next_partial;
+  if (slab->next_partial) slab->next_partial->prev_partial = slab->prev_partial;
+  slab->next_partial = NULL;
+  slab->prev_partial = NULL;
+}
+
+static void* memalign_impl(mm_allocator_t* ctrl, size_t align, size_t bytes);
+static int free_impl(mm_allocator_t* ctrl, void* ptr);
+
+static mm_slab_t* slab_create(mm_allocator_t* ctrl, unsigned int cls) {
+  if (ctrl->slab_count >= MM_SLAB_MAX) return NULL;
+  mm_slab_t* slab = (mm_slab_t*)memalign_impl(ctrl, MM_SLAB_BYTES, MM_SLAB_BYTES);
+  if (!slab) return NULL;
+
+  memset(slab, 0, sizeof(*slab));
+  slab->cls = cls;
+  slab->slot_size = g_slab_class_size[cls];
+  slab->capacity = (unsigned int)((MM_SLAB_BYTES - MM_SLAB_HEADER_BYTES) / slab->slot_size);
+  slab->free_count = slab->capacity;
+  for (unsigned int i = 0; i < slab->capacity; i++) slab->free_bits[i >> 6] |= (uint64_t)1 << (i & 63);
+
+  unsigned int i = ctrl->slab_count;
+  while (i > 0 && (uintptr_t)ctrl->slab_index[i - 1] > (uintptr_t)slab) {
+    ctrl->slab_index[i] = ctrl->slab_index[i - 1];
+    i--;
+  }
+  ctrl->slab_index[i] = slab;
+  ctrl->slab_count++;
+  slab_partial_push(ctrl, slab);
+  return slab;
+}
+
+static void slab_release(mm_allocator_t* ctrl, mm_slab_t* slab) {
+  slab_partial_remove(ctrl, slab);
+  unsigned int n = ctrl->slab_count;
+  for (unsigned int i = 0; i < n; i++) {
+    if (ctrl->slab_index[i] != slab) continue;
+    memmove(&ctrl->slab_index[i], &ctrl->slab_index[i + 1], (n - i - 1) * sizeof(mm_slab_t*));
+    ctrl->slab_count--;
+    break;
+  }
+  /* No longer indexed, so this takes the plain TLSF path. */
+  free_impl(ctrl, slab);
+}
+
+static void slab_release_empty(mm_allocator_t* ctrl) {
+  for (unsigned int cls = 0; cls < MM_SLAB_CLASS_COUNT; cls++) {
+    mm_slab_t* slab = ctrl->slab_partial[cls];
+    while (slab) {
+      mm_slab_t* next = slab->next_partial;
+      if (slab->free_count == slab->capacity) slab_release(ctrl, slab);
+      slab = next;
+    }
+  }
+}
+
+static void* slab_malloc(mm_allocator_t* ctrl, size_t bytes) {
+  unsigned int cls = slab_class_for_size(bytes);
+  mm_slab_t* slab = ctrl->slab_partial[cls];
+  if (!slab) slab = slab_create(ctrl, cls);
+  if (!slab) return NULL;
+
+  unsigned int w = 0;
+  while (!slab->free_bits[w]) w++; /* bounded by MM_SLAB_BITMAP_WORDS; free_count > 0 guarantees a hit */
+  unsigned int bit = (unsigned int)__builtin_ctzll(slab->free_bits[w]);
+  slab->free_bits[w] &= ~((uint64_t)1 << bit);
+  if (--slab->free_count == 0) slab_partial_remove(ctrl, slab);
+
+  return slab_slots(slab) + (size_t)((w << 6) + bit) * slab->slot_size;
+}
+
+/* Returns 1 if `ptr` was a slab pointer (freed or rejected), 0 if it belongs to the TLSF path. */
+static int slab_free(mm_allocator_t* ctrl, mm_slab_t* slab, void* ptr) {
+  uintptr_t offset = (uintptr_t)ptr - (uintptr_t)slab_slots(slab);
+  if ((uintptr_t)ptr < (uintptr_t)slab_slots(slab) || (offset % slab->slot_size) != 0 ||
+      offset / slab->slot_size >= slab->capacity) {
+#ifdef MM_DEBUG
+    if (MM_DEBUG_ABORT_ON_INVALID_POINTER) assert(!"mm_free: invalid slab pointer");
+#endif
+    return 1;
+  }
+
+  unsigned int idx = (unsigned int)(offset / slab->slot_size);
+  uint64_t mask = (uint64_t)1 << (idx & 63);
+  if (slab->free_bits[idx >> 6] & mask) {
+#ifdef MM_DEBUG
+    if (MM_DEBUG_ABORT_ON_DOUBLE_FREE) assert(!"mm_free: double free");
+#endif
+    return 1;
+  }
+
+  slab->free_bits[idx >> 6] |= mask;
+  if (slab->free_count++ == 0) slab_partial_push(ctrl, slab);
+
+  /* Keep one slab with free slots per class cached so alloc/free ping-pong does not churn the heap. */
+  if (slab->free_count == slab->capacity &&
+      (ctrl->slab_partial[slab->cls] != slab || slab->next_partial)) {
+    slab_release(ctrl, slab);
+  }
+  return 1;
+}
+
+/*
+** Public API.
+*/
+tlsf_t mm_create_ex(void* mem, unsigned int flags) {
+  /* Control-only create (TLSF-style): does not implicitly consume remaining bytes as a pool. */
+  if (!mem) return NULL;
+  /* Ensure provided memory is aligned. */
+  if ((uintptr_t)mem % ALIGNMENT != 0) return NULL;
+  if ((flags & ~MM_FLAG_MASK) != 0) return NULL;
+  if (flags & MM_FLAG_SHARED) {
+    /* Other processes map the heap elsewhere: links must be relative, and slab pointers never are. */
+    if (!MM_RELATIVE_LINKS || (flags & (MM_FLAG_SLAB | MM_FLAG_REMOTE_FREE))) return NULL;
+    flags |= MM_FLAG_THREAD_SAFE;
+  }
+  /* Remote frees are drained under the lock, possibly while other threads allocate. */
+  if (flags & MM_FLAG_REMOTE_FREE) flags |= MM_FLAG_THREAD_SAFE;
+
+  mm_allocator_t* allocator = (mm_allocator_t*)mem;
+  memset(allocator, 0, sizeof(mm_allocator_t));
+  allocator->flags = flags;
+  allocator->signature = layout_signature();
+  allocator->base = mem;
+  allocator->owner_thread = mm_thread_id();
+
+  return (tlsf_t)allocator;
+}
+
+/*
+** Reopening a heap (`mm_attach`).
+**
+** The bytes of a heap are self-describing: the control block sits at `mem`, every pool must lie inside
+** [mem, mem + bytes), and with MM_RELATIVE_LINKS every link is relative, so a heap written to a file-backed
+** mapping can be mapped again (anywhere) after a restart. Attaching checks the layout signature and pool bounds,
+** drops the state that belonged to the previous process (lock, trace hook, handle table, registry links) and runs
+** the full `mm_validate` walk before handing the heap out.
+*/
+tlsf_t mm_attach(void* mem, size_t bytes) {
+  if (!mem || (uintptr_t)mem % ALIGNMENT != 0 || bytes < MM_CONTROL_BYTES) return NULL;
+  mm_allocator_t* ctrl = (mm_allocator_t*)mem;
+  if (ctrl->signature != layout_signature()) return NULL;
+  if ((ctrl->flags & ~MM_FLAG_MASK) != 0) return NULL;
+  /* Slab pointers are absolute; so are all links in a default build, which only reattach at the same address. */
+  if (ctrl->flags & MM_FLAG_SLAB) return NULL;
+  if (!MM_RELATIVE_LINKS && ctrl->base != mem) return NULL;
+
+  uintptr_t lo = (uintptr_t)mem + MM_CONTROL_BYTES;
+  uintptr_t hi = (uintptr_t)mem + bytes;
+  if (hi < lo) return NULL;
+  for (size_t i = 0; i < MM_MAX_POOLS; i++) {
+    mm_pool_desc_t* desc = &ctrl->pools[i];
+    if (!desc->active) continue;
+    uintptr_t start = (uintptr_t)pool_start(desc);
+    uintptr_t end = (uintptr_t)pool_end(desc);
+    if (start < lo || end > hi || end <= start || end - start != desc->bytes) return NULL;
+    /* A pool already registered by another live instance is not ours to take over. */
+    mm_pool_desc_t* live = pool_desc_from_global((pool_t)start);
+    if (live && live != desc) return NULL;
+  }
+
+  ctrl->lock_next = 0;
+  ctrl->lock_owner = 0;
+  ctrl->trace_hook = NULL;
+  ctrl->trace_user = NULL;
+  ctrl->handles = NULL;
+  /* Blocks queued by threads of the previous process stay allocated (leaked), never half-drained. */
+  ctrl->remote_head = NULL;
+  ctrl->owner_thread = mm_thread_id();
+  /*
+  ** Links left by another process are meaningless here. A heap still registered in this process (attached again in
+  ** place) is unlinked properly first: clearing a link mid-list would cut off every pool behind it.
+  */
+  for (size_t i = 0; i < MM_MAX_POOLS; i++) {
+    mm_pool_desc_t* desc = &ctrl->pools[i];
+    if (desc->active && pool_desc_from_global((pool_t)pool_start(desc)) == desc) pool_registry_remove(desc);
+    desc->next_global = NULL;
+  }
+  if (!validate_impl(ctrl)) return NULL;
+
+  ctrl->base = mem;
+  if (!(ctrl->flags & MM_FLAG_SHARED)) {
+    for (size_t i = 0; i < MM_MAX_POOLS; i++) {
+      if (ctrl->pools[i].active) pool_registry_add(&ctrl->pools[i]);
+    }
+  }
+  return (tlsf_t)ctrl;
+}
+
+void mm_set_root(tlsf_t tlsf, void* root) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return;
+  mm_lock(ctrl);
+  LINK_STORE(ctrl->root, root);
+  mm_unlock(ctrl);
+}
+
+void* mm_get_root(tlsf_t tlsf) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  mm_lock(ctrl);
+  void* root = LINK_LOAD(void, ctrl->root);
+  mm_unlock(ctrl);
+  return root;
+}
+
+tlsf_t mm_create(void* mem) {
+  return mm_create_ex(mem, 0);
+}
+
+tlsf_t mm_create_with_pool_ex(void* mem, size_t bytes, unsigned int flags) {
   /* Overhead: allocator + alignment padding + min block + epilogue. */
-  size_t overhead = sizeof(mm_allocator_t) + ALIGNMENT + BLOCK_HEADER_OVERHEAD + BLOCK_HEADER_OVERHEAD;
+  size_t overhead = MM_CONTROL_BYTES + ALIGNMENT + BLOCK_HEADER_OVERHEAD + BLOCK_HEADER_OVERHEAD;
   if (bytes < overhead + TLSF_MIN_BLOCK_SIZE) return NULL;
 
-  tlsf_t tlsf = mm_create(mem);
+  tlsf_t tlsf = mm_create_ex(mem, flags);
   if (!tlsf) return NULL;
 
-  void* pool_mem = (char*)mem + sizeof(mm_allocator_t);
-  size_t pool_bytes = bytes - sizeof(mm_allocator_t);
+  void* pool_mem = (char*)mem + MM_CONTROL_BYTES;
+  size_t pool_bytes = bytes - MM_CONTROL_BYTES;
 
   if (!mm_add_pool(tlsf, pool_mem, pool_bytes)) return NULL;
   return tlsf;
 }
 
+tlsf_t mm_create_with_pool(void* mem, size_t bytes) {
+  return mm_create_with_pool_ex(mem, bytes, 0);
+}
+
 tlsf_t mm_init_in_place(void* mem, size_t bytes) {
   return mm_create_with_pool(mem, bytes);
 }
@@ -913,6 +1785,7 @@ void mm_destroy(tlsf_t alloc) {
   /* No-op by design: caller owns all memory and core never calls OS APIs. */
   mm_allocator_t* allocator = (mm_allocator_t*)alloc;
   if (!allocator) return;
+  /* Only unregisters pools; the caller must have quiesced every thread using this instance. */
   for (size_t i = 0; i < MM_MAX_POOLS; i++) {
     if (!allocator->pools[i].active) continue;
     pool_registry_remove(&allocator->pools[i]);
@@ -922,12 +1795,12 @@ void mm_destroy(tlsf_t alloc) {
 /*
 ** Extensions.
 */
-int mm_reset(tlsf_t tlsf) {
-  mm_allocator_t* allocator = (mm_allocator_t*)tlsf;
-  if (!allocator) return 0;
-
+static int reset_impl(mm_allocator_t* allocator) {
   /* Refuse to reset if the heap is already inconsistent. */
-  if (!mm_validate(tlsf)) return 0;
+  if (!validate_impl(allocator)) return 0;
+
+  /* Cached empty slabs are not user allocations. */
+  slab_release_empty(allocator);
 
   /* Refuse to reset if any live allocation exists in any pool. */
   for (size_t i = 0; i < MM_MAX_POOLS; i++) {
@@ -941,17 +1814,18 @@ int mm_reset(tlsf_t tlsf) {
   memset(allocator->sl_bitmap, 0, sizeof(allocator->sl_bitmap));
   memset(allocator->blocks, 0, sizeof(allocator->blocks));
   allocator->current_free_size = 0;
+  allocator->stats.bytes_in_use = 0;
 
   for (size_t i = 0; i < MM_MAX_POOLS; i++) {
     mm_pool_desc_t* desc = &allocator->pools[i];
     if (!desc->active) continue;
 
-    tlsf_block_t* epilogue = (tlsf_block_t*)(desc->end - BLOCK_HEADER_OVERHEAD);
+    tlsf_block_t* epilogue = (tlsf_block_t*)(pool_end(desc) - BLOCK_HEADER_OVERHEAD);
     block_set_size(epilogue, 0);
     block_set_used(epilogue);
     block_set_prev_free(epilogue);
 
-    tlsf_block_t* block = (tlsf_block_t*)desc->start;
+    tlsf_block_t* block = (tlsf_block_t*)pool_start(desc);
     size_t size = (size_t)((char*)epilogue - (char*)block - BLOCK_HEADER_OVERHEAD);
     if (size < TLSF_MIN_BLOCK_SIZE) return 0;
 
@@ -965,21 +1839,18 @@ int mm_reset(tlsf_t tlsf) {
     desc->live_allocations = 0;
   }
 
-  return mm_validate(tlsf);
+  return validate_impl(allocator);
 }
 
-pool_t mm_get_pool(tlsf_t tlsf) {
-  mm_allocator_t* allocator = (mm_allocator_t*)tlsf;
-  if (!allocator) return NULL;
+static pool_t get_pool_impl(mm_allocator_t* allocator) {
   for (size_t i = 0; i < MM_MAX_POOLS; i++) {
-    if (allocator->pools[i].active) return (pool_t)allocator->pools[i].start;
+    if (allocator->pools[i].active) return (pool_t)pool_start(&allocator->pools[i]);
   }
   return NULL;
 }
 
-pool_t mm_get_pool_for_ptr(tlsf_t tlsf, const void* ptr) {
-  mm_allocator_t* allocator = (mm_allocator_t*)tlsf;
-  if (!allocator || !ptr) return NULL;
+static pool_t get_pool_for_ptr_impl(mm_allocator_t* allocator, const void* ptr) {
+  if (!ptr) return NULL;
 
   uintptr_t user_addr = (uintptr_t)ptr;
   if (user_addr < (uintptr_t)BLOCK_START_OFFSET) return NULL;
@@ -987,18 +1858,12 @@ pool_t mm_get_pool_for_ptr(tlsf_t tlsf, const void* ptr) {
   uintptr_t block_addr = user_addr - (uintptr_t)BLOCK_START_OFFSET;
   if ((block_addr % (uintptr_t)ALIGNMENT) != 0) return NULL;
 
-  for (size_t i = 0; i < MM_MAX_POOLS; i++) {
-    mm_pool_desc_t* p = &allocator->pools[i];
-    if (!p->active) continue;
-    if (block_addr >= (uintptr_t)p->start && block_addr < (uintptr_t)p->end) return (pool_t)p->start;
-  }
-
-  return NULL;
+  mm_pool_desc_t* desc = pool_desc_for_addr(allocator, block_addr);
+  return desc ? (pool_t)pool_start(desc) : NULL;
 }
 
-pool_t mm_add_pool(tlsf_t tlsf, void* mem, size_t bytes) {
-  mm_allocator_t* allocator = (mm_allocator_t*)tlsf;
-  if (!allocator || !mem) return NULL;
+static pool_t add_pool_impl(mm_allocator_t* allocator, void* mem, size_t bytes) {
+  if (!mem) return NULL;
 
   size_t overhead = ALIGNMENT + BLOCK_HEADER_OVERHEAD + BLOCK_HEADER_OVERHEAD;
   if (bytes < overhead + TLSF_MIN_BLOCK_SIZE) return NULL;
@@ -1006,21 +1871,22 @@ pool_t mm_add_pool(tlsf_t tlsf, void* mem, size_t bytes) {
   uintptr_t start_addr = (uintptr_t)mem;
   if ((start_addr % ALIGNMENT) != 0) return NULL;
   if ((bytes % ALIGNMENT) != 0) return NULL;
+  /* The pool becomes one free block, which must map to a first-level class. */
+  if (bytes - 2 * BLOCK_HEADER_OVERHEAD >= BLOCK_SIZE_MAX) return NULL;
 
-  char* pool_start = (char*)mem;
+  char* start = (char*)mem;
   size_t aligned_bytes = bytes;
 
   /* Ensure alignment does not eat too much space. */
   if (aligned_bytes < overhead + TLSF_MIN_BLOCK_SIZE) return NULL;
 
-  char* pool_end = pool_start + aligned_bytes;
+  char* end = start + aligned_bytes;
 
-  uintptr_t pool_start_addr = (uintptr_t)pool_start;
-  uintptr_t pool_end_addr = (uintptr_t)pool_end;
-  for (size_t i = 0; i < MM_MAX_POOLS; i++) {
-    mm_pool_desc_t* p = &allocator->pools[i];
-    if (!p->active) continue;
-    if (pool_start_addr < (uintptr_t)p->end && pool_end_addr > (uintptr_t)p->start) {
+  uintptr_t pool_start_addr = (uintptr_t)start;
+  uintptr_t pool_end_addr = (uintptr_t)end;
+  for (size_t i = 0; i < allocator->pool_count; i++) {
+    mm_pool_desc_t* p = &allocator->pools[allocator->pool_order[i]];
+    if (pool_start_addr < (uintptr_t)pool_end(p) && pool_end_addr > (uintptr_t)pool_start(p)) {
       return NULL;
     }
   }
@@ -1034,15 +1900,17 @@ pool_t mm_add_pool(tlsf_t tlsf, void* mem, size_t bytes) {
   }
   if (!desc) return NULL;
 
-  desc->start = pool_start;
-  desc->end = pool_end;
+  LINK_STORE(desc->start, start);
+  LINK_STORE(desc->end, end);
   desc->bytes = aligned_bytes;
   desc->live_allocations = 0;
   desc->active = 1;
-  pool_registry_add(desc);
+  /* The registry links descriptors with this process's addresses; shared heaps stay out of it. */
+  if (!(allocator->flags & MM_FLAG_SHARED)) pool_registry_add(desc);
+  pool_index_insert(allocator, desc);
 
   /* 1. Create epilogue sentinel. */
-  tlsf_block_t* epilogue = (tlsf_block_t*)(pool_end - BLOCK_HEADER_OVERHEAD);
+  tlsf_block_t* epilogue = (tlsf_block_t*)(end - BLOCK_HEADER_OVERHEAD);
   block_set_size(epilogue, 0);
   block_set_used(epilogue);
   block_set_prev_free(epilogue);
@@ -1053,7 +1921,7 @@ pool_t mm_add_pool(tlsf_t tlsf, void* mem, size_t bytes) {
   ** its size word, and falls outside the pool. We never dereference it because
   ** the first block is always marked prev-used.
   */
-  tlsf_block_t* block = (tlsf_block_t*)pool_start;
+  tlsf_block_t* block = (tlsf_block_t*)start;
   size_t size = (size_t)((char*)epilogue - (char*)block - BLOCK_HEADER_OVERHEAD);
 
   block_set_size(block, size);
@@ -1064,20 +1932,20 @@ pool_t mm_add_pool(tlsf_t tlsf, void* mem, size_t bytes) {
   insert_free_block(allocator, block);
   allocator->total_pool_size += aligned_bytes;
 
-  return (pool_t)pool_start;
+  return (pool_t)start;
 }
 
-void mm_remove_pool(tlsf_t tlsf, pool_t pool) {
-  mm_allocator_t* allocator = (mm_allocator_t*)tlsf;
-  if (!allocator || !pool) return;
+static void remove_pool_impl(mm_allocator_t* allocator, pool_t pool) {
+  if (!pool) return;
 
   mm_pool_desc_t* desc = pool_desc_from_handle(allocator, pool);
   if (!desc) return;
 
+  if (desc->live_allocations != 0) slab_release_empty(allocator);
   if (desc->live_allocations != 0) return;
 
-  tlsf_block_t* block = (tlsf_block_t*)desc->start;
-  tlsf_block_t* epilogue = (tlsf_block_t*)(desc->end - BLOCK_HEADER_OVERHEAD);
+  tlsf_block_t* block = (tlsf_block_t*)pool_start(desc);
+  tlsf_block_t* epilogue = (tlsf_block_t*)(pool_end(desc) - BLOCK_HEADER_OVERHEAD);
 
   size_t max_steps = (desc->bytes / ALIGNMENT) + 2;
   /* Preflight: refuse to remove if any used block exists (do not mutate state). */
@@ -1094,7 +1962,7 @@ void mm_remove_pool(tlsf_t tlsf, pool_t pool) {
   if ((uintptr_t)block != (uintptr_t)epilogue) return;
 
   /* Removal: every block in the pool is free, so remove free-list nodes. */
-  block = (tlsf_block_t*)desc->start;
+  block = (tlsf_block_t*)pool_start(desc);
   for (size_t i = 0; i < max_steps; i++) {
     size_t sz = block_size(block);
     if (sz == 0) break;
@@ -1108,18 +1976,16 @@ void mm_remove_pool(tlsf_t tlsf, pool_t pool) {
 
   allocator->total_pool_size -= desc->bytes;
   pool_registry_remove(desc);
+  pool_index_remove(allocator, desc);
   desc->active = 0;
-  desc->start = NULL;
-  desc->end = NULL;
+  LINK_STORE(desc->start, NULL);
+  LINK_STORE(desc->end, NULL);
   desc->bytes = 0;
   desc->live_allocations = 0;
 }
 
-void* mm_malloc(tlsf_t tlsf, size_t bytes) {
-  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
-  if (!ctrl || bytes == 0) return NULL;
-  mm_check_integrity(ctrl);
-
+/* The TLSF path of malloc_impl: always returns a block with a header (never a slab slot). */
+static void* malloc_block_impl(mm_allocator_t* ctrl, size_t bytes) {
   if (bytes < TLSF_MIN_BLOCK_SIZE) bytes = TLSF_MIN_BLOCK_SIZE;
   if (bytes >= BLOCK_SIZE_MAX) return NULL;
   if (bytes > SIZE_MAX - (ALIGNMENT - 1)) return NULL;
@@ -1131,11 +1997,18 @@ void* mm_malloc(tlsf_t tlsf, size_t bytes) {
   if (!block) return NULL;
 
   remove_free_block_direct(ctrl, block, fl, sl);
-  tlsf_block_t* remainder = split_block(ctrl, block, bytes);
-  if (remainder) {
-    /* Coalesce remainder with next block if it is free. */
-    remainder = coalesce(ctrl, remainder);
-    insert_free_block(ctrl, remainder);
+  tlsf_block_t* upper = cluster_from_top(ctrl, bytes) ? split_block_high(block, bytes) : NULL;
+  if (upper) {
+    /* The low rest keeps its place: its neighbours were already coalesced while it was free. */
+    insert_free_block(ctrl, block);
+    block = upper;
+  } else {
+    tlsf_block_t* remainder = split_block(ctrl, block, bytes);
+    if (remainder) {
+      /* Coalesce remainder with next block if it is free. */
+      remainder = coalesce(ctrl, remainder);
+      insert_free_block(ctrl, remainder);
+    }
   }
 
   block_set_used(block);
@@ -1143,6 +2016,7 @@ void* mm_malloc(tlsf_t tlsf, size_t bytes) {
   if (next) {
     block_set_prev_used(next);
   }
+  stats_add_in_use(ctrl, block_size(block));
 
   mm_pool_desc_t* pool_desc = pool_desc_for_block(ctrl, block);
 #ifdef MM_DEBUG
@@ -1156,11 +2030,80 @@ void* mm_malloc(tlsf_t tlsf, size_t bytes) {
   return block_to_user(block);
 }
 
-void mm_free(tlsf_t tlsf, void* ptr) {
-  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
-  if (!ptr || !ctrl) return;
+static void* malloc_impl(mm_allocator_t* ctrl, size_t bytes) {
+  if (bytes == 0) return NULL;
+  mm_check_integrity(ctrl);
+
+  if ((ctrl->flags & MM_FLAG_SLAB) && bytes <= MM_SLAB_MAX_SIZE) {
+    void* p = slab_malloc(ctrl, bytes);
+    if (p) return p;
+  }
+  return malloc_block_impl(ctrl, bytes);
+}
+
+/*
+** Unchecked free (MM_FLAG_UNCHECKED_FREE, or every instance with -DMM_UNCHECKED_FREE=1).
+**
+** Conte-style: trust the pointer and the block metadata. Mark free, merge prev (PREV_FREE + prev_phys), merge next
+** (the size-0 epilogue is never free, so no bound check is needed), relink the following block, insert. The only
+** pool work is the live-allocation count, and with a single pool that is a direct index. Invalid pointers and
+** double frees corrupt the heap instead of being ignored. MM_DEBUG builds always take the checked path.
+*/
+#ifndef MM_UNCHECKED_FREE
+#define MM_UNCHECKED_FREE 0
+#endif
+
+static inline int free_is_unchecked(const mm_allocator_t* ctrl) {
+#ifdef MM_DEBUG
+  (void)ctrl;
+  return 0;
+#else
+  return MM_UNCHECKED_FREE || (ctrl->flags & MM_FLAG_UNCHECKED_FREE) != 0;
+#endif
+}
+
+static void free_unchecked(mm_allocator_t* ctrl, void* ptr) {
+  tlsf_block_t* block = user_to_block(ptr);
+  size_t size = block_size(block);
+
+  mm_pool_desc_t* pool_desc =
+    (ctrl->pool_count == 1) ? &ctrl->pools[ctrl->pool_order[0]] : pool_desc_for_addr(ctrl, (uintptr_t)block);
+  if (pool_desc) pool_desc->live_allocations--;
+  ctrl->stats.bytes_in_use -= size;
+
+  block_set_free(block);
+  if (block_is_prev_free(block)) {
+    tlsf_block_t* prev = block_prev(block);
+    remove_free_block(ctrl, prev);
+    block_set_size(prev, block_size(prev) + BLOCK_HEADER_OVERHEAD + size);
+    block = prev;
+  }
+
+  tlsf_block_t* next = (tlsf_block_t*)((char*)block + BLOCK_HEADER_OVERHEAD + block_size(block));
+  if (block_is_free(next)) {
+    remove_free_block(ctrl, next);
+    block_set_size(block, block_size(block) + BLOCK_HEADER_OVERHEAD + block_size(next));
+    next = (tlsf_block_t*)((char*)block + BLOCK_HEADER_OVERHEAD + block_size(block));
+  }
+  block_set_prev_free(next);
+  block_set_prev(next, block);
+
+  insert_free_block(ctrl, block);
+}
+
+/* Returns 1 if a block was released, 0 for NULL and for rejected (foreign or already free) pointers. */
+static int free_impl(mm_allocator_t* ctrl, void* ptr) {
+  if (!ptr) return 0;
   mm_check_integrity(ctrl);
 
+  mm_slab_t* slab = slab_lookup(ctrl, ptr);
+  if (slab && slab_free(ctrl, slab, ptr)) return 1;
+
+  if (free_is_unchecked(ctrl)) {
+    free_unchecked(ctrl, ptr);
+    return 1;
+  }
+
   mm_pool_desc_t* pool_desc = NULL;
   tlsf_block_t* block = NULL;
   mm_ptr_check_t ptr_status = mm_ptr_to_block_checked(ctrl, ptr, &pool_desc, &block);
@@ -1168,11 +2111,11 @@ void mm_free(tlsf_t tlsf, void* ptr) {
 #ifdef MM_DEBUG
     if (ptr_status == MM_PTR_STALE_DOUBLE_FREE) {
       if (MM_DEBUG_ABORT_ON_DOUBLE_FREE) assert(!"mm_free: double free");
-      return;
+      return 0;
     }
     if (MM_DEBUG_ABORT_ON_INVALID_POINTER) assert(!"mm_free: invalid pointer");
 #endif
-    return;
+    return 0;
   }
 
   if (block_is_free(block)) {
@@ -1181,7 +2124,7 @@ void mm_free(tlsf_t tlsf, void* ptr) {
       assert(!"mm_free: double free");
     }
 #endif
-    return;
+    return 0;
   }
 
 #ifdef MM_DEBUG
@@ -1190,12 +2133,14 @@ void mm_free(tlsf_t tlsf, void* ptr) {
   if (pool_desc && pool_desc->live_allocations > 0) {
     pool_desc->live_allocations--;
   }
+  ctrl->stats.bytes_in_use -= block_size(block);
 
   block_mark_as_free(ctrl, block);
   block = coalesce(ctrl, block);
   /* Always insert the coalesced block into the free list. */
   insert_free_block(ctrl, block);
   mm_check_integrity(ctrl);
+  return 1;
 }
 
 static int try_realloc_inplace(mm_allocator_t* ctrl, void* ptr, size_t size) {
@@ -1220,6 +2165,7 @@ static int try_realloc_inplace(mm_allocator_t* ctrl, void* ptr, size_t size) {
         remainder = coalesce(ctrl, remainder);
         insert_free_block(ctrl, remainder);
       }
+      ctrl->stats.bytes_in_use -= current_size - block_size(block);
       mm_check_integrity(ctrl);
       return 0;
     }
@@ -1245,6 +2191,7 @@ static int try_realloc_inplace(mm_allocator_t* ctrl, void* ptr, size_t size) {
           remainder = coalesce(ctrl, remainder);
           insert_free_block(ctrl, remainder);
         }
+        stats_add_in_use(ctrl, block_size(block) - current_size);
         mm_check_integrity(ctrl);
         return 0;
       }
@@ -1254,17 +2201,70 @@ static int try_realloc_inplace(mm_allocator_t* ctrl, void* ptr, size_t size) {
   return -1;
 }
 
-void* mm_realloc(tlsf_t tlsf, void* ptr, size_t size) {
-  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
-  if (!ptr) return mm_malloc(tlsf, size);
+/*
+** Grow backwards: absorb a free previous block (and a free next block if the previous one alone is too small),
+** then slide the payload down with `memmove`. Costs the same copy as malloc+memcpy+free but no free-list search,
+** and the block grows into its own neighbourhood instead of leaving a hole behind. Returns NULL if the neighbours
+** cannot hold `size`.
+*/
+static void* try_realloc_backward(mm_allocator_t* ctrl, tlsf_block_t* block, size_t size) {
+  if (!block_is_prev_free(block)) return NULL;
+  tlsf_block_t* prev = block_prev(block);
+  if (!block_is_free(prev) || block_next_safe(ctrl, prev) != block) return NULL;
+
+  if (size < TLSF_MIN_BLOCK_SIZE) size = TLSF_MIN_BLOCK_SIZE;
+  size_t aligned_size = align_size(size);
+  size_t current_size = block_size(block);
+  size_t combined = block_size(prev) + BLOCK_HEADER_OVERHEAD + current_size;
+
+  tlsf_block_t* next = block_next_safe(ctrl, block);
+  int take_next = 0;
+  if (combined < aligned_size) {
+    if (!next || !block_is_free(next)) return NULL;
+    combined += BLOCK_HEADER_OVERHEAD + block_size(next);
+    if (combined < aligned_size) return NULL;
+    take_next = 1;
+  }
+
+  remove_free_block(ctrl, prev);
+  if (take_next) remove_free_block(ctrl, next);
+  block_set_size(prev, combined);
+  block_set_used(prev);
+  tlsf_block_t* after = block_next_safe(ctrl, prev);
+  if (after) block_set_prev_used(after);
+
+  /* Move before splitting: the remainder header may land on the old payload. */
+  void* moved = block_to_user(prev);
+  memmove(moved, block_to_user(block), current_size);
+
+  tlsf_block_t* remainder = split_block(ctrl, prev, aligned_size);
+  if (remainder) {
+    block_mark_as_free(ctrl, remainder);
+    remainder = coalesce(ctrl, remainder);
+    insert_free_block(ctrl, remainder);
+  }
+  stats_add_in_use(ctrl, block_size(prev) - current_size);
+  mm_check_integrity(ctrl);
+  return moved;
+}
+
+static void* realloc_impl(mm_allocator_t* ctrl, void* ptr, size_t size) {
+  if (!ptr) return malloc_impl(ctrl, size);
   if (size == 0) {
-    mm_free(tlsf, ptr);
+    free_impl(ctrl, ptr);
     return NULL;
   }
 
-#ifdef MM_DEBUG
-  if (!ctrl) return NULL;
-#endif
+  mm_slab_t* slab = slab_lookup(ctrl, ptr);
+  if (slab) {
+    if (size <= slab->slot_size) return ptr;
+    void* moved = malloc_impl(ctrl, size);
+    if (moved) {
+      memcpy(moved, ptr, slab->slot_size);
+      free_impl(ctrl, ptr);
+    }
+    return moved;
+  }
 
   mm_pool_desc_t* pool_desc = NULL;
   tlsf_block_t* block = NULL;
@@ -1291,24 +2291,24 @@ void* mm_realloc(tlsf_t tlsf, void* ptr, size_t size) {
   }
 
   /* Status 1: needs move. */
+  void* moved = try_realloc_backward(ctrl, block, size);
+  if (moved) return moved;
 
-  void* new_ptr = mm_malloc(tlsf, size);
+  void* new_ptr = malloc_impl(ctrl, size);
   if (new_ptr) {
     size_t old_usable = block_size(block);
     memcpy(new_ptr, ptr, (old_usable < size) ? old_usable : size);
-    mm_free(tlsf, ptr);
+    free_impl(ctrl, ptr);
   }
   return new_ptr;
 }
 
-void* mm_memalign(tlsf_t tlsf, size_t align, size_t bytes) {
-  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
-  if (!ctrl) return NULL;
+static void* memalign_impl(mm_allocator_t* ctrl, size_t align, size_t bytes) {
   if (align == 0 || (align & (align - 1)) != 0) return NULL; /* must be power of two */
   if (bytes == 0) return NULL;
 
   /* If alignment is <= default alignment, regular malloc suffices. */
-  if (align <= ALIGNMENT) return mm_malloc(tlsf, bytes);
+  if (align <= ALIGNMENT) return malloc_impl(ctrl, bytes);
 
   mm_check_integrity(ctrl);
 
@@ -1399,6 +2399,7 @@ void* mm_memalign(tlsf_t tlsf, size_t align, size_t bytes) {
   if (next) {
     block_set_prev_used(next);
   }
+  stats_add_in_use(ctrl, block_size(aligned_block));
 
   mm_pool_desc_t* pool_desc = pool_desc_for_block(ctrl, aligned_block);
 #ifdef MM_DEBUG
@@ -1412,27 +2413,1292 @@ void* mm_memalign(tlsf_t tlsf, size_t align, size_t bytes) {
   return block_to_user(aligned_block);
 }
 
-size_t mm_block_size(void* ptr) {
-  if (!ptr) return 0;
-  tlsf_block_t* block = user_to_block(ptr);
-  return block_size(block);
+/*
+** Batch operations.
+**
+** `malloc_batch_impl` carves n equal blocks out of one free block: one bitmap search, one free-list removal and
+** one split for the tail, instead of n of each. `free_batch_impl` expects address-sorted pointers and turns every
+** run of physically adjacent blocks into a single free block before coalescing and inserting it once.
+*/
+static size_t malloc_batch_fallback(mm_allocator_t* ctrl, size_t bytes, size_t n, void** out) {
+  size_t got = 0;
+  while (got < n) {
+    void* p = malloc_impl(ctrl, bytes);
+    if (!p) break;
+    out[got++] = p;
+  }
+  return got;
 }
 
-size_t mm_size(void) {
-  return sizeof(mm_allocator_t);
+static size_t malloc_batch_impl(mm_allocator_t* ctrl, size_t bytes, size_t n, void** out) {
+  if (bytes == 0 || n == 0) return 0;
+  if ((ctrl->flags & MM_FLAG_SLAB) && bytes <= MM_SLAB_MAX_SIZE) return malloc_batch_fallback(ctrl, bytes, n, out);
+  mm_check_integrity(ctrl);
+
+  if (bytes < TLSF_MIN_BLOCK_SIZE) bytes = TLSF_MIN_BLOCK_SIZE;
+  if (bytes >= BLOCK_SIZE_MAX) return 0;
+  bytes = align_size(bytes);
+
+  /* Each object after the first brings its own header: total = n * (size + header) - header. */
+  const size_t stride = bytes + BLOCK_HEADER_OVERHEAD;
+  if (n > (BLOCK_SIZE_MAX - ALIGNMENT) / stride) return malloc_batch_fallback(ctrl, bytes, n, out);
+  const size_t total = n * stride - BLOCK_HEADER_OVERHEAD;
+
+  int fl, sl;
+  tlsf_block_t* block = search_suitable_block(ctrl, total, &fl, &sl);
+  if (!block) return malloc_batch_fallback(ctrl, bytes, n, out);
+  remove_free_block_direct(ctrl, block, fl, sl);
+
+  /* The chosen block was free, so its predecessor is used and it keeps its own (prev-used) flags. */
+  const size_t avail = block_size(block);
+  tlsf_block_t* cur = block;
+  for (size_t i = 0; i + 1 < n; i++) {
+    if (i == 0) {
+      block_set_size(cur, bytes);
+      block_set_used(cur);
+    } else {
+      cur->size = bytes; /* used, prev used */
+    }
+    out[i] = block_to_user(cur);
+    cur = (tlsf_block_t*)((char*)cur + stride);
+  }
+
+  /* The last object inherits the tail and gives back whatever is left through the regular split path. */
+  if (n == 1) {
+    block_set_used(cur);
+  } else {
+    cur->size = avail - (n - 1) * stride;
+  }
+  tlsf_block_t* remainder = split_block(ctrl, cur, bytes);
+  if (remainder) {
+    remainder = coalesce(ctrl, remainder);
+    insert_free_block(ctrl, remainder);
+  } else {
+    tlsf_block_t* next = block_next_safe(ctrl, cur);
+    if (next) block_set_prev_used(next);
+  }
+  out[n - 1] = block_to_user(cur);
+
+  stats_add_in_use(ctrl, (n - 1) * bytes + block_size(cur));
+  mm_pool_desc_t* pool_desc = pool_desc_for_block(ctrl, block);
+#ifdef MM_DEBUG
+  assert(pool_desc && "batch allocation returned a block outside any pool");
+#endif
+  if (pool_desc) pool_desc->live_allocations += n;
+
+  mm_check_integrity(ctrl);
+  return n;
 }
 
-size_t mm_align_size(void) {
-  return ALIGNMENT;
+static void free_batch_flush_run(mm_allocator_t* ctrl, mm_pool_desc_t* pool_desc, tlsf_block_t* first,
+                                 tlsf_block_t* last, size_t count, size_t used_bytes) {
+  pool_desc->live_allocations = (pool_desc->live_allocations >= count) ? pool_desc->live_allocations - count : 0;
+  ctrl->stats.bytes_in_use -= used_bytes;
+
+  if (last != first) {
+    size_t span = (size_t)((char*)last - (char*)first) + block_size(last);
+    block_set_size(first, span);
+  }
+  block_mark_as_free(ctrl, first);
+  first = coalesce(ctrl, first);
+  insert_free_block(ctrl, first);
 }
 
-size_t mm_block_size_min(void) {
-  return TLSF_MIN_BLOCK_SIZE;
+/* Returns the number of blocks released; NULLs, duplicates and rejected pointers are skipped. */
+static size_t free_batch_impl(mm_allocator_t* ctrl, void** ptrs, size_t n) {
+  mm_check_integrity(ctrl);
+  size_t released = 0;
+
+  mm_pool_desc_t* run_pool = NULL;
+  tlsf_block_t* run_first = NULL;
+  tlsf_block_t* run_last = NULL;
+  size_t run_count = 0;
+  size_t run_bytes = 0;
+  void* prev_ptr = NULL;
+
+  for (size_t i = 0; i < n; i++) {
+    void* ptr = ptrs[i];
+    if (!ptr || ptr == prev_ptr) continue; /* sorted, so duplicates (double frees) are adjacent */
+    prev_ptr = ptr;
+
+    mm_slab_t* slab = slab_lookup(ctrl, ptr);
+    if (slab && slab_free(ctrl, slab, ptr)) {
+      released++;
+      continue;
+    }
+
+    mm_pool_desc_t* pool_desc = NULL;
+    tlsf_block_t* block = NULL;
+    if (mm_ptr_to_block_checked(ctrl, ptr, &pool_desc, &block) != MM_PTR_OK || block_is_free(block)) {
+#ifdef MM_DEBUG
+      if (MM_DEBUG_ABORT_ON_INVALID_POINTER) assert(!"mm_free_batch: invalid pointer");
+#endif
+      continue;
+    }
+    released++;
+
+    if (run_first && pool_desc == run_pool && block == block_next_safe(ctrl, run_last)) {
+      run_last = block;
+      run_count++;
+      run_bytes += block_size(block);
+      continue;
+    }
+
+    if (run_first) free_batch_flush_run(ctrl, run_pool, run_first, run_last, run_count, run_bytes);
+    run_pool = pool_desc;
+    run_first = run_last = block;
+    run_count = 1;
+    run_bytes = block_size(block);
+  }
+
+  if (run_first) free_batch_flush_run(ctrl, run_pool, run_first, run_last, run_count, run_bytes);
+  mm_check_integrity(ctrl);
+  return released;
 }
 
-size_t mm_block_size_max(void) {
-  /* Must be < BLOCK_SIZE_MAX and remain aligned after rounding. */
-  return BLOCK_SIZE_MAX - ALIGNMENT;
+static int ptr_addr_compare(const void* a, const void* b) {
+  uintptr_t pa = (uintptr_t)*(void* const*)a;
+  uintptr_t pb = (uintptr_t)*(void* const*)b;
+  return (pa > pb) - (pa < pb);
+}
+
+/*
+** Remote frees (MM_FLAG_REMOTE_FREE).
+**
+** A free from any thread but the owner does not take the lock: it pushes the pointer onto `remote_head`, an MPSC
+** Treiber stack linked through the first word of each payload (CAS push only; the consumer detaches the whole
+** stack with one exchange, so there is no ABA). A drain detaches the stack under the lock and
+** releases it in address-sorted chunks through `free_batch_impl`, which coalesces runs of adjacent blocks once.
+** Allocation calls drain every MM_REMOTE_DRAIN_INTERVAL calls and before failing; until then queued blocks still
+** count as in use.
+*/
+#ifndef MM_REMOTE_DRAIN_CHUNK
+#define MM_REMOTE_DRAIN_CHUNK 64
+#endif
+
+#ifndef MM_REMOTE_DRAIN_INTERVAL
+#define MM_REMOTE_DRAIN_INTERVAL 32
+#endif
+
+static inline int remote_free_applies(const mm_allocator_t* ctrl) {
+  return (ctrl->flags & MM_FLAG_REMOTE_FREE) &&
+         __atomic_load_n(&ctrl->owner_thread, __ATOMIC_RELAXED) != mm_thread_id();
+}
+
+static void remote_push(mm_allocator_t* ctrl, void* ptr) {
+  void* head = __atomic_load_n(&ctrl->remote_head, __ATOMIC_RELAXED);
+  do {
+    *(void**)ptr = head;
+  } while (!__atomic_compare_exchange_n(&ctrl->remote_head, &head, ptr, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+** A pointer pushed twice while still queued links the stack into a cycle. Brent's search finds it with reads only
+** and cuts the link that closes it, so the drain stays finite and the duplicate is dropped. The second push
+** overwrote the pointer's link, so everything queued before its first push is unreachable and stays allocated
+** (MM_DEBUG builds assert instead). A pointer pushed again after its drain gets the same checks as one passed to
+** `mm_free_batch`.
+*/
+static void remote_cut_cycle(void* head) {
+  if (!head) return;
+  size_t power = 1, lam = 1;
+  void* tortoise = head;
+  void* hare = *(void**)head;
+  while (hare && hare != tortoise) {
+    if (power == lam) {
+      tortoise = hare;
+      power <<= 1;
+      lam = 0;
+    }
+    hare = *(void**)hare;
+    lam++;
+  }
+  if (!hare) return;
+
+#ifdef MM_DEBUG
+  if (MM_DEBUG_ABORT_ON_REMOTE_CYCLE) assert(!"mm_free: double remote free");
+#endif
+  /* `lam` is the cycle length: walk to its first node, then to the node whose link closes it. */
+  tortoise = hare = head;
+  for (size_t i = 0; i < lam; i++) hare = *(void**)hare;
+  while (tortoise != hare) {
+    tortoise = *(void**)tortoise;
+    hare = *(void**)hare;
+  }
+  for (size_t i = 1; i < lam; i++) hare = *(void**)hare;
+  *(void**)hare = NULL;
+}
+
+static size_t remote_drain_impl(mm_allocator_t* ctrl) {
+  void* ptr = __atomic_exchange_n(&ctrl->remote_head, NULL, __ATOMIC_ACQUIRE);
+  remote_cut_cycle(ptr);
+  size_t drained = 0;
+  void* chunk[MM_REMOTE_DRAIN_CHUNK];
+  while (ptr) {
+    size_t n = 0;
+    while (ptr && n < MM_REMOTE_DRAIN_CHUNK) {
+      chunk[n++] = ptr;
+      ptr = *(void**)ptr;
+    }
+    qsort(chunk, n, sizeof(void*), ptr_addr_compare);
+    ctrl->stats.free_count += free_batch_impl(ctrl, chunk, n);
+    for (size_t i = 0; i < n; i++) trace_emit(ctrl, MM_OP_FREE, chunk[i], NULL, 0, 0);
+    drained += n;
+  }
+  return drained;
+}
+
+/* Releases everything queued; returns nonzero if there was anything (a failed allocation is then worth a retry). */
+static inline int remote_drain_all(mm_allocator_t* ctrl) {
+  if (!(ctrl->flags & MM_FLAG_REMOTE_FREE)) return 0;
+  ctrl->remote_ticks = 0; /* even when empty, or every later call would drain */
+  if (!__atomic_load_n(&ctrl->remote_head, __ATOMIC_RELAXED)) return 0;
+  return remote_drain_impl(ctrl) != 0;
+}
+
+/* Allocation calls drain every MM_REMOTE_DRAIN_INTERVAL calls, so each drain sorts and merges a real batch. */
+static inline void remote_drain_periodic(mm_allocator_t* ctrl) {
+  if (!(ctrl->flags & MM_FLAG_REMOTE_FREE) || ++ctrl->remote_ticks < MM_REMOTE_DRAIN_INTERVAL) return;
+  remote_drain_all(ctrl); /* restarts the count */
+}
+
+/*
+** Locking wrappers.
+**
+** Every public entry point that reads or mutates allocator state goes through here; the *_impl functions above
+** never lock, so they can call each other freely (realloc -> malloc/free, memalign -> malloc, reset -> validate).
+*/
+int mm_validate(tlsf_t tlsf) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return 0;
+  mm_lock(ctrl);
+  int ok = validate_impl(ctrl);
+  mm_unlock(ctrl);
+  return ok;
+}
+
+int mm_reset(tlsf_t tlsf) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return 0;
+  mm_lock(ctrl);
+  remote_drain_all(ctrl);
+  int ok = reset_impl(ctrl);
+  mm_unlock(ctrl);
+  return ok;
+}
+
+void mm_set_owner_thread(tlsf_t tlsf) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return;
+  mm_lock(ctrl);
+  /* Drain first: the new owner's frees bypass the stack from now on. */
+  remote_drain_all(ctrl);
+  __atomic_store_n(&ctrl->owner_thread, mm_thread_id(), __ATOMIC_RELAXED);
+  mm_unlock(ctrl);
+}
+
+size_t mm_drain_remote_frees(tlsf_t tlsf) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !(ctrl->flags & MM_FLAG_REMOTE_FREE)) return 0;
+  mm_lock(ctrl);
+  ctrl->remote_ticks = 0;
+  size_t drained = remote_drain_impl(ctrl);
+  mm_unlock(ctrl);
+  return drained;
+}
+
+pool_t mm_get_pool(tlsf_t tlsf) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  mm_lock(ctrl);
+  pool_t pool = get_pool_impl(ctrl);
+  mm_unlock(ctrl);
+  return pool;
+}
+
+pool_t mm_get_pool_for_ptr(tlsf_t tlsf, const void* ptr) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  mm_lock(ctrl);
+  pool_t pool = get_pool_for_ptr_impl(ctrl, ptr);
+  mm_unlock(ctrl);
+  return pool;
+}
+
+pool_t mm_add_pool(tlsf_t tlsf, void* mem, size_t bytes) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  mm_lock(ctrl);
+  pool_t pool = add_pool_impl(ctrl, mem, bytes);
+  mm_unlock(ctrl);
+  return pool;
+}
+
+int mm_pool_is_empty(tlsf_t tlsf, pool_t pool) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !pool) return 0;
+  mm_lock(ctrl);
+  mm_pool_desc_t* desc = pool_desc_from_handle(ctrl, pool);
+  int empty = desc && desc->live_allocations == 0;
+  mm_unlock(ctrl);
+  return empty;
+}
+
+void mm_remove_pool(tlsf_t tlsf, pool_t pool) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return;
+  mm_lock(ctrl);
+  remove_pool_impl(ctrl, pool);
+  mm_unlock(ctrl);
+}
+
+void* mm_malloc(tlsf_t tlsf, size_t bytes) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  MM_LATENCY_START(t0);
+  mm_lock(ctrl);
+  remote_drain_periodic(ctrl);
+  void* p = malloc_impl(ctrl, bytes);
+  if (!p && bytes && remote_drain_all(ctrl)) p = malloc_impl(ctrl, bytes);
+  if (p) ctrl->stats.malloc_count++;
+  else if (bytes) ctrl->stats.failed_count++;
+  MM_LATENCY_RECORD(ctrl, MM_OP_MALLOC, t0);
+  trace_emit(ctrl, MM_OP_MALLOC, NULL, p, bytes, 0);
+  mm_unlock(ctrl);
+  return p;
+}
+
+void mm_free(tlsf_t tlsf, void* ptr) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !ptr) return;
+  if (remote_free_applies(ctrl)) {
+    remote_push(ctrl, ptr);
+    return;
+  }
+  MM_LATENCY_START(t0);
+  mm_lock(ctrl);
+  ctrl->stats.free_count += (size_t)free_impl(ctrl, ptr);
+  MM_LATENCY_RECORD(ctrl, MM_OP_FREE, t0);
+  trace_emit(ctrl, MM_OP_FREE, ptr, NULL, 0, 0);
+  mm_unlock(ctrl);
+}
+
+void* mm_realloc(tlsf_t tlsf, void* ptr, size_t size) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  MM_LATENCY_START(t0);
+  mm_lock(ctrl);
+  remote_drain_periodic(ctrl);
+  void* p = realloc_impl(ctrl, ptr, size);
+  if (!p && size && remote_drain_all(ctrl)) p = realloc_impl(ctrl, ptr, size);
+  if (p) ctrl->stats.realloc_count++;
+  else if (size) ctrl->stats.failed_count++;
+  MM_LATENCY_RECORD(ctrl, MM_OP_REALLOC, t0);
+  trace_emit(ctrl, MM_OP_REALLOC, ptr, p, size, 0);
+  mm_unlock(ctrl);
+  return p;
+}
+
+void* mm_memalign(tlsf_t tlsf, size_t align, size_t bytes) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  MM_LATENCY_START(t0);
+  mm_lock(ctrl);
+  remote_drain_periodic(ctrl);
+  void* p = memalign_impl(ctrl, align, bytes);
+  if (!p && bytes && remote_drain_all(ctrl)) p = memalign_impl(ctrl, align, bytes);
+  if (p) ctrl->stats.memalign_count++;
+  else if (bytes) ctrl->stats.failed_count++;
+  MM_LATENCY_RECORD(ctrl, MM_OP_MEMALIGN, t0);
+  trace_emit(ctrl, MM_OP_MEMALIGN, NULL, p, bytes, align);
+  mm_unlock(ctrl);
+  return p;
+}
+
+size_t mm_malloc_batch(tlsf_t tlsf, size_t size, size_t n, void** out) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !out) return 0;
+  mm_lock(ctrl);
+  remote_drain_periodic(ctrl);
+  size_t got = malloc_batch_impl(ctrl, size, n, out);
+  if (got < n && size && remote_drain_all(ctrl)) got += malloc_batch_impl(ctrl, size, n - got, out + got);
+  ctrl->stats.malloc_count += got;
+  if (got < n && size) ctrl->stats.failed_count++;
+  for (size_t i = 0; i < got; i++) trace_emit(ctrl, MM_OP_MALLOC, NULL, out[i], size, 0);
+  if (got < n) trace_emit(ctrl, MM_OP_MALLOC, NULL, NULL, size, 0);
+  mm_unlock(ctrl);
+  return got;
+}
+
+void mm_free_batch(tlsf_t tlsf, void** ptrs, size_t n) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !ptrs || n == 0) return;
+  /* Sort outside the lock; the caller's array is reordered. */
+  qsort(ptrs, n, sizeof(void*), ptr_addr_compare);
+  mm_lock(ctrl);
+  ctrl->stats.free_count += free_batch_impl(ctrl, ptrs, n);
+  for (size_t i = 0; i < n; i++) {
+    if (ptrs[i]) trace_emit(ctrl, MM_OP_FREE, ptrs[i], NULL, 0, 0);
+  }
+  mm_unlock(ctrl);
+}
+
+/*
+** Trimming.
+**
+** Free blocks keep their header (size word + free-list links) at the front and the next block's prev_phys footer
+** at the back; every whole page strictly between the two holds no allocator state and can be handed back to the
+** OS. Smaller classes are visited first and stay resident until `keep_bytes` of free space has been kept, so the
+** blocks most likely to be reused soon do not fault on their next use.
+*/
+#ifndef MM_TRIM_ADVICE
+#if defined(MADV_DONTNEED)
+#define MM_TRIM_ADVICE MADV_DONTNEED
+#endif
+#endif
+
+static size_t trim_impl(mm_allocator_t* ctrl, size_t keep_bytes) {
+#if defined(MM_TRIM_ADVICE)
+  long page = sysconf(_SC_PAGESIZE);
+  if (page <= 0) return 0;
+  uintptr_t mask = (uintptr_t)page - 1;
+  size_t kept = 0;
+  size_t released = 0;
+
+  for (int fl = 0; fl < FL_INDEX_COUNT; fl++) {
+    if (!(ctrl->fl_bitmap & MM_BIT(fl))) continue;
+    for (int sl = 0; sl < SL_INDEX_COUNT; sl++) {
+      for (tlsf_block_t* block = list_head(ctrl, fl, sl); block; block = free_next(block)) {
+        size_t size = block_size(block);
+        if (kept < keep_bytes) {
+          kept += size;
+          continue;
+        }
+        uintptr_t lo = ((uintptr_t)block + sizeof(tlsf_block_t) + mask) & ~mask;
+        uintptr_t hi = ((uintptr_t)block + BLOCK_HEADER_OVERHEAD + size - MM_PREV_PHYS_FOOTER_BYTES) & ~mask;
+        if (hi <= lo) continue;
+        if (madvise((void*)lo, (size_t)(hi - lo), MM_TRIM_ADVICE) == 0) released += (size_t)(hi - lo);
+      }
+    }
+  }
+  return released;
+#else
+  (void)ctrl;
+  (void)keep_bytes;
+  return 0;
+#endif
+}
+
+size_t mm_trim(tlsf_t tlsf, size_t keep_bytes) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return 0;
+  mm_lock(ctrl);
+  size_t released = trim_impl(ctrl, keep_bytes);
+  mm_unlock(ctrl);
+  return released;
+}
+
+int mm_get_stats(tlsf_t tlsf, mm_stats_t* out) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !out) return 0;
+  mm_lock(ctrl);
+  *out = ctrl->stats;
+  out->bytes_free = ctrl->current_free_size;
+  out->pool_bytes = ctrl->total_pool_size;
+  out->largest_free_block = 0;
+  if (ctrl->fl_bitmap) {
+    /* Highest non-empty bucket; its head is within one SL class of the largest free block. */
+    int fl = fls_bitmap(ctrl->fl_bitmap);
+    int sl = fls_bitmap(ctrl->sl_bitmap[fl]);
+    out->largest_free_block = block_size(list_head(ctrl, fl, sl));
+  }
+  mm_unlock(ctrl);
+  return 1;
+}
+
+/*
+** Fragmentation queries.
+**
+** Both walk only the non-empty classes (via the bitmaps) and the free blocks linked from them.
+*/
+static void free_class_range(int fl, int sl, size_t* min_size, size_t* max_size) {
+  if (fl == 0) {
+    *min_size = (size_t)sl * ALIGNMENT;
+    *max_size = *min_size + ALIGNMENT - 1;
+    return;
+  }
+  int log2 = fl + FL_INDEX_SHIFT - 1;
+  size_t step = (size_t)1 << (log2 - SL_INDEX_COUNT_LOG2);
+  *min_size = ((size_t)1 << log2) + (size_t)sl * step;
+  *max_size = *min_size + step - 1;
+}
+
+int mm_fragmentation_report(tlsf_t tlsf, mm_frag_report_t* out) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !out) return 0;
+  memset(out, 0, sizeof(*out));
+  mm_lock(ctrl);
+  for (mm_bitmap_t fl_map = ctrl->fl_bitmap; fl_map; fl_map &= fl_map - 1) {
+    int fl = ffs_bitmap(fl_map);
+    for (mm_bitmap_t sl_map = ctrl->sl_bitmap[fl]; sl_map; sl_map &= sl_map - 1) {
+      int sl = ffs_bitmap(sl_map);
+      out->nonempty_classes++;
+      for (tlsf_block_t* block = list_head(ctrl, fl, sl); block; block = free_next(block)) {
+        size_t size = block_size(block);
+        int bin = fls_sizet(size);
+        out->free_blocks++;
+        out->free_bytes += size;
+        out->hist_blocks[bin]++;
+        out->hist_bytes[bin] += size;
+        if (size > out->largest_free_block) out->largest_free_block = size;
+        if (out->smallest_free_block == 0 || size < out->smallest_free_block) out->smallest_free_block = size;
+      }
+    }
+  }
+  mm_unlock(ctrl);
+  if (out->free_bytes) {
+    out->external_fragmentation = 1.0 - (double)out->largest_free_block / (double)out->free_bytes;
+  }
+  return 1;
+}
+
+size_t mm_free_space_map(tlsf_t tlsf, mm_free_class_t* out, size_t n) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return 0;
+  size_t copied = 0;
+  mm_lock(ctrl);
+  for (mm_bitmap_t fl_map = ctrl->fl_bitmap; fl_map && (!out || copied < n); fl_map &= fl_map - 1) {
+    int fl = ffs_bitmap(fl_map);
+    for (mm_bitmap_t sl_map = ctrl->sl_bitmap[fl]; sl_map && (!out || copied < n); sl_map &= sl_map - 1) {
+      int sl = ffs_bitmap(sl_map);
+      if (out) {
+        mm_free_class_t* cls = &out[copied];
+        cls->fl = (unsigned int)fl;
+        cls->sl = (unsigned int)sl;
+        free_class_range(fl, sl, &cls->min_size, &cls->max_size);
+        cls->blocks = 0;
+        cls->bytes = 0;
+        for (tlsf_block_t* block = list_head(ctrl, fl, sl); block; block = free_next(block)) {
+          cls->blocks++;
+          cls->bytes += block_size(block);
+        }
+      }
+      copied++;
+    }
+  }
+  mm_unlock(ctrl);
+  return copied;
+}
+
+/*
+** Latency queries (MM_LATENCY).
+**
+** Percentiles walk the buckets (MM_LAT_BUCKETS steps) under the instance lock and report the bucket's upper bound,
+** clamped to the exact maximum.
+*/
+#if MM_LATENCY
+static uint64_t latency_percentile_impl(const mm_latency_hist_t* hist, double quantile) {
+  if (hist->count == 0) return 0;
+  if (quantile < 0.0) quantile = 0.0;
+  if (quantile > 1.0) quantile = 1.0;
+
+  double exact = quantile * (double)hist->count;
+  uint64_t rank = (uint64_t)exact;
+  if ((double)rank < exact) rank++;
+  if (rank == 0) rank = 1;
+
+  uint64_t seen = 0;
+  for (unsigned int b = 0; b < MM_LAT_BUCKETS; b++) {
+    seen += hist->buckets[b];
+    if (seen >= rank) {
+      uint64_t upper = latency_bucket_upper(b);
+      return upper < hist->max ? upper : hist->max;
+    }
+  }
+  return hist->max;
+}
+#endif
+
+int mm_get_latency(tlsf_t tlsf, mm_op_t op, mm_latency_t* out) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || !out || (unsigned int)op >= MM_OP_COUNT) return 0;
+#if MM_LATENCY
+  mm_lock(ctrl);
+  const mm_latency_hist_t* hist = &ctrl->latency[op];
+  memset(out, 0, sizeof(*out));
+  out->count = hist->count;
+  if (hist->count) {
+    out->min = hist->min;
+    out->max = hist->max;
+    out->mean = hist->total / hist->count;
+    out->p50 = latency_percentile_impl(hist, 0.50);
+    out->p90 = latency_percentile_impl(hist, 0.90);
+    out->p99 = latency_percentile_impl(hist, 0.99);
+    out->p999 = latency_percentile_impl(hist, 0.999);
+  }
+  mm_unlock(ctrl);
+  return 1;
+#else
+  memset(out, 0, sizeof(*out));
+  return 0;
+#endif
+}
+
+uint64_t mm_latency_percentile(tlsf_t tlsf, mm_op_t op, double quantile) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || (unsigned int)op >= MM_OP_COUNT) return 0;
+#if MM_LATENCY
+  mm_lock(ctrl);
+  uint64_t value = latency_percentile_impl(&ctrl->latency[op], quantile);
+  mm_unlock(ctrl);
+  return value;
+#else
+  (void)quantile;
+  return 0;
+#endif
+}
+
+size_t mm_get_latency_buckets(tlsf_t tlsf, mm_op_t op, uint64_t* upper, uint64_t* counts, size_t n) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || (unsigned int)op >= MM_OP_COUNT) return 0;
+#if MM_LATENCY
+  size_t copied = 0;
+  mm_lock(ctrl);
+  const mm_latency_hist_t* hist = &ctrl->latency[op];
+  for (unsigned int b = 0; b < MM_LAT_BUCKETS; b++) {
+    if (!hist->buckets[b]) continue;
+    if (upper || counts) {
+      if (copied == n) break;
+      if (upper) upper[copied] = latency_bucket_upper(b);
+      if (counts) counts[copied] = hist->buckets[b];
+    }
+    copied++;
+  }
+  mm_unlock(ctrl);
+  return copied;
+#else
+  (void)upper;
+  (void)counts;
+  (void)n;
+  return 0;
+#endif
+}
+
+void mm_reset_latency(tlsf_t tlsf) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return;
+#if MM_LATENCY
+  mm_lock(ctrl);
+  memset(ctrl->latency, 0, sizeof(ctrl->latency));
+  mm_unlock(ctrl);
+#endif
+}
+
+/* Femtoseconds per tick; 0 until the first calibration. */
+static uint64_t g_latency_tick_fs = 0;
+
+double mm_latency_tick_ns(void) {
+  uint64_t fs = __atomic_load_n(&g_latency_tick_fs, __ATOMIC_RELAXED);
+  if (fs) return (double)fs / 1e6;
+#if (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)) && (defined(__unix__) || defined(__APPLE__))
+  /* Racing first callers each calibrate and store a near-identical value. */
+  struct timespec start, end, pause = {0, 10 * 1000 * 1000};
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  uint64_t t0 = latency_now();
+  nanosleep(&pause, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  uint64_t t1 = latency_now();
+  double ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+  fs = (t1 > t0) ? (uint64_t)(ns * 1e6 / (double)(t1 - t0)) : 0;
+  if (!fs) fs = 1;
+#else
+  fs = 1000000u; /* the fallback timer already counts nanoseconds */
+#endif
+  __atomic_store_n(&g_latency_tick_fs, fs, __ATOMIC_RELAXED);
+  return (double)fs / 1e6;
+}
+
+void mm_set_trace_hook(tlsf_t tlsf, mm_trace_hook hook, void* user) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return;
+  /* A hook is a function pointer of the calling process; any process may run the next operation. */
+  if (ctrl->flags & MM_FLAG_SHARED) return;
+  mm_lock(ctrl);
+  ctrl->trace_hook = hook;
+  ctrl->trace_user = user;
+  mm_unlock(ctrl);
+}
+
+/*
+** Thread caches.
+**
+** A cache is caller-owned memory bound to one allocator and used by one thread. It keeps a magazine (LIFO array)
+** per small size class; a hit is a pointer pop/push with no bitmap search, split or coalesce. Misses refill
+** MM_TCACHE_BATCH blocks and overflows flush MM_TCACHE_BATCH blocks, each under a single lock acquisition.
+** Cached blocks stay "used" from the allocator's point of view (they count as live allocations), so memory held
+** per thread is bounded by MM_TCACHE_CLASS_COUNT * MM_TCACHE_MAG_CAPACITY blocks of at most MM_TCACHE_MAX_SIZE.
+*/
+#define MM_TCACHE_CLASS_SHIFT 4
+#define MM_TCACHE_CLASS_COUNT 16
+#define MM_TCACHE_MAX_SIZE ((size_t)MM_TCACHE_CLASS_COUNT << MM_TCACHE_CLASS_SHIFT)
+#ifndef MM_TCACHE_MAG_CAPACITY
+#define MM_TCACHE_MAG_CAPACITY 32
+#endif
+#define MM_TCACHE_BATCH (MM_TCACHE_MAG_CAPACITY / 2)
+
+typedef struct mm_tcache_ctrl_t {
+  mm_allocator_t* alloc;
+  unsigned int count[MM_TCACHE_CLASS_COUNT];
+  void* slots[MM_TCACHE_CLASS_COUNT][MM_TCACHE_MAG_CAPACITY];
+} mm_tcache_ctrl_t;
+
+MM_STATIC_ASSERT(MM_TCACHE_BATCH >= 1, tcache_batch_nonzero);
+MM_STATIC_ASSERT(((size_t)1 << MM_TCACHE_CLASS_SHIFT) >= ALIGNMENT, tcache_class_step_aligned);
+
+static void tcache_flush_class(mm_tcache_ctrl_t* cache, unsigned int cls, unsigned int n) {
+  /* Flush the coldest (oldest) entries; the hot top of the magazine stays cached. */
+  mm_allocator_t* ctrl = cache->alloc;
+  mm_lock(ctrl);
+  for (unsigned int i = 0; i < n; i++) {
+    ctrl->stats.free_count += (size_t)free_impl(ctrl, cache->slots[cls][i]);
+    trace_emit(ctrl, MM_OP_FREE, cache->slots[cls][i], NULL, 0, 0);
+  }
+  mm_unlock(ctrl);
+
+  unsigned int keep = cache->count[cls] - n;
+  memmove(&cache->slots[cls][0], &cache->slots[cls][n], keep * sizeof(void*));
+  cache->count[cls] = keep;
+}
+
+size_t mm_tcache_size(void) {
+  return sizeof(mm_tcache_ctrl_t);
+}
+
+mm_tcache_t mm_tcache_create(void* mem, tlsf_t alloc) {
+  if (!mem || !alloc) return NULL;
+  if ((uintptr_t)mem % ALIGNMENT != 0) return NULL;
+  /* Cache classes are derived from TLSF block headers, which slab slots do not have. */
+  if (((mm_allocator_t*)alloc)->flags & MM_FLAG_SLAB) return NULL;
+
+  mm_tcache_ctrl_t* cache = (mm_tcache_ctrl_t*)mem;
+  memset(cache, 0, sizeof(*cache));
+  cache->alloc = (mm_allocator_t*)alloc;
+  return (mm_tcache_t)cache;
+}
+
+void* mm_tcache_malloc(mm_tcache_t tcache, size_t bytes) {
+  mm_tcache_ctrl_t* cache = (mm_tcache_ctrl_t*)tcache;
+  if (!cache) return NULL;
+  if (bytes == 0 || bytes > MM_TCACHE_MAX_SIZE) return mm_malloc(cache->alloc, bytes);
+
+  unsigned int cls = (unsigned int)((bytes - 1) >> MM_TCACHE_CLASS_SHIFT);
+  if (cache->count[cls]) return cache->slots[cls][--cache->count[cls]];
+
+  /* Miss: refill half a magazine under one lock, hand out the last block. */
+  size_t class_size = (size_t)(cls + 1) << MM_TCACHE_CLASS_SHIFT;
+  mm_allocator_t* ctrl = cache->alloc;
+  unsigned int n = 0;
+  mm_lock(ctrl);
+  remote_drain_periodic(ctrl);
+  while (n < MM_TCACHE_BATCH) {
+    void* p = malloc_impl(ctrl, class_size);
+    if (!p && !n && remote_drain_all(ctrl)) p = malloc_impl(ctrl, class_size);
+    trace_emit(ctrl, MM_OP_MALLOC, NULL, p, class_size, 0);
+    if (!p) break;
+    cache->slots[cls][n++] = p;
+  }
+  ctrl->stats.malloc_count += n;
+  if (!n) ctrl->stats.failed_count++;
+  mm_unlock(ctrl);
+
+  if (!n) return NULL;
+  cache->count[cls] = n - 1;
+  return cache->slots[cls][n - 1];
+}
+
+void mm_tcache_free(mm_tcache_t tcache, void* ptr) {
+  mm_tcache_ctrl_t* cache = (mm_tcache_ctrl_t*)tcache;
+  if (!cache || !ptr) return;
+
+#ifdef MM_DEBUG
+  {
+    mm_pool_desc_t* pool_desc = NULL;
+    tlsf_block_t* block = NULL;
+    mm_lock(cache->alloc);
+    mm_ptr_check_t ptr_status = mm_ptr_to_block_checked(cache->alloc, ptr, &pool_desc, &block);
+    mm_unlock(cache->alloc);
+    if (ptr_status != MM_PTR_OK || block_is_free(block)) {
+      if (MM_DEBUG_ABORT_ON_INVALID_POINTER) assert(!"mm_tcache_free: invalid pointer");
+      return;
+    }
+  }
+#endif
+
+  /* A block serves any class up to its usable size (splitting may have left it larger than requested). */
+  size_t usable = block_size(user_to_block(ptr));
+  /* Too small for the first class (e.g. 12-byte minimum blocks on 32-bit builds) or too big for the last. */
+  if (usable < ((size_t)1 << MM_TCACHE_CLASS_SHIFT) ||
+      usable > MM_TCACHE_MAX_SIZE + ((size_t)1 << MM_TCACHE_CLASS_SHIFT) - 1) {
+    mm_free(cache->alloc, ptr);
+    return;
+  }
+  unsigned int cls = (unsigned int)(usable >> MM_TCACHE_CLASS_SHIFT) - 1u;
+  if (cls >= MM_TCACHE_CLASS_COUNT) cls = MM_TCACHE_CLASS_COUNT - 1;
+
+#ifdef MM_DEBUG
+  /* Cached blocks still look used to the allocator, so only the magazine shows a second free. */
+  for (unsigned int i = 0; i < cache->count[cls]; i++) {
+    if (cache->slots[cls][i] == ptr) {
+      if (MM_DEBUG_ABORT_ON_DOUBLE_FREE) assert(!"mm_tcache_free: double free");
+      return;
+    }
+  }
+#endif
+
+  if (cache->count[cls] == MM_TCACHE_MAG_CAPACITY) tcache_flush_class(cache, cls, MM_TCACHE_BATCH);
+  cache->slots[cls][cache->count[cls]++] = ptr;
+}
+
+void mm_tcache_flush(mm_tcache_t tcache) {
+  mm_tcache_ctrl_t* cache = (mm_tcache_ctrl_t*)tcache;
+  if (!cache) return;
+  mm_allocator_t* ctrl = cache->alloc;
+  mm_lock(ctrl);
+  for (unsigned int cls = 0; cls < MM_TCACHE_CLASS_COUNT; cls++) {
+    for (unsigned int i = 0; i < cache->count[cls]; i++) {
+      ctrl->stats.free_count += (size_t)free_impl(ctrl, cache->slots[cls][i]);
+      trace_emit(ctrl, MM_OP_FREE, cache->slots[cls][i], NULL, 0, 0);
+    }
+    cache->count[cls] = 0;
+  }
+  mm_unlock(ctrl);
+}
+
+void mm_tcache_destroy(mm_tcache_t tcache) {
+  mm_tcache_flush(tcache);
+}
+
+/*
+** Handles and compaction.
+**
+** A handle block is an ordinary used TLSF block whose first MM_HANDLE_PREFIX bytes hold its table index; the table
+** entry points back at the block. The compactor uses that pair to recognise movable blocks while walking a pool: a
+** raw block may hold any bytes in that word, but no live entry points at it.
+**
+** `mm_compact` walks the pools in address order. Whenever a free block is followed by an unlocked handle block, the
+** handle block's bytes move down to the free block's address and the free space ends up behind it, where it merges
+** with whatever free block follows. The resume cursor is the last handle block visited: a used block stays a block
+** boundary until it is freed, and `mm_hfree` drops the cursor when that happens.
+*/
+#define MM_HANDLE_INDEX_BITS 20
+#define MM_HANDLE_INDEX_MASK ((1u << MM_HANDLE_INDEX_BITS) - 1u)
+#define MM_HANDLE_GEN_MASK ((1u << (32 - MM_HANDLE_INDEX_BITS)) - 1u)
+#define MM_HANDLE_PREFIX ALIGNMENT
+
+MM_STATIC_ASSERT(MM_HANDLE_PREFIX >= sizeof(uint32_t), handle_prefix_holds_index);
+
+typedef struct mm_handle_entry_t {
+  tlsf_block_t* block; /* NULL while the entry is free */
+  uint32_t locks;      /* pin count; next free entry (index + 1) while the entry is free */
+  uint32_t gen;        /* bumped on free so stale handles are rejected */
+} mm_handle_entry_t;
+
+typedef struct mm_handle_table_t {
+  uint32_t capacity;
+  uint32_t free_head; /* index + 1, 0 when every entry is in use */
+  size_t live;
+  uint64_t ticks_per_us;
+  /* Compaction cursor: position in pool_order and the last handle visited there (index + 1, 0 = pool start). */
+  size_t cursor_pool;
+  uint32_t cursor_entry;
+  size_t pass_moves;
+  mm_handle_entry_t entries[];
+} mm_handle_table_t;
+
+static inline void* handle_data(tlsf_block_t* block) {
+  return (char*)block_to_user(block) + MM_HANDLE_PREFIX;
+}
+
+static mm_handle_entry_t* handle_entry(mm_allocator_t* ctrl, mm_handle_t handle) {
+  mm_handle_table_t* table = ctrl->handles;
+  uint32_t index = handle & MM_HANDLE_INDEX_MASK;
+  if (!table || index == 0 || index > table->capacity) return NULL;
+  mm_handle_entry_t* entry = &table->entries[index - 1];
+  if (!entry->block || entry->gen != (handle >> MM_HANDLE_INDEX_BITS)) return NULL;
+  return entry;
+}
+
+/* The entry owning used block `block`, or NULL for a raw block. */
+static inline mm_handle_entry_t* handle_for_block(mm_handle_table_t* table, tlsf_block_t* block) {
+  uint32_t index;
+  memcpy(&index, block_to_user(block), sizeof(index));
+  if (index == 0 || index > table->capacity) return NULL;
+  mm_handle_entry_t* entry = &table->entries[index - 1];
+  return entry->block == block ? entry : NULL;
+}
+
+static mm_handle_t halloc_impl(mm_allocator_t* ctrl, size_t bytes) {
+  mm_handle_table_t* table = ctrl->handles;
+  if (!table || !table->free_head || bytes == 0 || bytes > SIZE_MAX - MM_HANDLE_PREFIX) return 0;
+  mm_check_integrity(ctrl);
+  /* Slab slots have no header to move, so handle blocks always come from the TLSF path. */
+  void* p = malloc_block_impl(ctrl, bytes + MM_HANDLE_PREFIX);
+  if (!p) return 0;
+
+  uint32_t index = table->free_head - 1;
+  mm_handle_entry_t* entry = &table->entries[index];
+  table->free_head = entry->locks;
+  entry->block = user_to_block(p);
+  entry->locks = 0;
+  table->live++;
+  uint32_t tag = index + 1;
+  memcpy(p, &tag, sizeof(tag));
+  return (entry->gen << MM_HANDLE_INDEX_BITS) | tag;
+}
+
+static void hfree_impl(mm_allocator_t* ctrl, mm_handle_entry_t* entry) {
+  mm_handle_table_t* table = ctrl->handles;
+  uint32_t tag = (uint32_t)(entry - table->entries) + 1;
+  if (table->cursor_entry == tag) table->cursor_entry = 0;
+  free_impl(ctrl, block_to_user(entry->block));
+  entry->block = NULL;
+  entry->gen = (entry->gen + 1) & MM_HANDLE_GEN_MASK;
+  entry->locks = table->free_head;
+  table->free_head = tag;
+  table->live--;
+}
+
+/* Moves handle block `used` down into the free block `gap` in front of it; returns the moved block. */
+static tlsf_block_t* compact_slide(mm_allocator_t* ctrl, tlsf_block_t* gap, tlsf_block_t* used,
+                                   mm_handle_entry_t* entry) {
+  const size_t gap_size = block_size(gap);
+  const size_t used_size = block_size(used);
+  void* old_data = handle_data(used);
+
+  remove_free_block(ctrl, gap);
+  memmove(block_to_user(gap), block_to_user(used), used_size);
+  /* `gap` follows a used block (free neighbours are always merged), so the moved block stays prev-used. */
+  tlsf_block_t* moved = gap;
+  block_set_size(moved, used_size);
+  block_set_used(moved);
+
+  tlsf_block_t* freed = (tlsf_block_t*)((char*)moved + BLOCK_HEADER_OVERHEAD + used_size);
+  freed->size = gap_size;
+  block_mark_as_free(ctrl, freed);
+  insert_free_block(ctrl, coalesce(ctrl, freed));
+
+  entry->block = moved;
+  trace_emit(ctrl, MM_OP_REALLOC, old_data, handle_data(moved), used_size - MM_HANDLE_PREFIX, 0);
+  return moved;
+}
+
+static int compact_impl(mm_allocator_t* ctrl, uint64_t deadline) {
+  mm_handle_table_t* table = ctrl->handles;
+  if (!table || !table->live || !ctrl->pool_count) return 1;
+  mm_check_integrity(ctrl);
+
+  /* The deadline is only honoured once the cursor has advanced, so every call makes progress. */
+  int progressed = 0;
+  for (;;) {
+    if (table->cursor_pool >= ctrl->pool_count) {
+      /* End of a pass: finished if it moved nothing, otherwise go round again. */
+      int done = table->pass_moves == 0;
+      table->cursor_pool = 0;
+      table->cursor_entry = 0;
+      table->pass_moves = 0;
+      if (done) return 1;
+    }
+
+    mm_pool_desc_t* pool = &ctrl->pools[ctrl->pool_order[table->cursor_pool]];
+    tlsf_block_t* block = (tlsf_block_t*)pool_start(pool);
+    if (table->cursor_entry) {
+      tlsf_block_t* at = table->entries[table->cursor_entry - 1].block;
+      if (at && mm_block_ptr_in_pool(pool, at)) block = at;
+    }
+
+    /* The size-0 epilogue ends the pool. */
+    while (block_size(block) != 0) {
+      tlsf_block_t* next = block_next_safe(ctrl, block);
+      mm_handle_entry_t* entry = NULL;
+      if (block_is_free(block)) {
+        entry = block_size(next) ? handle_for_block(table, next) : NULL;
+        if (entry && entry->locks == 0) {
+          block = compact_slide(ctrl, block, next, entry);
+          next = block_next_safe(ctrl, block);
+          table->pass_moves++;
+        } else {
+          entry = NULL;
+        }
+      } else {
+        entry = handle_for_block(table, block);
+      }
+      if (entry) {
+        uint32_t tag = (uint32_t)(entry - table->entries) + 1;
+        progressed |= tag != table->cursor_entry;
+        table->cursor_entry = tag;
+      }
+      block = next;
+      if (progressed && latency_now() >= deadline) return 0;
+    }
+    table->cursor_pool++;
+    table->cursor_entry = 0;
+    progressed = 1;
+  }
+}
+
+size_t mm_handle_table_size(size_t capacity) {
+  if (capacity == 0 || capacity > MM_HANDLE_INDEX_MASK) return 0;
+  return sizeof(mm_handle_table_t) + capacity * sizeof(mm_handle_entry_t);
+}
+
+int mm_handles_attach(tlsf_t tlsf, void* mem, size_t capacity) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl || (ctrl->flags & MM_FLAG_SHARED)) return 0;
+  if (mem && (!mm_handle_table_size(capacity) || (uintptr_t)mem % sizeof(void*) != 0)) return 0;
+  /* Calibrate outside the lock: the first call sleeps briefly. */
+  uint64_t ticks_per_us = mem ? (uint64_t)(1000.0 / mm_latency_tick_ns()) : 0;
+  if (mem && !ticks_per_us) ticks_per_us = 1;
+
+  mm_lock(ctrl);
+  int ok = !ctrl->handles || ctrl->handles->live == 0;
+  if (ok && mem) {
+    mm_handle_table_t* table = (mm_handle_table_t*)mem;
+    memset(table, 0, mm_handle_table_size(capacity));
+    table->capacity = (uint32_t)capacity;
+    table->ticks_per_us = ticks_per_us;
+    for (uint32_t i = 0; i + 1 < table->capacity; i++) table->entries[i].locks = i + 2;
+    table->free_head = 1;
+    ctrl->handles = table;
+  } else if (ok) {
+    ctrl->handles = NULL;
+  }
+  mm_unlock(ctrl);
+  return ok;
+}
+
+mm_handle_t mm_halloc(tlsf_t tlsf, size_t bytes) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return 0;
+  mm_lock(ctrl);
+  mm_handle_t handle = halloc_impl(ctrl, bytes);
+  if (handle) ctrl->stats.malloc_count++;
+  else if (bytes) ctrl->stats.failed_count++;
+  mm_handle_entry_t* entry = handle_entry(ctrl, handle);
+  trace_emit(ctrl, MM_OP_MALLOC, NULL, entry ? handle_data(entry->block) : NULL, bytes, 0);
+  mm_unlock(ctrl);
+  return handle;
+}
+
+void* mm_hlock(tlsf_t tlsf, mm_handle_t handle) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return NULL;
+  mm_lock(ctrl);
+  mm_handle_entry_t* entry = handle_entry(ctrl, handle);
+  void* p = NULL;
+  if (entry && entry->locks != UINT32_MAX) {
+    entry->locks++;
+    p = handle_data(entry->block);
+  }
+  mm_unlock(ctrl);
+  return p;
+}
+
+void mm_hunlock(tlsf_t tlsf, mm_handle_t handle) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return;
+  mm_lock(ctrl);
+  mm_handle_entry_t* entry = handle_entry(ctrl, handle);
+  if (entry && entry->locks) entry->locks--;
+  mm_unlock(ctrl);
+}
+
+void mm_hfree(tlsf_t tlsf, mm_handle_t handle) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return;
+  mm_lock(ctrl);
+  mm_handle_entry_t* entry = handle_entry(ctrl, handle);
+  if (entry) {
+    void* data = handle_data(entry->block);
+    hfree_impl(ctrl, entry);
+    ctrl->stats.free_count++;
+    trace_emit(ctrl, MM_OP_FREE, data, NULL, 0, 0);
+  }
+  mm_unlock(ctrl);
+}
+
+int mm_compact(tlsf_t tlsf, unsigned int budget_us) {
+  mm_allocator_t* ctrl = (mm_allocator_t*)tlsf;
+  if (!ctrl) return 0;
+  uint64_t start = latency_now();
+  mm_lock(ctrl);
+  int done = 1;
+  if (ctrl->handles) done = compact_impl(ctrl, start + (uint64_t)budget_us * ctrl->handles->ticks_per_us);
+  mm_unlock(ctrl);
+  return done;
+}
+
+/*
+** Arenas.
+**
+** An arena is caller-owned memory bound to one allocator. It takes chunks from the allocator with `mm_malloc` and
+** carves requests out of the newest chunk by bumping a pointer; objects carry no header and are never freed one by
+** one. Chunks form a stack (newest first), so a savepoint is just the newest chunk and the bump pointer at the time
+** it was taken: rewinding frees every newer chunk and resets the pointer. A request that does not fit the newest
+** chunk starts a new one of at least `chunk_bytes`, abandoning whatever was left in the old one.
+*/
+#ifndef MM_ARENA_CHUNK_SIZE
+#define MM_ARENA_CHUNK_SIZE (16 * 1024)
+#endif
+
+typedef struct mm_arena_chunk_t {
+  struct mm_arena_chunk_t* prev;
+  size_t bytes;
+} mm_arena_chunk_t;
+
+typedef struct mm_arena_ctrl_t {
+  mm_allocator_t* alloc;
+  size_t chunk_bytes;
+  mm_arena_chunk_t* head;
+  uintptr_t cur;
+  uintptr_t end;
+} mm_arena_ctrl_t;
+
+#define MM_ARENA_HEADER align_size(sizeof(mm_arena_chunk_t))
+
+MM_STATIC_ASSERT(MM_ARENA_CHUNK_SIZE >= 256, arena_chunk_not_tiny);
+
+static void* arena_alloc_impl(mm_arena_ctrl_t* arena, size_t align, size_t bytes) {
+  uintptr_t p = (arena->cur + (align - 1)) & ~(uintptr_t)(align - 1);
+  if (arena->head && p <= arena->end && arena->end - p >= bytes) {
+    arena->cur = p + bytes;
+    return (void*)p;
+  }
+
+  /* Slow path: start a new chunk. Padding for over-aligned requests comes out of the chunk itself. */
+  size_t pad = align > ALIGNMENT ? align - ALIGNMENT : 0;
+  if (bytes > SIZE_MAX - MM_ARENA_HEADER - pad) return NULL;
+  size_t need = MM_ARENA_HEADER + pad + bytes;
+  size_t chunk_bytes = need > arena->chunk_bytes ? need : arena->chunk_bytes;
+  mm_arena_chunk_t* chunk = (mm_arena_chunk_t*)mm_malloc(arena->alloc, chunk_bytes);
+  if (!chunk) return NULL;
+  chunk->prev = arena->head;
+  chunk->bytes = chunk_bytes;
+  arena->head = chunk;
+  arena->end = (uintptr_t)chunk + chunk_bytes;
+
+  p = ((uintptr_t)chunk + MM_ARENA_HEADER + (align - 1)) & ~(uintptr_t)(align - 1);
+  arena->cur = p + bytes;
+  return (void*)p;
+}
+
+size_t mm_arena_size(void) {
+  return sizeof(mm_arena_ctrl_t);
+}
+
+mm_arena_t mm_arena_create(void* mem, tlsf_t alloc, size_t chunk_bytes) {
+  if (!mem || !alloc) return NULL;
+  if ((uintptr_t)mem % sizeof(void*) != 0) return NULL;
+  if (chunk_bytes == 0) chunk_bytes = MM_ARENA_CHUNK_SIZE;
+  if (chunk_bytes <= MM_ARENA_HEADER) return NULL;
+
+  mm_arena_ctrl_t* arena = (mm_arena_ctrl_t*)mem;
+  memset(arena, 0, sizeof(*arena));
+  arena->alloc = (mm_allocator_t*)alloc;
+  arena->chunk_bytes = chunk_bytes;
+  return (mm_arena_t)arena;
+}
+
+void* mm_arena_alloc(mm_arena_t handle, size_t bytes) {
+  mm_arena_ctrl_t* arena = (mm_arena_ctrl_t*)handle;
+  if (!arena || bytes == 0) return NULL;
+  return arena_alloc_impl(arena, ALIGNMENT, bytes);
+}
+
+void* mm_arena_memalign(mm_arena_t handle, size_t align, size_t bytes) {
+  mm_arena_ctrl_t* arena = (mm_arena_ctrl_t*)handle;
+  if (!arena || bytes == 0) return NULL;
+  if (align == 0 || (align & (align - 1)) != 0) return NULL;
+  if (align > SIZE_MAX / 2) return NULL;
+  if (align < ALIGNMENT) align = ALIGNMENT;
+  return arena_alloc_impl(arena, align, bytes);
+}
+
+mm_arena_mark_t mm_arena_save(mm_arena_t handle) {
+  mm_arena_ctrl_t* arena = (mm_arena_ctrl_t*)handle;
+  mm_arena_mark_t mark = {NULL, 0};
+  if (arena) {
+    mark.chunk = arena->head;
+    mark.offset = arena->head ? (size_t)(arena->cur - (uintptr_t)arena->head) : 0;
+  }
+  return mark;
+}
+
+void mm_arena_rewind(mm_arena_t handle, mm_arena_mark_t mark) {
+  mm_arena_ctrl_t* arena = (mm_arena_ctrl_t*)handle;
+  if (!arena) return;
+  while (arena->head && arena->head != (mm_arena_chunk_t*)mark.chunk) {
+    mm_arena_chunk_t* prev = arena->head->prev;
+    mm_free(arena->alloc, arena->head);
+    arena->head = prev;
+  }
+  if (!arena->head) {
+    /* Either the mark predates the first chunk or it was already rewound past: nothing is left either way. */
+#ifdef MM_DEBUG
+    if (mark.chunk && MM_DEBUG_ABORT_ON_INVALID_POINTER) assert(!"mm_arena_rewind: stale mark");
+#endif
+    arena->cur = 0;
+    arena->end = 0;
+    return;
+  }
+  arena->cur = (uintptr_t)arena->head + mark.offset;
+  arena->end = (uintptr_t)arena->head + arena->head->bytes;
+}
+
+void mm_arena_release(mm_arena_t handle) {
+  mm_arena_mark_t empty = {NULL, 0};
+  mm_arena_rewind(handle, empty);
+}
+
+size_t mm_arena_footprint(mm_arena_t handle) {
+  mm_arena_ctrl_t* arena = (mm_arena_ctrl_t*)handle;
+  size_t total = 0;
+  if (!arena) return 0;
+  for (mm_arena_chunk_t* chunk = arena->head; chunk; chunk = chunk->prev) total += chunk->bytes;
+  return total;
+}
+
+void mm_arena_destroy(mm_arena_t handle) {
+  mm_arena_release(handle);
+}
+
+size_t mm_block_size(void* ptr) {
+  if (!ptr) return 0;
+  tlsf_block_t* block = user_to_block(ptr);
+  return block_size(block);
+}
+
+size_t mm_size(void) {
+  return MM_CONTROL_BYTES;
+}
+
+size_t mm_align_size(void) {
+  return ALIGNMENT;
+}
+
+size_t mm_block_size_min(void) {
+  return TLSF_MIN_BLOCK_SIZE;
+}
+
+size_t mm_block_size_max(void) {
+  /* Must be < BLOCK_SIZE_MAX and remain aligned after rounding. */
+  return BLOCK_SIZE_MAX - ALIGNMENT;
+}
+
+size_t mm_fit_slack(size_t size) {
+  /* Good-fit search rounds up to the next second-level class; see mapping_search. */
+  if (size < SMALL_BLOCK_SIZE) return 0;
+  if (size > BLOCK_SIZE_MAX) size = BLOCK_SIZE_MAX;
+  return ((size_t)1 << (fls_sizet(size) - SL_INDEX_COUNT_LOG2)) - 1;
 }
 
 size_t mm_pool_overhead(void) {
@@ -1451,8 +3717,8 @@ void mm_walk_pool(pool_t pool, mm_walker walker, void* user) {
   mm_pool_desc_t* desc = pool_desc_from_global(pool);
   if (!desc || !desc->active) return;
 
-  tlsf_block_t* block = (tlsf_block_t*)desc->start;
-  tlsf_block_t* epilogue = (tlsf_block_t*)(desc->end - BLOCK_HEADER_OVERHEAD);
+  tlsf_block_t* block = (tlsf_block_t*)pool_start(desc);
+  tlsf_block_t* epilogue = (tlsf_block_t*)(pool_end(desc) - BLOCK_HEADER_OVERHEAD);
 
   size_t max_steps = (desc->bytes / ALIGNMENT) + 2;
   for (size_t i = 0; i < max_steps; i++) {
@@ -6,15 +6,21 @@
 **
 ** Ownership model:
 ** - The caller provides all memory (one or more pools).
-** - The allocator never allocates or frees OS memory.
+** - The allocator never maps or unmaps OS memory; the only pages it hands back are free-block interiors,
+**   and only when asked through `mm_trim` (`madvise`).
 ** - `mm_destroy()` never frees memory; the caller frees the backing buffers.
 **
 ** Alignment rules:
-** - `mm_create()`/`mm_create_with_pool()` require `mem` aligned to `sizeof(size_t)`.
-** - `mm_add_pool()` requires `mem` and `bytes` aligned to `sizeof(size_t)`; misaligned pools are rejected.
+** - `mm_create()`/`mm_create_with_pool()` require `mem` aligned to `mm_align_size()` (`sizeof(size_t)` unless
+**   built with -DMM_ALIGN_SIZE).
+** - `mm_add_pool()` requires `mem` and `bytes` aligned to `mm_align_size()`; misaligned pools are rejected.
+** - A pool is one block until it is split, so pools larger than `mm_block_size_max()` + `mm_pool_overhead()` are
+**   rejected; build with a larger -DMM_FL_INDEX_MAX for multi-GiB pools.
+** - Payloads are aligned to `mm_align_size()`.
 */
 
 #include <stddef.h>
+#include <stdint.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -47,6 +53,17 @@ void* mm_memalign(tlsf_t alloc, size_t align, size_t bytes);
 void* mm_realloc(tlsf_t alloc, void* ptr, size_t size);
 void mm_free(tlsf_t alloc, void* ptr);
 
+/*
+** Batch allocation/free (memoman extension).
+**
+** - `mm_malloc_batch` stores up to `n` blocks of `size` bytes in `out` and returns how many it allocated; when one
+**   free block can hold all of them they are carved from it with a single free-list removal.
+** - `mm_free_batch` frees `n` pointers (NULLs are skipped). It sorts `ptrs` in place by address and releases each
+**   run of physically adjacent blocks as one free block.
+*/
+size_t mm_malloc_batch(tlsf_t alloc, size_t size, size_t n, void** out);
+void mm_free_batch(tlsf_t alloc, void** ptrs, size_t n);
+
 /* Returns internal block size, not original request size. */
 size_t mm_block_size(void* ptr);
 
@@ -57,6 +74,7 @@ size_t mm_block_size_min(void);
 size_t mm_block_size_max(void);
 size_t mm_pool_overhead(void);
 size_t mm_alloc_overhead(void);
+size_t mm_fit_slack(size_t size); /* most that good-fit search rounds a `size` request up by */
 
 /* Debugging. */
 typedef void (*mm_walker)(void* ptr, size_t size, int used, void* user);
@@ -68,8 +86,304 @@ int mm_check_pool(pool_t pool);
 
 /* Memoman extensions (TLSF does not define these). */
 tlsf_t mm_init_in_place(void* mem, size_t bytes);
+
+/*
+** Creation flags (memoman extension).
+**
+** - `MM_FLAG_THREAD_SAFE`: every API call on the instance is serialized by a per-instance lock that lives in the
+**   control block (no OS primitives). Without it the instance is single-threaded and pays no locking cost.
+**   `mm_destroy` is not synchronized: quiesce all users first.
+** - `MM_FLAG_SLAB`: requests up to 512 bytes are served from header-less slab slots carved out of the heap with
+**   `mm_memalign`; `mm_free`/`mm_realloc` dispatch by slab address. `mm_block_size` is only meaningful for
+**   pointers that did not come from a slab, and thread caches cannot be attached to such an instance.
+** - `MM_FLAG_UNCHECKED_FREE`: `mm_free` trusts its argument like Conte's `tlsf_free` (no pool lookup, header or
+**   neighbour validation). Freeing a foreign pointer or freeing twice corrupts the heap instead of being ignored.
+**   Building with -DMM_UNCHECKED_FREE=1 enables it for every instance; MM_DEBUG builds ignore it.
+** - `MM_FLAG_BEST_FIT`: before rounding a request up to the next size class (good fit), scan up to MM_BEST_FIT_SCAN
+**   (default 8) blocks of its own class and take the smallest that fits. Less fragmentation on long-lived mixed
+**   workloads for a bounded extra search cost. Building with -DMM_BEST_FIT=1 enables it for every instance.
+** - `MM_FLAG_ADDRESS_ORDERED`: free lists are kept sorted by address instead of LIFO, so every size class hands out
+**   its lowest block first and live data settles into the lowest-addressed pools. Higher pools drain and can be
+**   given back with `mm_remove_pool` (see `mm_pool_is_empty`). Freeing costs a walk of the block's class list.
+**   Building with -DMM_ADDRESS_ORDERED=1 enables it for every instance.
+** - `MM_FLAG_CLUSTER_SMALL`: requests of at least MM_CLUSTER_LARGE (default 4096) bytes are carved from the top of
+**   the free block they split instead of the bottom, so small blocks stay packed together at the low end of free
+**   regions and share (huge) pages rather than interleaving with large payloads. Pairs with huge-page pools (see
+**   `mm_huge_map` in memoman_os.h). Building with -DMM_CLUSTER_SMALL=1 enables it for every instance.
+** - `MM_FLAG_REMOTE_FREE`: the instance has an owning thread (its creator, or the last caller of
+**   `mm_set_owner_thread`). `mm_free` from any other thread skips the lock and pushes the block onto a lock-free
+**   stack in the control block. Allocation calls drain that stack in bulk every `MM_REMOTE_DRAIN_INTERVAL` calls
+**   and before reporting failure (or on `mm_drain_remote_frees`), so queued blocks count as in use until then.
+**   Suits producer/consumer pipelines where the consumer frees what the producer allocated. Implies
+**   `MM_FLAG_THREAD_SAFE`. A remote free writes the first word of the payload immediately and is never validated
+**   before the drain, so freeing a foreign pointer corrupts memory. A double free while the block is still queued
+**   overwrites its link: the drain drops the duplicate, but every block queued before the first free of it is
+**   leaked for good and `mm_validate` does not notice. MM_DEBUG builds assert on it
+**   (MM_DEBUG_ABORT_ON_REMOTE_CYCLE, default 1).
+** - `MM_FLAG_SHARED`: the control block and its pools live in one shared memory segment that several processes
+**   may map at different addresses (see `mm_shm_create` in memoman_os.h). Requires a build with
+**   -DMM_RELATIVE_LINKS=1 (creation fails otherwise) and implies `MM_FLAG_THREAD_SAFE`: the lock is plain atomics
+**   in the control block, so it also serializes processes. `MM_FLAG_SLAB`, handles and trace hooks are refused,
+**   and the pools stay out of the process-wide registry, so use `mm_validate` instead of `mm_validate_pool`.
+*/
+#define MM_FLAG_THREAD_SAFE     0x1u
+#define MM_FLAG_SLAB            0x2u
+#define MM_FLAG_UNCHECKED_FREE  0x4u
+#define MM_FLAG_BEST_FIT        0x8u
+#define MM_FLAG_ADDRESS_ORDERED 0x10u
+#define MM_FLAG_SHARED          0x20u
+#define MM_FLAG_CLUSTER_SMALL   0x40u
+#define MM_FLAG_REMOTE_FREE     0x80u
+#define MM_FLAG_MASK \
+  (MM_FLAG_THREAD_SAFE | MM_FLAG_SLAB | MM_FLAG_UNCHECKED_FREE | MM_FLAG_BEST_FIT | MM_FLAG_ADDRESS_ORDERED | \
+   MM_FLAG_SHARED | MM_FLAG_CLUSTER_SMALL | MM_FLAG_REMOTE_FREE)
+
+tlsf_t mm_create_ex(void* mem, unsigned int flags);
+tlsf_t mm_create_with_pool_ex(void* mem, size_t bytes, unsigned int flags);
 pool_t mm_get_pool_for_ptr(tlsf_t alloc, const void* ptr);
+int mm_pool_is_empty(tlsf_t alloc, pool_t pool); /* O(log pools): nonzero if `pool` has no live allocations */
 int mm_reset(tlsf_t alloc);
+void mm_set_owner_thread(tlsf_t alloc);     /* MM_FLAG_REMOTE_FREE: the calling thread becomes the owner */
+size_t mm_drain_remote_frees(tlsf_t alloc); /* release queued remote frees now; returns how many */
+
+/*
+** Reattaching a heap (memoman extension).
+**
+** `mm_attach` reopens a heap whose bytes survived elsewhere, e.g. in a file-backed mapping written by an earlier
+** process (see `mm_file_heap_open` in memoman_os.h). `mem`/`bytes` must cover the control block and every pool
+** (as laid out by `mm_create_with_pool_ex`). The heap is checked against this build's layout, fully validated like
+** `mm_validate`, and returned with all live blocks intact; NULL if any check fails. Lock, trace hook and handle
+** table start out cleared. Builds with -DMM_RELATIVE_LINKS=1 can attach at any address; default builds only at the
+** address the heap was created at. `MM_FLAG_SLAB` heaps cannot be attached.
+**
+** The root slot stores one pointer into the heap (the entry point of the persisted data structure) and moves with
+** the heap like every other link.
+*/
+tlsf_t mm_attach(void* mem, size_t bytes);
+void mm_set_root(tlsf_t alloc, void* root);
+void* mm_get_root(tlsf_t alloc);
+
+/*
+** Statistics (memoman extension).
+**
+** Counters are maintained incrementally, so `mm_get_stats` is O(1) and cheap enough to poll every frame.
+** - `bytes_in_use`/`peak_bytes_in_use`: payload bytes of used blocks (slabs and thread-cached blocks count as used).
+** - `largest_free_block`: size of the first block in the largest non-empty free-list class, i.e. within one
+**   second-level class (2^-MM_SL_INDEX_COUNT_LOG2 of its size) of the exact largest free block; found from the
+**   bitmaps without walking lists.
+** - Operation counts are per block: batch calls add one per block, and `free_count` counts only blocks actually
+**   released (not NULL, foreign or already-free pointers). Thread caches count the blocks a refill takes from or a
+**   flush returns to the heap, not cache hits. `failed_count` counts calls that came back NULL (or short, for
+**   batches) for non-zero requests.
+*/
+typedef struct mm_stats_t {
+  size_t bytes_in_use;
+  size_t bytes_free;
+  size_t peak_bytes_in_use;
+  size_t largest_free_block;
+  size_t pool_bytes;
+  size_t malloc_count;
+  size_t memalign_count;
+  size_t realloc_count;
+  size_t free_count;
+  size_t failed_count;
+} mm_stats_t;
+
+int mm_get_stats(tlsf_t alloc, mm_stats_t* out);
+
+/*
+** Fragmentation report and free-space map (memoman extension).
+**
+** Both are computed from the segregated free lists alone: the bitmaps lead straight to the non-empty classes and
+** only free blocks are visited, never used ones. Cost is O(free blocks) under the instance lock, so they are cheap
+** enough to sample periodically; `mm_walk_pool` remains the full physical walk. Free slots inside slabs
+** (MM_FLAG_SLAB) sit in used blocks and are not counted.
+** - `largest_free_block`/`smallest_free_block` are exact (unlike the class-granular `mm_stats_t` field).
+** - `external_fragmentation` = 1 - largest_free_block / free_bytes, 0 when nothing is free: the share of free
+**   memory that no single request can use.
+** - `hist_blocks[i]`/`hist_bytes[i]` count free blocks with floor(log2(size)) == i.
+** - `mm_free_space_map` copies up to `n` non-empty free-list classes in ascending size order and returns the number
+**   copied; pass NULL to count them.
+*/
+#define MM_FRAG_HIST_BINS 64
+
+typedef struct mm_frag_report_t {
+  size_t free_bytes;
+  size_t free_blocks;
+  size_t largest_free_block;
+  size_t smallest_free_block;
+  size_t nonempty_classes;
+  double external_fragmentation;
+  size_t hist_blocks[MM_FRAG_HIST_BINS];
+  size_t hist_bytes[MM_FRAG_HIST_BINS];
+} mm_frag_report_t;
+
+typedef struct mm_free_class_t {
+  unsigned int fl;
+  unsigned int sl;
+  size_t min_size; /* smallest block size mapped to this class */
+  size_t max_size; /* largest block size mapped to this class */
+  size_t blocks;
+  size_t bytes;
+} mm_free_class_t;
+
+int mm_fragmentation_report(tlsf_t alloc, mm_frag_report_t* out);
+size_t mm_free_space_map(tlsf_t alloc, mm_free_class_t* out, size_t n);
+
+/*
+** Latency histograms (memoman extension, compiled in with -DMM_LATENCY=1).
+**
+** Each instance keeps one histogram per operation of the time spent in the public call (`mm_malloc`, `mm_free`,
+** `mm_realloc`, `mm_memalign`), lock wait included. Values are timer ticks: `rdtsc` on x86, `cntvct_el0` on
+** AArch64, nanoseconds elsewhere; `mm_latency_tick_ns` converts. Buckets are log-linear (HDR-style): exact below
+** 16 ticks, then 16 linear steps per power of two, so a reported percentile is at most 1/16 above the true value.
+** Samples of 2^32 ticks or more share the last bucket; `max` stays exact. Recording is two timer reads and one
+** counter increment under the instance lock.
+**
+** Without MM_LATENCY the functions still link: `mm_get_latency` and `mm_get_latency_buckets` return 0 and
+** `mm_latency_percentile` returns 0.
+*/
+typedef enum mm_op_t {
+  MM_OP_MALLOC = 0,
+  MM_OP_FREE,
+  MM_OP_REALLOC,
+  MM_OP_MEMALIGN,
+  MM_OP_COUNT
+} mm_op_t;
+
+typedef struct mm_latency_t {
+  uint64_t count;
+  uint64_t min;
+  uint64_t max;
+  uint64_t mean;
+  uint64_t p50;
+  uint64_t p90;
+  uint64_t p99;
+  uint64_t p999;
+} mm_latency_t;
+
+int mm_get_latency(tlsf_t alloc, mm_op_t op, mm_latency_t* out);
+uint64_t mm_latency_percentile(tlsf_t alloc, mm_op_t op, double quantile); /* quantile in [0, 1] */
+/* Copies up to `n` non-empty buckets as (inclusive upper bound, count) pairs in ascending order; returns the number
+** copied. Either array may be NULL to count only. */
+size_t mm_get_latency_buckets(tlsf_t alloc, mm_op_t op, uint64_t* upper, uint64_t* counts, size_t n);
+void mm_reset_latency(tlsf_t alloc);
+double mm_latency_tick_ns(void); /* nanoseconds per tick, calibrated once against CLOCK_MONOTONIC */
+
+/*
+** Trace hook (memoman extension).
+**
+** `mm_set_trace_hook` installs a callback that sees every heap operation on the instance, failed ones included:
+** `mm_malloc`, `mm_free`, `mm_realloc`, `mm_memalign`, each block of `mm_malloc_batch`/`mm_free_batch`, and the
+** refills/flushes of thread caches bound to the instance (cache hits never reach the heap and are not reported).
+** The hook runs after the operation, still under the instance lock, so events arrive in heap order on thread-safe
+** instances too; it must not call back into the same instance. Pass NULL to remove it. `extras/mm_trace.h`
+** provides a hook that writes the binary trace format replayed by `extras/replay`.
+*/
+typedef struct mm_trace_event_t {
+  mm_op_t op;
+  void* ptr;    /* free/realloc: the pointer passed in */
+  void* result; /* malloc/memalign/realloc: the pointer returned (NULL on failure) */
+  size_t size;  /* requested bytes (0 for free) */
+  size_t align; /* memalign only */
+} mm_trace_event_t;
+
+typedef void (*mm_trace_hook)(void* user, const mm_trace_event_t* event);
+
+void mm_set_trace_hook(tlsf_t alloc, mm_trace_hook hook, void* user);
+
+/*
+** Trimming (memoman extension, POSIX).
+**
+** Returns the interior pages of free blocks to the OS with `madvise` (MADV_DONTNEED by default; override with
+** -DMM_TRIM_ADVICE=MADV_FREE). Block headers, free-list links and prev_phys footers stay resident, so pools and
+** free lists are untouched and trimmed memory is simply faulted back in when reused. Its contents are then
+** unspecified: MADV_FREE pages the kernel has not reclaimed keep their old bytes, and shared (shm or file) mappings
+** reread the backing object, so never rely on it being zeroed. The smallest free blocks are skipped until
+** `keep_bytes` of free memory has been kept resident. Returns the number of bytes advised; O(free blocks). A no-op
+** returning 0 where `madvise` is unavailable.
+*/
+size_t mm_trim(tlsf_t alloc, size_t keep_bytes);
+
+/*
+** Thread caches (memoman extension).
+**
+** An `mm_tcache_t` is a per-thread front end for small requests (<= 256 bytes) on one allocator. Create it in
+** caller-provided memory of `mm_tcache_size()` bytes, use it from a single thread, and free its pointers through
+** `mm_tcache_free` (pointers from `mm_malloc` on the same allocator are accepted too). Cached blocks stay live in
+** the allocator until `mm_tcache_flush`/`mm_tcache_destroy`, so flush before `mm_reset`/`mm_remove_pool`.
+** Share the allocator between threads only if it was created with `MM_FLAG_THREAD_SAFE`.
+** `mm_tcache_free` trusts its argument like `MM_FLAG_UNCHECKED_FREE` (no pool lookup or header validation): a
+** foreign pointer corrupts the heap, and freeing a block twice caches it twice, so two later `mm_tcache_malloc`
+** calls return the same block. MM_DEBUG builds validate the pointer and ignore a block already in the magazine.
+*/
+typedef void* mm_tcache_t;
+
+size_t mm_tcache_size(void);
+mm_tcache_t mm_tcache_create(void* mem, tlsf_t alloc);
+void mm_tcache_destroy(mm_tcache_t cache);
+void* mm_tcache_malloc(mm_tcache_t cache, size_t bytes);
+void mm_tcache_free(mm_tcache_t cache, void* ptr);
+void mm_tcache_flush(mm_tcache_t cache);
+
+/*
+** Handles and compaction (memoman extension).
+**
+** `mm_halloc` returns a relocatable block named by a handle (0 = failure) instead of a raw pointer. `mm_hlock`
+** pins the block and returns its current address; `mm_hunlock` drops the pin (pins nest). Once a block is
+** unpinned, `mm_compact` may move it, so lock it again to get the new address. `mm_hfree` frees a block whether
+** it is pinned or not; stale handles are rejected by every call.
+**
+** `mm_compact(alloc, budget_us)` slides unpinned handle blocks towards the start of their pool and merges the free
+** space behind them. It resumes where the previous call stopped and returns when the budget is spent (0) or when a
+** full pass over every pool found nothing left to move (1). Each call advances to at least the next handle block,
+** so it can overrun its budget by that walk plus the copy of one block. Raw `mm_malloc` blocks and pinned handles
+** never move and act as barriers. Moves are reported to the trace hook as `MM_OP_REALLOC` of the old and new
+** addresses.
+**
+** The handle table lives in caller-provided memory of `mm_handle_table_size(capacity)` bytes, pointer-aligned,
+** attached with `mm_handles_attach` (at most 2^20 - 1 handles; pass NULL to detach). Attaching fails while
+** handles from the previous table are live. Each handle block carries one extra `mm_align_size()` word. Never pass
+** handle addresses to `mm_free`, `mm_realloc` or `mm_block_size`.
+*/
+typedef uint32_t mm_handle_t;
+
+size_t mm_handle_table_size(size_t capacity);
+int mm_handles_attach(tlsf_t alloc, void* mem, size_t capacity);
+mm_handle_t mm_halloc(tlsf_t alloc, size_t bytes);
+void* mm_hlock(tlsf_t alloc, mm_handle_t handle);
+void mm_hunlock(tlsf_t alloc, mm_handle_t handle);
+void mm_hfree(tlsf_t alloc, mm_handle_t handle);
+int mm_compact(tlsf_t alloc, unsigned int budget_us);
+
+/*
+** Arenas (memoman extension).
+**
+** An `mm_arena_t` bump-allocates short-lived objects out of chunks it takes from one allocator with `mm_malloc`
+** (`chunk_bytes` each, 0 = 16 KiB; larger requests get a chunk of their own). Objects are never freed one by one:
+** `mm_arena_save` takes a savepoint, `mm_arena_rewind` frees everything allocated after it, and `mm_arena_release`
+** hands every chunk back in one call while leaving the arena usable. Savepoints nest; rewinding to one invalidates
+** those taken after it. `mm_arena_footprint` is the total size of the chunks currently held.
+**
+** Create the arena in caller-provided, pointer-aligned memory of `mm_arena_size()` bytes and use it from one
+** thread. Release it before `mm_reset`/`mm_remove_pool` on the underlying allocator.
+*/
+typedef void* mm_arena_t;
+
+typedef struct mm_arena_mark_t {
+  void* chunk;
+  size_t offset;
+} mm_arena_mark_t;
+
+size_t mm_arena_size(void);
+mm_arena_t mm_arena_create(void* mem, tlsf_t alloc, size_t chunk_bytes);
+void mm_arena_destroy(mm_arena_t arena);
+void* mm_arena_alloc(mm_arena_t arena, size_t bytes);
+void* mm_arena_memalign(mm_arena_t arena, size_t align, size_t bytes);
+mm_arena_mark_t mm_arena_save(mm_arena_t arena);
+void mm_arena_rewind(mm_arena_t arena, mm_arena_mark_t mark);
+void mm_arena_release(mm_arena_t arena);
+size_t mm_arena_footprint(mm_arena_t arena);
 
 #if defined(__cplusplus)
 };
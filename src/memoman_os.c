@@ -0,0 +1,747 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "memoman_os.h"
+
+/*
+** memoman_os
+**
+** Growable heap backend: anonymous `mmap` regions registered as memoman pools. The core allocator stays
+** untouched; this file only decides when to add and remove pools.
+*/
+
+/* One region per core pool slot (MM_MAX_POOLS in memoman.c). */
+#define MM_OS_MAX_REGIONS 32
+
+/* Grown regions double in size up to this cap (a single large request may still exceed it). */
+#ifndef MM_OS_GROW_MAX
+#define MM_OS_GROW_MAX ((size_t)1 << 30)
+#endif
+
+typedef struct mm_os_region_t {
+  char* base;
+  size_t bytes;
+  pool_t pool;
+} mm_os_region_t;
+
+struct mm_os_heap_t {
+  tlsf_t alloc;
+  unsigned int flags;
+  size_t page_size;
+  size_t next_grow;
+  /* Serializes growth and release; allocation itself only takes the core lock. */
+  pthread_mutex_t lock;
+  size_t region_count;
+  mm_os_region_t regions[MM_OS_MAX_REGIONS]; /* regions[0] holds this struct and the control block */
+  pool_t spare;                              /* empty grown region kept mapped (hysteresis) */
+};
+
+#define MM_OS_HEADER_BYTES ((sizeof(mm_os_heap_t) + 15) & ~(size_t)15)
+
+static size_t os_round_pages(const mm_os_heap_t* heap, size_t bytes) {
+  size_t mask = heap->page_size - 1;
+  if (bytes > SIZE_MAX - mask) return 0;
+  return (bytes + mask) & ~mask;
+}
+
+static void* os_map(size_t bytes) {
+  void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+static void os_lock(mm_os_heap_t* heap) {
+  if (heap->flags & MM_FLAG_THREAD_SAFE) pthread_mutex_lock(&heap->lock);
+}
+
+static void os_unlock(mm_os_heap_t* heap) {
+  if (heap->flags & MM_FLAG_THREAD_SAFE) pthread_mutex_unlock(&heap->lock);
+}
+
+/* Maps and registers a region able to satisfy a request of `need` bytes. Caller holds the backend lock. */
+static int os_grow(mm_os_heap_t* heap, size_t need) {
+  if (heap->region_count >= MM_OS_MAX_REGIONS) return 0;
+  if (need > mm_block_size_max()) return 0;
+
+  /* Good-fit search rounds the request up by at most one SL class; leave room for it. */
+  size_t min_bytes = need + mm_fit_slack(need) + mm_align_size() + mm_pool_overhead() + mm_alloc_overhead();
+  size_t bytes = os_round_pages(heap, (min_bytes > heap->next_grow) ? min_bytes : heap->next_grow);
+  if (!bytes) return 0;
+
+  char* base = (char*)os_map(bytes);
+  if (!base) return 0;
+  pool_t pool = mm_add_pool(heap->alloc, base, bytes);
+  if (!pool) {
+    munmap(base, bytes);
+    return 0;
+  }
+
+  mm_os_region_t* r = &heap->regions[heap->region_count++];
+  r->base = base;
+  r->bytes = bytes;
+  r->pool = pool;
+  if (heap->next_grow < MM_OS_GROW_MAX) heap->next_grow <<= 1;
+  return 1;
+}
+
+/* Removes and unmaps `pool` if it is still empty. Caller holds the backend lock. Returns bytes released. */
+static size_t os_release(mm_os_heap_t* heap, pool_t pool) {
+  for (size_t i = 1; i < heap->region_count; i++) {
+    mm_os_region_t* r = &heap->regions[i];
+    if (r->pool != pool) continue;
+
+    if (!mm_pool_is_empty(heap->alloc, pool)) return 0;
+    mm_remove_pool(heap->alloc, pool);
+    /* Another thread may have allocated from it in between; then the core refused the removal. */
+    if (mm_get_pool_for_ptr(heap->alloc, (char*)pool + mm_alloc_overhead())) return 0;
+
+    size_t bytes = r->bytes;
+    munmap(r->base, bytes);
+    heap->regions[i] = heap->regions[--heap->region_count];
+    if (heap->spare == pool) heap->spare = NULL;
+    return bytes;
+  }
+  return 0;
+}
+
+mm_os_heap_t* mm_os_heap_create(size_t initial_bytes, unsigned int flags) {
+  long page = sysconf(_SC_PAGESIZE);
+  size_t page_size = (page > 0) ? (size_t)page : 4096;
+
+  size_t min_bytes = MM_OS_HEADER_BYTES + mm_size() + mm_pool_overhead() + mm_block_size_min();
+  size_t bytes = (initial_bytes > min_bytes) ? initial_bytes : min_bytes;
+  if (bytes > SIZE_MAX - (page_size - 1)) return NULL;
+  bytes = (bytes + page_size - 1) & ~(page_size - 1);
+
+  char* base = (char*)os_map(bytes);
+  if (!base) return NULL;
+
+  mm_os_heap_t* heap = (mm_os_heap_t*)base;
+  memset(heap, 0, sizeof(*heap));
+  heap->flags = flags;
+  heap->page_size = page_size;
+  heap->next_grow = bytes;
+  pthread_mutex_init(&heap->lock, NULL);
+
+  heap->alloc = mm_create_with_pool_ex(base + MM_OS_HEADER_BYTES, bytes - MM_OS_HEADER_BYTES, flags);
+  if (!heap->alloc) {
+    pthread_mutex_destroy(&heap->lock);
+    munmap(base, bytes);
+    return NULL;
+  }
+
+  heap->regions[0].base = base;
+  heap->regions[0].bytes = bytes;
+  heap->regions[0].pool = mm_get_pool(heap->alloc);
+  heap->region_count = 1;
+  return heap;
+}
+
+void mm_os_heap_destroy(mm_os_heap_t* heap) {
+  if (!heap) return;
+  mm_destroy(heap->alloc);
+
+  /* regions[0] holds `heap` itself: release it last from a local copy. */
+  mm_os_region_t first = heap->regions[0];
+  for (size_t i = heap->region_count; i-- > 1;) munmap(heap->regions[i].base, heap->regions[i].bytes);
+  pthread_mutex_destroy(&heap->lock);
+  munmap(first.base, first.bytes);
+}
+
+tlsf_t mm_os_heap_allocator(mm_os_heap_t* heap) {
+  return heap ? heap->alloc : NULL;
+}
+
+void* mm_os_malloc(mm_os_heap_t* heap, size_t bytes) {
+  if (!heap) return NULL;
+  void* p = mm_malloc(heap->alloc, bytes);
+  if (p || bytes == 0) return p;
+
+  os_lock(heap);
+  /* Another thread may have grown the heap while we waited. */
+  p = mm_malloc(heap->alloc, bytes);
+  if (!p && os_grow(heap, bytes)) p = mm_malloc(heap->alloc, bytes);
+  os_unlock(heap);
+  return p;
+}
+
+void* mm_os_memalign(mm_os_heap_t* heap, size_t align, size_t bytes) {
+  if (!heap) return NULL;
+  void* p = mm_memalign(heap->alloc, align, bytes);
+  if (p || bytes == 0 || align == 0 || (align & (align - 1)) != 0) return p;
+  if (bytes > SIZE_MAX - 2 * align) return NULL;
+
+  os_lock(heap);
+  p = mm_memalign(heap->alloc, align, bytes);
+  /* Worst case the aligned block needs a leading gap of up to `align` plus a minimum free block. */
+  if (!p && os_grow(heap, bytes + 2 * align)) p = mm_memalign(heap->alloc, align, bytes);
+  os_unlock(heap);
+  return p;
+}
+
+void* mm_os_realloc(mm_os_heap_t* heap, void* ptr, size_t size) {
+  if (!heap) return NULL;
+  if (!ptr) return mm_os_malloc(heap, size);
+  void* p = mm_realloc(heap->alloc, ptr, size);
+  if (p || size == 0) return p;
+
+  /* A failed realloc leaves `ptr` untouched, so growing and retrying is safe. */
+  os_lock(heap);
+  p = mm_realloc(heap->alloc, ptr, size);
+  if (!p && os_grow(heap, size)) p = mm_realloc(heap->alloc, ptr, size);
+  os_unlock(heap);
+  return p;
+}
+
+void mm_os_free(mm_os_heap_t* heap, void* ptr) {
+  if (!heap || !ptr) return;
+  pool_t pool = mm_get_pool_for_ptr(heap->alloc, ptr);
+  mm_free(heap->alloc, ptr);
+  if (!pool || pool == heap->regions[0].pool) return;
+  if (!mm_pool_is_empty(heap->alloc, pool)) return;
+
+  /* Keep the newest empty region as the spare; an older spare that is still empty goes back to the OS. */
+  os_lock(heap);
+  if (heap->spare != pool) {
+    pool_t old = heap->spare;
+    heap->spare = pool;
+    if (old) os_release(heap, old);
+  }
+  os_unlock(heap);
+}
+
+size_t mm_os_heap_trim(mm_os_heap_t* heap) {
+  if (!heap) return 0;
+  size_t released = 0;
+  os_lock(heap);
+  for (size_t i = heap->region_count; i-- > 1;) {
+    /* os_release swaps the last region into slot i, which has already been visited. */
+    released += os_release(heap, heap->regions[i].pool);
+  }
+  heap->spare = NULL;
+  os_unlock(heap);
+  return released;
+}
+
+size_t mm_os_heap_region_count(mm_os_heap_t* heap) {
+  if (!heap) return 0;
+  os_lock(heap);
+  size_t n = heap->region_count;
+  os_unlock(heap);
+  return n;
+}
+
+size_t mm_os_heap_mapped_bytes(mm_os_heap_t* heap) {
+  if (!heap) return 0;
+  size_t total = 0;
+  os_lock(heap);
+  for (size_t i = 0; i < heap->region_count; i++) total += heap->regions[i].bytes;
+  os_unlock(heap);
+  return total;
+}
+
+/*
+** Huge-page pools.
+**
+** MAP_HUGETLB first (the page size is encoded in the flags as log2 << MAP_HUGE_SHIFT); on failure, over-map
+** normal pages by one huge page, trim both ends to a huge-page boundary and advise THP.
+*/
+#define MM_HUGE_DEFAULT_PAGE ((size_t)2 << 20)
+
+static void* huge_map_hugetlb(size_t bytes, size_t page_size) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  int shift = 0;
+  while (((size_t)1 << shift) < page_size) shift++;
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT);
+  void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+#else
+  (void)bytes;
+  (void)page_size;
+  return NULL;
+#endif
+}
+
+static char* huge_map_aligned(size_t bytes, size_t page_size) {
+  if (bytes > SIZE_MAX - page_size) return NULL;
+  char* raw = (char*)os_map(bytes + page_size);
+  if (!raw) return NULL;
+  char* base = (char*)(((uintptr_t)raw + page_size - 1) & ~(uintptr_t)(page_size - 1));
+  size_t head = (size_t)(base - raw);
+  if (head) munmap(raw, head);
+  if (page_size - head) munmap(base + bytes, page_size - head);
+  return base;
+}
+
+int mm_huge_map(mm_huge_region_t* out, size_t bytes, size_t page_size) {
+  if (!out) return 0;
+  memset(out, 0, sizeof(*out));
+  if (page_size == 0) page_size = MM_HUGE_DEFAULT_PAGE;
+  long page = sysconf(_SC_PAGESIZE);
+  if ((page_size & (page_size - 1)) != 0 || (page > 0 && page_size < (size_t)page)) return 0;
+  if (bytes == 0 || bytes > SIZE_MAX - (page_size - 1)) return 0;
+  bytes = (bytes + page_size - 1) & ~(page_size - 1);
+
+  mm_huge_backing_t backing = MM_HUGE_HUGETLB;
+  char* base = (char*)huge_map_hugetlb(bytes, page_size);
+  if (!base) {
+    base = huge_map_aligned(bytes, page_size);
+    if (!base) return 0;
+    backing = MM_HUGE_NONE;
+#ifdef MADV_HUGEPAGE
+    if (madvise(base, bytes, MADV_HUGEPAGE) == 0) backing = MM_HUGE_THP;
+#endif
+  }
+
+  out->base = base;
+  out->bytes = bytes;
+  out->page_size = page_size;
+  out->backing = backing;
+  return 1;
+}
+
+void mm_huge_unmap(mm_huge_region_t* region) {
+  if (!region || !region->base) return;
+  munmap(region->base, region->bytes);
+  memset(region, 0, sizeof(*region));
+}
+
+pool_t mm_add_huge_pool(tlsf_t alloc, mm_huge_region_t* out, size_t bytes, size_t page_size) {
+  if (!alloc || !mm_huge_map(out, bytes, page_size)) return NULL;
+  pool_t pool = mm_add_pool(alloc, out->base, out->bytes);
+  if (!pool) mm_huge_unmap(out);
+  return pool;
+}
+
+/*
+** NUMA multi-heap front end.
+**
+** The front-end state lives in its own small mapping; node i's control block and pool share one region bound with
+** mbind(MPOL_BIND) while still untouched. The CPU -> heap table is read once from sysfs at creation; routing after
+** that is a table lookup on sched_getcpu().
+*/
+#define MM_NUMA_MAX_CPUS 4096
+#define MM_NUMA_MAX_OS_NODE 1024 /* node ids the mbind mask can express */
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+
+typedef struct mm_numa_node_t {
+  char* base;
+  size_t bytes;
+  tlsf_t alloc;
+  int bound;
+} mm_numa_node_t;
+
+struct mm_numa_heap_t {
+  size_t bytes; /* of this mapping */
+  mm_numa_topology_t topo;
+  mm_numa_node_t nodes[MM_NUMA_MAX_NODES];
+  signed char cpu_heap[MM_NUMA_MAX_CPUS]; /* heap index per CPU, -1 when unknown */
+};
+
+/* Calls `fn(cpu, arg)` for every CPU in a sysfs cpulist such as "0-3,8,10-11". */
+static void numa_parse_cpulist(const char* list, void (*fn)(long cpu, void* arg), void* arg) {
+  const char* p = list;
+  while (*p) {
+    char* end;
+    long lo = strtol(p, &end, 10);
+    if (end == p) break;
+    long hi = lo;
+    if (*end == '-') {
+      p = end + 1;
+      hi = strtol(p, &end, 10);
+      if (end == p) break;
+    }
+    for (long cpu = lo; cpu <= hi; cpu++) fn(cpu, arg);
+    p = (*end == ',') ? end + 1 : end;
+    if (*p == '\n') break;
+  }
+}
+
+static int numa_read_cpulist(int os_node, char* buf, size_t n) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", os_node);
+  FILE* f = fopen(path, "r");
+  if (!f) return 0;
+  int ok = fgets(buf, (int)n, f) != NULL;
+  fclose(f);
+  return ok;
+}
+
+int mm_numa_topology_detect(mm_numa_topology_t* out) {
+  if (!out) return 0;
+  memset(out, 0, sizeof(*out));
+  char buf[1024];
+  for (int id = 0; id < MM_NUMA_MAX_OS_NODE && out->node_count < MM_NUMA_MAX_NODES; id++) {
+    if (numa_read_cpulist(id, buf, sizeof(buf))) out->os_node[out->node_count++] = id;
+  }
+  if (out->node_count == 0) {
+    out->node_count = 1;
+    out->os_node[0] = -1;
+  }
+  return 1;
+}
+
+typedef struct numa_cpu_fill_t {
+  mm_numa_heap_t* heap;
+  signed char index;
+} numa_cpu_fill_t;
+
+static void numa_assign_cpu(long cpu, void* arg) {
+  numa_cpu_fill_t* fill = (numa_cpu_fill_t*)arg;
+  if (cpu >= 0 && cpu < MM_NUMA_MAX_CPUS) fill->heap->cpu_heap[cpu] = fill->index;
+}
+
+static int numa_bind(void* addr, size_t bytes, int os_node) {
+#ifdef SYS_mbind
+  if (os_node < 0 || os_node >= MM_NUMA_MAX_OS_NODE) return 0;
+  unsigned long mask[MM_NUMA_MAX_OS_NODE / (8 * sizeof(unsigned long))];
+  memset(mask, 0, sizeof(mask));
+  mask[(size_t)os_node / (8 * sizeof(unsigned long))] = 1ul << ((size_t)os_node % (8 * sizeof(unsigned long)));
+  /* The kernel reads maxnode - 1 bits. */
+  return syscall(SYS_mbind, addr, bytes, MPOL_BIND, mask, (unsigned long)MM_NUMA_MAX_OS_NODE + 1, 0) == 0;
+#else
+  (void)addr;
+  (void)bytes;
+  (void)os_node;
+  return 0;
+#endif
+}
+
+mm_numa_heap_t* mm_numa_heap_create(size_t bytes_per_node, unsigned int flags, const mm_numa_topology_t* topo) {
+  mm_numa_topology_t detected;
+  if (!topo) {
+    mm_numa_topology_detect(&detected);
+    topo = &detected;
+  }
+  if (topo->node_count == 0 || topo->node_count > MM_NUMA_MAX_NODES) return NULL;
+  /* mm_numa_realloc copies mm_block_size(ptr) bytes, which slab slots do not carry in a header. */
+  if (flags & MM_FLAG_SLAB) return NULL;
+
+  long page = sysconf(_SC_PAGESIZE);
+  size_t page_size = (page > 0) ? (size_t)page : 4096;
+  size_t min_bytes = mm_size() + mm_pool_overhead() + mm_block_size_min();
+  if (bytes_per_node < min_bytes) bytes_per_node = min_bytes;
+  if (bytes_per_node > SIZE_MAX - (page_size - 1)) return NULL;
+  bytes_per_node = (bytes_per_node + page_size - 1) & ~(page_size - 1);
+
+  size_t self_bytes = (sizeof(mm_numa_heap_t) + page_size - 1) & ~(page_size - 1);
+  mm_numa_heap_t* heap = (mm_numa_heap_t*)os_map(self_bytes);
+  if (!heap) return NULL;
+  heap->bytes = self_bytes;
+  heap->topo = *topo;
+  memset(heap->cpu_heap, -1, sizeof(heap->cpu_heap));
+
+  char buf[1024];
+  for (size_t i = 0; i < topo->node_count; i++) {
+    mm_numa_node_t* node = &heap->nodes[i];
+    node->base = (char*)os_map(bytes_per_node);
+    if (!node->base) {
+      mm_numa_heap_destroy(heap);
+      return NULL;
+    }
+    node->bytes = bytes_per_node;
+    node->bound = numa_bind(node->base, bytes_per_node, topo->os_node[i]);
+    node->alloc = mm_create_with_pool_ex(node->base, bytes_per_node, flags);
+    if (!node->alloc) {
+      mm_numa_heap_destroy(heap);
+      return NULL;
+    }
+    if (topo->os_node[i] >= 0 && numa_read_cpulist(topo->os_node[i], buf, sizeof(buf))) {
+      numa_cpu_fill_t fill = {heap, (signed char)i};
+      numa_parse_cpulist(buf, numa_assign_cpu, &fill);
+    }
+  }
+  return heap;
+}
+
+void mm_numa_heap_destroy(mm_numa_heap_t* heap) {
+  if (!heap) return;
+  for (size_t i = 0; i < MM_NUMA_MAX_NODES; i++) {
+    mm_numa_node_t* node = &heap->nodes[i];
+    if (node->alloc) mm_destroy(node->alloc);
+    if (node->base) munmap(node->base, node->bytes);
+  }
+  munmap(heap, heap->bytes);
+}
+
+size_t mm_numa_node_count(mm_numa_heap_t* heap) {
+  return heap ? heap->topo.node_count : 0;
+}
+
+tlsf_t mm_numa_allocator(mm_numa_heap_t* heap, size_t node) {
+  if (!heap || node >= heap->topo.node_count) return NULL;
+  return heap->nodes[node].alloc;
+}
+
+int mm_numa_node_bound(mm_numa_heap_t* heap, size_t node) {
+  if (!heap || node >= heap->topo.node_count) return 0;
+  return heap->nodes[node].bound;
+}
+
+int mm_numa_current_node(mm_numa_heap_t* heap) {
+  if (!heap) return -1;
+  int index = 0;
+  if (heap->topo.current_node) {
+    index = heap->topo.current_node(heap->topo.user);
+  } else {
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < MM_NUMA_MAX_CPUS && heap->cpu_heap[cpu] >= 0) index = heap->cpu_heap[cpu];
+  }
+  return (index >= 0 && (size_t)index < heap->topo.node_count) ? index : 0;
+}
+
+int mm_numa_node_of(mm_numa_heap_t* heap, const void* ptr) {
+  if (!heap || !ptr) return -1;
+  for (size_t i = 0; i < heap->topo.node_count; i++) {
+    if (mm_get_pool_for_ptr(heap->nodes[i].alloc, ptr)) return (int)i;
+  }
+  return -1;
+}
+
+void* mm_numa_malloc_node(mm_numa_heap_t* heap, size_t node, size_t bytes) {
+  if (!heap || node >= heap->topo.node_count) return NULL;
+  return mm_malloc(heap->nodes[node].alloc, bytes);
+}
+
+void* mm_numa_malloc(mm_numa_heap_t* heap, size_t bytes) {
+  if (!heap || bytes == 0) return NULL;
+  size_t local = (size_t)mm_numa_current_node(heap);
+  void* p = mm_malloc(heap->nodes[local].alloc, bytes);
+  /* Remote memory beats failing: try the other nodes in order. */
+  for (size_t i = 0; !p && i < heap->topo.node_count; i++) {
+    if (i != local) p = mm_malloc(heap->nodes[i].alloc, bytes);
+  }
+  return p;
+}
+
+void* mm_numa_realloc(mm_numa_heap_t* heap, void* ptr, size_t size) {
+  if (!heap) return NULL;
+  if (!ptr) return mm_numa_malloc(heap, size);
+  int owner = mm_numa_node_of(heap, ptr);
+  if (owner < 0) return NULL;
+  if (size == 0) {
+    mm_free(heap->nodes[owner].alloc, ptr);
+    return NULL;
+  }
+  void* p = mm_realloc(heap->nodes[owner].alloc, ptr, size);
+  if (p) return p;
+
+  /* The owning node is full: move the block to whichever node has room. */
+  p = mm_numa_malloc(heap, size);
+  if (!p) return NULL;
+  size_t old = mm_block_size(ptr);
+  memcpy(p, ptr, (old < size) ? old : size);
+  mm_free(heap->nodes[owner].alloc, ptr);
+  return p;
+}
+
+void mm_numa_free(mm_numa_heap_t* heap, void* ptr) {
+  int owner = mm_numa_node_of(heap, ptr);
+  if (owner >= 0) mm_free(heap->nodes[owner].alloc, ptr);
+}
+
+/*
+** Shared-memory heaps.
+**
+** Segment layout: [mm_shm_header_t][control block][pool ...]. The core stores every link relative to its own
+** address (MM_RELATIVE_LINKS), so each process can map the segment anywhere; the header only lets `mm_shm_open`
+** check that the segment is a finished heap and lets `mm_shm_close` find the mapping again from the allocator.
+*/
+#define MM_SHM_MAGIC 0x6d6d73686d686561ull /* "mmshmhea" */
+
+typedef struct mm_shm_header_t {
+  uint64_t magic; /* published last: a segment without it is not (yet) a heap */
+  size_t bytes;
+} mm_shm_header_t;
+
+#define MM_SHM_HEADER_BYTES ((sizeof(mm_shm_header_t) + 15) & ~(size_t)15)
+
+static void* shm_map(int fd, size_t bytes) {
+  void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+tlsf_t mm_shm_create(const char* name, size_t bytes, unsigned int flags) {
+  if (!name) return NULL;
+  long page = sysconf(_SC_PAGESIZE);
+  size_t page_size = (page > 0) ? (size_t)page : 4096;
+
+  size_t min_bytes = MM_SHM_HEADER_BYTES + mm_size() + mm_pool_overhead() + mm_block_size_min();
+  if (bytes < min_bytes) bytes = min_bytes;
+  if (bytes > SIZE_MAX - (page_size - 1)) return NULL;
+  bytes = (bytes + page_size - 1) & ~(page_size - 1);
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return NULL;
+  char* base = NULL;
+  if (ftruncate(fd, (off_t)bytes) == 0) base = (char*)shm_map(fd, bytes);
+  close(fd);
+  if (!base) {
+    shm_unlink(name);
+    return NULL;
+  }
+
+  size_t heap_bytes = bytes - MM_SHM_HEADER_BYTES;
+  tlsf_t alloc = mm_create_with_pool_ex(base + MM_SHM_HEADER_BYTES, heap_bytes, flags | MM_FLAG_SHARED);
+  if (!alloc) {
+    munmap(base, bytes);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  mm_shm_header_t* header = (mm_shm_header_t*)base;
+  header->bytes = bytes;
+  __atomic_store_n(&header->magic, MM_SHM_MAGIC, __ATOMIC_RELEASE);
+  return alloc;
+}
+
+tlsf_t mm_shm_open(const char* name) {
+  if (!name) return NULL;
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) return NULL;
+  struct stat st;
+  char* base = NULL;
+  size_t bytes = 0;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size > MM_SHM_HEADER_BYTES) {
+    bytes = (size_t)st.st_size;
+    base = (char*)shm_map(fd, bytes);
+  }
+  close(fd);
+  if (!base) return NULL;
+
+  mm_shm_header_t* header = (mm_shm_header_t*)base;
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != MM_SHM_MAGIC || header->bytes != bytes) {
+    munmap(base, bytes);
+    return NULL;
+  }
+  return (tlsf_t)(base + MM_SHM_HEADER_BYTES);
+}
+
+void mm_shm_close(tlsf_t alloc) {
+  if (!alloc) return;
+  /* No mm_destroy: other processes keep using the heap. */
+  mm_shm_header_t* header = (mm_shm_header_t*)((char*)alloc - MM_SHM_HEADER_BYTES);
+  munmap(header, header->bytes);
+}
+
+int mm_shm_unlink(const char* name) {
+  return (name && shm_unlink(name) == 0) ? 1 : 0;
+}
+
+size_t mm_shm_offset(tlsf_t alloc, const void* ptr) {
+  if (!alloc || !ptr) return 0;
+  return (size_t)((const char*)ptr - (const char*)alloc);
+}
+
+void* mm_shm_pointer(tlsf_t alloc, size_t offset) {
+  if (!alloc || !offset) return NULL;
+  return (char*)alloc + offset;
+}
+
+/*
+** Persistent file heaps.
+**
+** File layout: [mm_file_header_t][control block][pool]. Creating builds the heap in a fresh MAP_SHARED mapping
+** and publishes the magic last; reopening maps the file (preferring the address it was last mapped at, which
+** builds without MM_RELATIVE_LINKS depend on) and hands it to `mm_attach`, which checks and validates the heap.
+*/
+#define MM_FILE_MAGIC 0x6d6d66696c656865ull /* "mmfilehe" */
+
+typedef struct mm_file_header_t {
+  uint64_t magic; /* published last: a file without it never held a finished heap */
+  size_t bytes;
+  void* addr; /* where the file was last mapped: a placement hint only */
+} mm_file_header_t;
+
+#define MM_FILE_HEADER_BYTES ((sizeof(mm_file_header_t) + 15) & ~(size_t)15)
+
+static void* file_map(int fd, size_t bytes, void* hint) {
+  void* p = mmap(hint, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+static tlsf_t file_heap_create(int fd, size_t bytes, unsigned int flags) {
+  long page = sysconf(_SC_PAGESIZE);
+  size_t page_size = (page > 0) ? (size_t)page : 4096;
+  size_t min_bytes = MM_FILE_HEADER_BYTES + mm_size() + mm_pool_overhead() + mm_block_size_min();
+  if (bytes < min_bytes) bytes = min_bytes;
+  if (bytes > SIZE_MAX - (page_size - 1)) return NULL;
+  bytes = (bytes + page_size - 1) & ~(page_size - 1);
+
+  if (ftruncate(fd, (off_t)bytes) != 0) return NULL;
+  char* base = (char*)file_map(fd, bytes, NULL);
+  if (!base) return NULL;
+  tlsf_t alloc = mm_create_with_pool_ex(base + MM_FILE_HEADER_BYTES, bytes - MM_FILE_HEADER_BYTES, flags);
+  if (!alloc) {
+    munmap(base, bytes);
+    return NULL;
+  }
+
+  mm_file_header_t* header = (mm_file_header_t*)base;
+  header->bytes = bytes;
+  header->addr = base;
+  __atomic_store_n(&header->magic, MM_FILE_MAGIC, __ATOMIC_RELEASE);
+  return alloc;
+}
+
+static tlsf_t file_heap_reopen(int fd, size_t bytes) {
+  mm_file_header_t probe;
+  if (pread(fd, &probe, sizeof(probe), 0) != (ssize_t)sizeof(probe)) return NULL;
+  if (probe.magic != MM_FILE_MAGIC || probe.bytes != bytes) return NULL;
+
+  char* base = (char*)file_map(fd, bytes, probe.addr);
+  if (!base) return NULL;
+  tlsf_t alloc = mm_attach(base + MM_FILE_HEADER_BYTES, bytes - MM_FILE_HEADER_BYTES);
+  if (!alloc) {
+    munmap(base, bytes);
+    return NULL;
+  }
+  ((mm_file_header_t*)base)->addr = base;
+  return alloc;
+}
+
+tlsf_t mm_file_heap_open(const char* path, size_t bytes, unsigned int flags) {
+  if (!path) return NULL;
+  int fd = open(path, O_RDWR | O_CREAT, 0600);
+  if (fd < 0) return NULL;
+  struct stat st;
+  tlsf_t alloc = NULL;
+  if (fstat(fd, &st) == 0) {
+    if (st.st_size == 0) {
+      alloc = file_heap_create(fd, bytes, flags);
+    } else if ((size_t)st.st_size > MM_FILE_HEADER_BYTES) {
+      alloc = file_heap_reopen(fd, (size_t)st.st_size);
+    }
+  }
+  close(fd);
+  return alloc;
+}
+
+int mm_file_heap_sync(tlsf_t alloc) {
+  if (!alloc) return 0;
+  mm_file_header_t* header = (mm_file_header_t*)((char*)alloc - MM_FILE_HEADER_BYTES);
+  return msync(header, header->bytes, MS_SYNC) == 0 ? 1 : 0;
+}
+
+void mm_file_heap_close(tlsf_t alloc) {
+  if (!alloc) return;
+  mm_file_header_t* header = (mm_file_header_t*)((char*)alloc - MM_FILE_HEADER_BYTES);
+  size_t bytes = header->bytes;
+  mm_destroy(alloc);
+  msync(header, bytes, MS_SYNC);
+  munmap(header, bytes);
+}
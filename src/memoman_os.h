@@ -0,0 +1,165 @@
+#ifndef INCLUDED_memoman_os
+#define INCLUDED_memoman_os
+
+/*
+** memoman_os: optional OS-backed growable heap on top of the memoman core.
+**
+** The core (`memoman.c`) never maps or unmaps memory. This backend owns a memoman instance whose pools come from
+** anonymous `mmap` regions:
+** - When an allocation fails, a new region (geometrically growing, at least large enough for the request) is
+**   mapped and registered with `mm_add_pool`, then the allocation is retried once.
+** - When a free leaves a grown region without live allocations, the region is kept as a spare. A second empty
+**   region causes the older spare to be removed with `mm_remove_pool` and returned with `munmap` (hysteresis:
+**   one spare absorbs alloc/free oscillation at a region boundary).
+** - The first region holds the backend state, the control block and the first pool; it is never unmapped.
+**
+** Link `src/memoman_os.c` alongside `src/memoman.c` to use it. POSIX only.
+*/
+
+#include <stddef.h>
+
+#include "memoman.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct mm_os_heap_t mm_os_heap_t;
+
+/*
+** `initial_bytes` sizes the first region (rounded up to whole pages); `flags` are passed to `mm_create_ex`
+** (`MM_FLAG_THREAD_SAFE` also makes growth and release safe to call from several threads).
+*/
+mm_os_heap_t* mm_os_heap_create(size_t initial_bytes, unsigned int flags);
+void mm_os_heap_destroy(mm_os_heap_t* heap);
+
+/* The underlying allocator, for the rest of the memoman API (stats, validation, walking pools). */
+tlsf_t mm_os_heap_allocator(mm_os_heap_t* heap);
+
+void* mm_os_malloc(mm_os_heap_t* heap, size_t bytes);
+void* mm_os_memalign(mm_os_heap_t* heap, size_t align, size_t bytes);
+void* mm_os_realloc(mm_os_heap_t* heap, void* ptr, size_t size);
+void mm_os_free(mm_os_heap_t* heap, void* ptr);
+
+/* Unmaps every empty grown region now, including the spare. Returns the number of bytes released. */
+size_t mm_os_heap_trim(mm_os_heap_t* heap);
+
+/* Number of currently mapped regions (including the first) and their total size. */
+size_t mm_os_heap_region_count(mm_os_heap_t* heap);
+size_t mm_os_heap_mapped_bytes(mm_os_heap_t* heap);
+
+/*
+** Huge-page pools.
+**
+** `mm_huge_map` maps `bytes` of anonymous memory rounded up to and aligned on `page_size` (a huge page size such as
+** 2 MiB or 1 GiB; 0 means 2 MiB). It first asks for explicit huge pages with MAP_HUGETLB, which only succeeds when
+** pages of that size are reserved (vm.nr_hugepages, or hugepagesz=/hugepages= at boot). Otherwise it maps normal
+** pages on a `page_size` boundary and requests transparent huge pages with madvise(MADV_HUGEPAGE); the kernel then
+** backs it with 2 MiB pages when it can. `backing` records which of the two (or neither) was obtained.
+** `mm_add_huge_pool` maps a region and registers it with `mm_add_pool` in one step; remove the pool with
+** `mm_remove_pool` before `mm_huge_unmap`. Combine with `MM_FLAG_CLUSTER_SMALL` to keep small blocks packed into
+** few huge pages.
+*/
+typedef enum mm_huge_backing_t {
+  MM_HUGE_NONE = 0, /* normal pages: THP unavailable or disabled */
+  MM_HUGE_THP,      /* madvise(MADV_HUGEPAGE) accepted: transparent huge pages, best effort */
+  MM_HUGE_HUGETLB   /* MAP_HUGETLB: reserved huge pages of `page_size` */
+} mm_huge_backing_t;
+
+typedef struct mm_huge_region_t {
+  void* base;
+  size_t bytes;
+  size_t page_size;
+  mm_huge_backing_t backing;
+} mm_huge_region_t;
+
+int mm_huge_map(mm_huge_region_t* out, size_t bytes, size_t page_size);
+void mm_huge_unmap(mm_huge_region_t* region);
+pool_t mm_add_huge_pool(tlsf_t alloc, mm_huge_region_t* out, size_t bytes, size_t page_size);
+
+/*
+** NUMA multi-heap front end.
+**
+** One fixed-size memoman instance per NUMA node. Each node's region is mapped and bound to its node with mbind(2)
+** (raw syscall, no libnuma) before it is first touched, so its pages come from that node's memory.
+** `mm_numa_malloc` serves the calling CPU's node and falls back to the other nodes, in order, when the local heap is
+** full; `mm_numa_free` finds the owning heap with `mm_get_pool_for_ptr`, so memory freed on any thread goes back
+** to the node it came from. Pass `MM_FLAG_THREAD_SAFE` in `flags` when several threads share the front end;
+** `MM_FLAG_SLAB` is refused.
+**
+** `topo` NULL reads the machine's topology from /sys/devices/system/node (`mm_numa_topology_detect`; a machine
+** without it is one unbound node). A caller-supplied topology can describe nodes that do not exist, e.g. to test
+** routing on a single-node machine: `os_node[i]` is the node heap i is bound to (-1 leaves it unbound; binding to
+** a missing node just fails, see `mm_numa_node_bound`), and `current_node`, when set, replaces the CPU lookup and
+** returns the heap index for the calling thread.
+*/
+#define MM_NUMA_MAX_NODES 16
+
+typedef struct mm_numa_heap_t mm_numa_heap_t;
+
+typedef struct mm_numa_topology_t {
+  size_t node_count;
+  int os_node[MM_NUMA_MAX_NODES];
+  int (*current_node)(void* user);
+  void* user;
+} mm_numa_topology_t;
+
+int mm_numa_topology_detect(mm_numa_topology_t* out);
+mm_numa_heap_t* mm_numa_heap_create(size_t bytes_per_node, unsigned int flags, const mm_numa_topology_t* topo);
+void mm_numa_heap_destroy(mm_numa_heap_t* heap);
+
+size_t mm_numa_node_count(mm_numa_heap_t* heap);
+tlsf_t mm_numa_allocator(mm_numa_heap_t* heap, size_t node); /* node's instance, for stats and validation */
+int mm_numa_node_bound(mm_numa_heap_t* heap, size_t node);    /* nonzero if mbind placed the node's region */
+int mm_numa_current_node(mm_numa_heap_t* heap);
+int mm_numa_node_of(mm_numa_heap_t* heap, const void* ptr);   /* owning node, -1 for foreign pointers */
+
+void* mm_numa_malloc(mm_numa_heap_t* heap, size_t bytes);
+void* mm_numa_malloc_node(mm_numa_heap_t* heap, size_t node, size_t bytes); /* that node only, no fallback */
+void* mm_numa_realloc(mm_numa_heap_t* heap, void* ptr, size_t size);
+void mm_numa_free(mm_numa_heap_t* heap, void* ptr);
+
+/*
+** Shared-memory heaps.
+**
+** `mm_shm_create` creates the POSIX shared memory object `name` (e.g. "/msg-heap", see shm_open(3)) with `bytes`
+** bytes (rounded up to whole pages), maps it and builds a fixed-size `MM_FLAG_SHARED` heap in it; `flags` are
+** added to that. `mm_shm_open` maps an existing heap in any process, at whatever address the kernel picks. Both
+** return the allocator of this process's view, usable with the whole core API.
+**
+** Pointers are only meaningful in the view they came from: pass `mm_shm_offset` values between processes and turn
+** them back with `mm_shm_pointer` (offset 0 is NULL). `mm_shm_close` unmaps one view; `mm_shm_unlink` removes the
+** name, and the memory goes away once every view is closed. A process that dies inside an allocator call leaves the
+** lock held. Requires memoman.c built with -DMM_RELATIVE_LINKS=1; otherwise `mm_shm_create` fails.
+*/
+tlsf_t mm_shm_create(const char* name, size_t bytes, unsigned int flags);
+tlsf_t mm_shm_open(const char* name);
+void mm_shm_close(tlsf_t alloc);
+int mm_shm_unlink(const char* name);
+size_t mm_shm_offset(tlsf_t alloc, const void* ptr);
+void* mm_shm_pointer(tlsf_t alloc, size_t offset);
+
+/*
+** Persistent file heaps.
+**
+** `mm_file_heap_open` maps the file at `path` with MAP_SHARED. An empty or new file gets a fresh fixed-size heap of
+** `bytes` bytes (rounded up to whole pages) built with `flags`; a file that already holds a heap is reopened with
+** `mm_attach`, so every block allocated before the last close (or crash) is still there, and `bytes`/`flags` are
+** ignored. Returns NULL if the file holds anything else or fails validation. Keep the entry point of the stored data
+** in the root slot (`mm_set_root`/`mm_get_root`).
+**
+** Default builds must map the heap where it was last mapped and fail to open if that address is taken; with
+** memoman.c built with -DMM_RELATIVE_LINKS=1 the heap may land anywhere. Only the allocator's own links move with
+** it: pointers stored in user data are not rewritten, so link persisted objects by offsets from the allocator.
+** `mm_file_heap_sync` flushes the mapping to disk (msync); `mm_file_heap_close` flushes and unmaps. A crash inside
+** an allocator call can leave the heap inconsistent; the next open then fails instead of handing it out.
+*/
+tlsf_t mm_file_heap_open(const char* path, size_t bytes, unsigned int flags);
+int mm_file_heap_sync(tlsf_t alloc);
+void mm_file_heap_close(tlsf_t alloc);
+
+#if defined(__cplusplus)
+};
+#endif
+
+#endif
@@ -0,0 +1,172 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memoman_os.h"
+
+/*
+** memoman_preload
+**
+** Drop-in malloc interposer for evaluating memoman on unmodified binaries:
+**
+**   make preload && LD_PRELOAD=./libmemoman.so ./some_program
+**
+** - Bootstrap: the heap is created lazily by the first allocation call. Creation only uses `mmap`/`sysconf`/
+**   `pthread_mutex_init`, none of which allocate, so it cannot recurse into this file. A spin flag makes
+**   concurrent first calls wait for the winner instead of creating two heaps.
+** - Backing: one `memoman_os` heap, so pools are anonymous `mmap` regions that grow on demand and are unmapped
+**   again when they empty.
+** - Threads: the heap is created with `MM_FLAG_THREAD_SAFE` (one ticket lock per call in the core, plus the
+**   backend mutex around growth and release). There is no per-thread caching; that keeps the comparison with
+**   glibc about the core allocator.
+** - Alignment: `malloc` must satisfy `max_align_t`, so every request goes through `mm_memalign` with
+**   MM_PRELOAD_ALIGN. The `preload` target builds the core with -DMM_ALIGN_SIZE=16, which turns that into a plain
+**   `mm_malloc`; with the default geometry it still works, just through the aligned path.
+** - Foreign pointers (not inside any of our pools) are ignored by `free` and report a usable size of 0.
+** - Not fork-safe while another thread is inside the allocator; the child may inherit a held lock.
+**
+** Build with `-fvisibility=hidden` (the `preload` make target does): only the malloc family below is exported,
+** so the core's `mm_*` symbols bind inside the library and never collide with a program that links memoman too.
+*/
+
+#ifndef MM_PRELOAD_INITIAL_BYTES
+#define MM_PRELOAD_INITIAL_BYTES ((size_t)16 << 20)
+#endif
+
+/* Fundamental alignment expected from malloc (`alignof(max_align_t)` on LP64 glibc targets). */
+#ifndef MM_PRELOAD_ALIGN
+#define MM_PRELOAD_ALIGN (2 * sizeof(size_t))
+#endif
+
+#define MM_PRELOAD_EXPORT __attribute__((visibility("default")))
+
+static mm_os_heap_t* g_heap = NULL;
+static unsigned int g_heap_init = 0;
+
+static mm_os_heap_t* preload_heap(void) {
+  mm_os_heap_t* heap = __atomic_load_n(&g_heap, __ATOMIC_ACQUIRE);
+  if (heap) return heap;
+
+  while (__atomic_exchange_n(&g_heap_init, 1u, __ATOMIC_ACQUIRE)) sched_yield();
+  heap = __atomic_load_n(&g_heap, __ATOMIC_ACQUIRE);
+  if (!heap) {
+    heap = mm_os_heap_create(MM_PRELOAD_INITIAL_BYTES, MM_FLAG_THREAD_SAFE);
+    __atomic_store_n(&g_heap, heap, __ATOMIC_RELEASE);
+  }
+  __atomic_store_n(&g_heap_init, 0u, __ATOMIC_RELEASE);
+  return heap;
+}
+
+static int preload_owns(mm_os_heap_t* heap, void* ptr) {
+  return heap && mm_get_pool_for_ptr(mm_os_heap_allocator(heap), ptr) != NULL;
+}
+
+static void* preload_memalign(size_t align, size_t bytes) {
+  mm_os_heap_t* heap = preload_heap();
+  if (align < MM_PRELOAD_ALIGN) align = MM_PRELOAD_ALIGN;
+  /* malloc(0) must return a unique pointer; the core rejects zero-byte requests. */
+  void* p = heap ? mm_os_memalign(heap, align, bytes ? bytes : 1) : NULL;
+  if (!p) errno = ENOMEM;
+  return p;
+}
+
+MM_PRELOAD_EXPORT void* malloc(size_t bytes) {
+  return preload_memalign(MM_PRELOAD_ALIGN, bytes);
+}
+
+MM_PRELOAD_EXPORT void free(void* ptr) {
+  if (!ptr) return;
+  /* The checked core free ignores pointers outside our pools, so no separate ownership lookup. */
+  mm_os_free(__atomic_load_n(&g_heap, __ATOMIC_ACQUIRE), ptr);
+}
+
+MM_PRELOAD_EXPORT void* calloc(size_t count, size_t size) {
+  if (size && count > SIZE_MAX / size) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  /* Reused blocks are not zero (and `mm_trim`-ed pages only are until first touch), so always clear. */
+  void* p = preload_memalign(MM_PRELOAD_ALIGN, count * size);
+  if (p) memset(p, 0, count * size);
+  return p;
+}
+
+MM_PRELOAD_EXPORT void* realloc(void* ptr, size_t size) {
+  if (!ptr) return malloc(size);
+  if (size == 0) {
+    free(ptr);
+    return NULL;
+  }
+  mm_os_heap_t* heap = __atomic_load_n(&g_heap, __ATOMIC_ACQUIRE);
+  if (!preload_owns(heap, ptr)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  if (mm_align_size() >= MM_PRELOAD_ALIGN) {
+    void* p = mm_os_realloc(heap, ptr, size);
+    if (!p) errno = ENOMEM;
+    return p;
+  }
+
+  /*
+  ** Smaller core geometry: a block moved by the core could land off the malloc grid, so move it ourselves. The old
+  ** block is freed only after the copy, so a failure leaves it valid, as realloc requires.
+  */
+  void* q = mm_os_memalign(heap, MM_PRELOAD_ALIGN, size);
+  if (!q) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  size_t old = mm_block_size(ptr);
+  memcpy(q, ptr, old < size ? old : size);
+  mm_os_free(heap, ptr);
+  return q;
+}
+
+MM_PRELOAD_EXPORT void* memalign(size_t align, size_t bytes) {
+  if (align == 0 || (align & (align - 1)) != 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return preload_memalign(align, bytes);
+}
+
+MM_PRELOAD_EXPORT void* aligned_alloc(size_t align, size_t bytes) {
+  return memalign(align, bytes);
+}
+
+MM_PRELOAD_EXPORT int posix_memalign(void** out, size_t align, size_t bytes) {
+  if (align == 0 || (align & (align - 1)) != 0 || (align % sizeof(void*)) != 0) return EINVAL;
+  int saved = errno;
+  void* p = preload_memalign(align, bytes);
+  errno = saved;
+  if (!p) return ENOMEM;
+  *out = p;
+  return 0;
+}
+
+MM_PRELOAD_EXPORT void* valloc(size_t bytes) {
+  return preload_memalign((size_t)sysconf(_SC_PAGESIZE), bytes);
+}
+
+MM_PRELOAD_EXPORT void* pvalloc(size_t bytes) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  if (bytes > SIZE_MAX - (page - 1)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  return preload_memalign(page, (bytes + page - 1) & ~(page - 1));
+}
+
+MM_PRELOAD_EXPORT size_t malloc_usable_size(void* ptr) {
+  if (!ptr) return 0;
+  mm_os_heap_t* heap = __atomic_load_n(&g_heap, __ATOMIC_ACQUIRE);
+  return preload_owns(heap, ptr) ? mm_block_size(ptr) : 0;
+}
@@ -8,6 +8,8 @@
 #include <sys/resource.h>
 #include <unistd.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
 #include "../src/memoman.h"
 
 #define ANSI_COLOR_RED     "\x1b[31m"
@@ -48,6 +50,7 @@ void mm_init_wrapper(void) {
 }
 
 void mm_destroy_wrapper(void) {
+    mm_destroy(bench_allocator);
     free(bench_pool);
     bench_pool = NULL;
     bench_allocator = NULL;
@@ -193,6 +196,483 @@ void run_suite(const allocator_vtable_t* alloc) {
     printf("\n");
 }
 
+/* 4. Free latency vs. pool count: pointer -> pool resolution on the free path. */
+#define POOL_BENCH_TOTAL_SIZE (4 * 1024 * 1024) /* split evenly across pools: constant working set */
+#define POOL_BENCH_BLOCK_SIZE 128
+#define POOL_BENCH_ROUNDS 8
+
+void run_free_vs_pool_count(void) {
+    printf("========================================\n");
+    printf("Benchmarking: %sMemoman free latency vs. pool count%s\n", ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("========================================\n");
+
+    static const int pool_counts[] = {1, 2, 4, 8, 16, 32};
+    const size_t ctrl_bytes = mm_size();
+
+    char* backing = malloc(ctrl_bytes + POOL_BENCH_TOTAL_SIZE);
+    if (!backing) { perror("malloc failed"); exit(1); }
+
+    size_t max_ptrs = POOL_BENCH_TOTAL_SIZE / POOL_BENCH_BLOCK_SIZE;
+    void** ptrs = calloc(max_ptrs, sizeof(void*));
+    if (!ptrs) { perror("calloc failed"); exit(1); }
+
+    for (size_t c = 0; c < sizeof(pool_counts) / sizeof(pool_counts[0]); c++) {
+        int pools = pool_counts[c];
+        size_t pool_bytes = POOL_BENCH_TOTAL_SIZE / (size_t)pools;
+        double free_sec = 0.0;
+        size_t frees = 0;
+
+        for (int round = 0; round < POOL_BENCH_ROUNDS; round++) {
+            tlsf_t alloc = mm_create(backing);
+            for (int i = 0; i < pools; i++) {
+                mm_add_pool(alloc, backing + ctrl_bytes + (size_t)i * pool_bytes, pool_bytes);
+            }
+
+            /* Fill every pool so live blocks are spread across all of them. */
+            size_t n = 0;
+            while (n < max_ptrs) {
+                void* p = mm_malloc(alloc, POOL_BENCH_BLOCK_SIZE);
+                if (!p) break;
+                ptrs[n++] = p;
+            }
+
+            /* Shuffle so consecutive frees hit different pools. */
+            srand(RANDOM_SEED + round);
+            for (size_t i = n; i > 1; i--) {
+                size_t j = (size_t)rand() % i;
+                void* tmp = ptrs[i - 1];
+                ptrs[i - 1] = ptrs[j];
+                ptrs[j] = tmp;
+            }
+
+            double start = get_time_sec();
+            for (size_t i = 0; i < n; i++) {
+                mm_free(alloc, ptrs[i]);
+            }
+            free_sec += get_time_sec() - start;
+            frees += n;
+            mm_destroy(alloc);
+        }
+
+        printf("  [Free vs Pools] pools=%2d frees=%zu | %.1f ns/free\n",
+               pools, frees, frees ? (free_sec * 1e9) / (double)frees : 0.0);
+    }
+
+    free(ptrs);
+    free(backing);
+    printf("\n");
+}
+
+/* 5. Multi-threaded throughput: one shared heap, 1..N threads. */
+#define MT_BENCH_POOL_SIZE (64 * 1024 * 1024)
+#define MT_BENCH_OPS_PER_THREAD 200000
+#define MT_BENCH_SLOTS 256
+#define MT_BENCH_MAX_THREADS 16
+
+typedef struct {
+    tlsf_t alloc;
+    pthread_mutex_t* mutex; /* NULL: rely on MM_FLAG_THREAD_SAFE */
+    unsigned int seed;
+} mt_bench_worker_t;
+
+static void* mt_bench_worker(void* arg) {
+    mt_bench_worker_t* w = (mt_bench_worker_t*)arg;
+    void* slots[MT_BENCH_SLOTS] = {0};
+    unsigned int x = w->seed;
+
+    for (int i = 0; i < MT_BENCH_OPS_PER_THREAD; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        int idx = (int)(x % MT_BENCH_SLOTS);
+        if (w->mutex) pthread_mutex_lock(w->mutex);
+        if (slots[idx]) {
+            mm_free(w->alloc, slots[idx]);
+            slots[idx] = NULL;
+        } else {
+            slots[idx] = mm_malloc(w->alloc, 16 + ((x >> 8) % 512));
+        }
+        if (w->mutex) pthread_mutex_unlock(w->mutex);
+    }
+
+    for (int i = 0; i < MT_BENCH_SLOTS; i++) {
+        if (!slots[i]) continue;
+        if (w->mutex) pthread_mutex_lock(w->mutex);
+        mm_free(w->alloc, slots[i]);
+        if (w->mutex) pthread_mutex_unlock(w->mutex);
+    }
+    return NULL;
+}
+
+static double run_mt_round(void* backing, int threads, int external_mutex) {
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    tlsf_t alloc = external_mutex
+        ? mm_create_with_pool(backing, MT_BENCH_POOL_SIZE)
+        : mm_create_with_pool_ex(backing, MT_BENCH_POOL_SIZE, MM_FLAG_THREAD_SAFE);
+
+    pthread_t tids[MT_BENCH_MAX_THREADS];
+    mt_bench_worker_t workers[MT_BENCH_MAX_THREADS];
+
+    double start = get_time_sec();
+    for (int i = 0; i < threads; i++) {
+        workers[i].alloc = alloc;
+        workers[i].mutex = external_mutex ? &mutex : NULL;
+        workers[i].seed = 0x9e3779b9u * (unsigned int)(i + 1);
+        pthread_create(&tids[i], NULL, mt_bench_worker, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    double duration = get_time_sec() - start;
+
+    if (!mm_validate(alloc)) printf(ANSI_COLOR_RED "    heap validation failed" ANSI_COLOR_RESET "\n");
+    mm_destroy(alloc);
+    return duration;
+}
+
+void run_mt_scaling(void) {
+    printf("========================================\n");
+    printf("Benchmarking: %sMemoman shared heap, 1..N threads%s\n", ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("========================================\n");
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = (cores < 1) ? 1 : (cores > MT_BENCH_MAX_THREADS) ? MT_BENCH_MAX_THREADS : (int)cores;
+
+    void* backing = malloc(MT_BENCH_POOL_SIZE);
+    if (!backing) { perror("malloc failed"); exit(1); }
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double ops = (double)threads * MT_BENCH_OPS_PER_THREAD;
+        double t_flag = run_mt_round(backing, threads, 0);
+        double t_mutex = run_mt_round(backing, threads, 1);
+        printf("  [MT Churn] threads=%2d | THREAD_SAFE: %.0f ops/sec | pthread_mutex wrapper: %.0f ops/sec\n",
+               threads, ops / t_flag, ops / t_mutex);
+    }
+
+    free(backing);
+    printf("\n");
+}
+
+/* 6. Small alloc/free pairs: TLSF core vs. thread cache front end. */
+#define TCACHE_BENCH_POOL_SIZE (16 * 1024 * 1024)
+#define TCACHE_BENCH_LIVE 64
+
+void run_tcache_small_pairs(void) {
+    printf("========================================\n");
+    printf("Benchmarking: %sMemoman small pairs, core vs. thread cache%s\n", ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("========================================\n");
+
+    void* backing = malloc(TCACHE_BENCH_POOL_SIZE);
+    void* cache_mem = malloc(mm_tcache_size());
+    if (!backing || !cache_mem) { perror("malloc failed"); exit(1); }
+
+    for (int use_cache = 0; use_cache <= 1; use_cache++) {
+        tlsf_t alloc = mm_create_with_pool(backing, TCACHE_BENCH_POOL_SIZE);
+        mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+        void* live[TCACHE_BENCH_LIVE] = {0};
+        unsigned int x = RANDOM_SEED;
+
+        double start = get_time_sec();
+        for (int i = 0; i < NUM_OPS; i++) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            int idx = (int)(x % TCACHE_BENCH_LIVE);
+            size_t sz = 16 + ((x >> 8) % 241);
+            if (use_cache) {
+                if (live[idx]) mm_tcache_free(cache, live[idx]);
+                live[idx] = mm_tcache_malloc(cache, sz);
+            } else {
+                if (live[idx]) mm_free(alloc, live[idx]);
+                live[idx] = mm_malloc(alloc, sz);
+            }
+        }
+        double duration = get_time_sec() - start;
+
+        for (int i = 0; i < TCACHE_BENCH_LIVE; i++) {
+            if (live[i]) mm_tcache_free(cache, live[i]);
+        }
+        mm_tcache_destroy(cache);
+        mm_destroy(alloc);
+        printf("  [Small Pairs] %s: %.0f pairs/sec (16-256 bytes)\n",
+               use_cache ? "tcache" : "core  ", NUM_OPS / duration);
+    }
+
+    free(cache_mem);
+    free(backing);
+    printf("\n");
+}
+
+/* 7. Batch vs. individual: N same-sized message buffers per tick. */
+#define BATCH_BENCH_POOL_SIZE (64 * 1024 * 1024)
+#define BATCH_BENCH_TICKS 2000
+
+void run_batch_vs_individual(void) {
+    printf("========================================\n");
+    printf("Benchmarking: %sMemoman batch vs. individual calls%s\n", ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("========================================\n");
+
+    static const size_t batch_sizes[] = {16, 128, 512};
+    static const size_t obj_sizes[] = {64, 256};
+
+    void* backing = malloc(BATCH_BENCH_POOL_SIZE);
+    void** ptrs = calloc(512, sizeof(void*));
+    if (!backing || !ptrs) { perror("malloc failed"); exit(1); }
+
+    for (size_t o = 0; o < sizeof(obj_sizes) / sizeof(obj_sizes[0]); o++) {
+        for (size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++) {
+            size_t n = batch_sizes[b];
+            size_t sz = obj_sizes[o];
+            double t[2];
+
+            for (int batched = 0; batched <= 1; batched++) {
+                tlsf_t alloc = mm_create_with_pool(backing, BATCH_BENCH_POOL_SIZE);
+                /* Keep some long-lived blocks around so the heap is not a single pristine block. */
+                void* pins[64];
+                for (int i = 0; i < 64; i++) pins[i] = mm_malloc(alloc, 32 + (size_t)i * 24);
+
+                double start = get_time_sec();
+                for (int tick = 0; tick < BATCH_BENCH_TICKS; tick++) {
+                    if (batched) {
+                        size_t got = mm_malloc_batch(alloc, sz, n, ptrs);
+                        mm_free_batch(alloc, ptrs, got);
+                    } else {
+                        for (size_t i = 0; i < n; i++) ptrs[i] = mm_malloc(alloc, sz);
+                        for (size_t i = 0; i < n; i++) mm_free(alloc, ptrs[i]);
+                    }
+                }
+                t[batched] = get_time_sec() - start;
+
+                for (int i = 0; i < 64; i++) mm_free(alloc, pins[i]);
+                mm_destroy(alloc);
+            }
+
+            double objs = (double)n * BATCH_BENCH_TICKS;
+            printf("  [Batch] size=%4zu n=%3zu | individual: %6.1f ns/obj | batch: %6.1f ns/obj\n",
+                   sz, n, (t[0] * 1e9) / objs, (t[1] * 1e9) / objs);
+        }
+    }
+
+    free(ptrs);
+    free(backing);
+    printf("\n");
+}
+
+/* 8. Append-style growth: interleaved buffers that realloc a little larger on every append. */
+#define APPEND_BENCH_POOL_SIZE (64 * 1024 * 1024)
+#define APPEND_BENCH_BUFFERS 16
+#define APPEND_BENCH_STEP 96
+#define APPEND_BENCH_MAX (64 * 1024)
+#define APPEND_BENCH_ROUNDS 20
+
+void run_append_growth(void) {
+    printf("========================================\n");
+    printf("Benchmarking: %sAppend-style realloc growth%s\n", ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("========================================\n");
+
+    void* backing = malloc(APPEND_BENCH_POOL_SIZE);
+    if (!backing) { perror("malloc failed"); exit(1); }
+
+    for (int use_mm = 0; use_mm <= 1; use_mm++) {
+        tlsf_t alloc = use_mm ? mm_create_with_pool(backing, APPEND_BENCH_POOL_SIZE) : NULL;
+        void* bufs[APPEND_BENCH_BUFFERS] = {0};
+        size_t lens[APPEND_BENCH_BUFFERS] = {0};
+        size_t reallocs = 0, same = 0, backward = 0;
+
+        double start = get_time_sec();
+        for (int round = 0; round < APPEND_BENCH_ROUNDS; round++) {
+            /* Buffers grow round-robin, so each one's next neighbour is usually another live buffer. */
+            for (int step = 0; step < APPEND_BENCH_MAX / APPEND_BENCH_STEP; step++) {
+                for (int b = 0; b < APPEND_BENCH_BUFFERS; b++) {
+                    size_t len = lens[b] + APPEND_BENCH_STEP;
+                    void* p = use_mm ? mm_realloc(alloc, bufs[b], len) : realloc(bufs[b], len);
+                    if (!p) { perror("realloc failed"); exit(1); }
+                    if (bufs[b]) {
+                        reallocs++;
+                        if (p == bufs[b]) same++;
+                        else if ((uintptr_t)p < (uintptr_t)bufs[b]) backward++;
+                    }
+                    memset((char*)p + lens[b], b, APPEND_BENCH_STEP);
+                    bufs[b] = p;
+                    lens[b] = len;
+                }
+            }
+            /* Drop every other buffer so the survivors find free space in front of them next round. */
+            for (int b = 0; b < APPEND_BENCH_BUFFERS; b++) {
+                if ((b + round) & 1) {
+                    if (use_mm) mm_free(alloc, bufs[b]); else free(bufs[b]);
+                    bufs[b] = NULL;
+                    lens[b] = 0;
+                }
+            }
+        }
+        double dur = get_time_sec() - start;
+
+        for (int b = 0; b < APPEND_BENCH_BUFFERS; b++) {
+            if (use_mm) mm_free(alloc, bufs[b]); else free(bufs[b]);
+        }
+        if (use_mm) mm_destroy(alloc);
+
+        printf("  [Append] %-16s %zu reallocs | %6.1f ns/op | in place: %5.1f%% | moved down: %5.1f%%\n",
+               use_mm ? "Memoman" : "System (malloc)", reallocs, (dur * 1e9) / (double)reallocs,
+               100.0 * (double)same / (double)reallocs, 100.0 * (double)backward / (double)reallocs);
+    }
+
+    free(backing);
+    printf("\n");
+}
+
+/* 9. Request-scoped objects: per-object malloc/free vs. an arena released (or rewound) once per request. */
+#define ARENA_BENCH_POOL_SIZE (64 * 1024 * 1024)
+#define ARENA_BENCH_REQUESTS 20000
+
+void run_arena_vs_individual(void) {
+    printf("========================================\n");
+    printf("Benchmarking: %sMemoman arena vs. per-object malloc/free%s\n", ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("========================================\n");
+
+    static const size_t objs_per_request[] = {16, 64, 256};
+    static const char* modes[] = {"malloc/free", "arena release", "arena rewind"};
+
+    void* backing = malloc(ARENA_BENCH_POOL_SIZE);
+    void* arena_mem = malloc(mm_arena_size());
+    void** ptrs = calloc(256, sizeof(void*));
+    if (!backing || !arena_mem || !ptrs) { perror("malloc failed"); exit(1); }
+
+    for (size_t r = 0; r < sizeof(objs_per_request) / sizeof(objs_per_request[0]); r++) {
+        size_t n = objs_per_request[r];
+        double t[3];
+
+        for (int mode = 0; mode < 3; mode++) {
+            tlsf_t alloc = mm_create_with_pool(backing, ARENA_BENCH_POOL_SIZE);
+            mm_arena_t arena = mm_arena_create(arena_mem, alloc, 0);
+            /* Long-lived blocks so the heap is not a single pristine block. */
+            void* pins[64];
+            for (int i = 0; i < 64; i++) pins[i] = mm_malloc(alloc, 32 + (size_t)i * 24);
+            /* Rewind mode keeps the first chunk across requests. */
+            mm_arena_alloc(arena, 16);
+            mm_arena_mark_t mark = mm_arena_save(arena);
+            unsigned int x = RANDOM_SEED;
+
+            double start = get_time_sec();
+            for (int req = 0; req < ARENA_BENCH_REQUESTS; req++) {
+                for (size_t i = 0; i < n; i++) {
+                    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+                    size_t sz = 16 + ((x >> 8) % 241);
+                    void* p = mode == 0 ? mm_malloc(alloc, sz) : mm_arena_alloc(arena, sz);
+                    if (!p) { perror("alloc failed"); exit(1); }
+                    *(volatile char*)p = (char)i;
+                    ptrs[i] = p;
+                }
+                if (mode == 0) {
+                    for (size_t i = 0; i < n; i++) mm_free(alloc, ptrs[i]);
+                } else if (mode == 1) {
+                    mm_arena_release(arena);
+                } else {
+                    mm_arena_rewind(arena, mark);
+                }
+            }
+            t[mode] = get_time_sec() - start;
+
+            mm_arena_destroy(arena);
+            for (int i = 0; i < 64; i++) mm_free(alloc, pins[i]);
+            mm_destroy(alloc);
+        }
+
+        double objs = (double)n * ARENA_BENCH_REQUESTS;
+        for (int mode = 0; mode < 3; mode++) {
+            printf("  [Arena] objs/request=%3zu %-13s %6.1f ns/obj\n", n, modes[mode], (t[mode] * 1e9) / objs);
+        }
+    }
+
+    free(ptrs);
+    free(arena_mem);
+    free(backing);
+    printf("\n");
+}
+
+/* 10. Producer/consumer: one thread allocates, consumers free what it hands them; locked vs. remote frees. */
+#define PC_BENCH_POOL_SIZE (64 * 1024 * 1024)
+#define PC_BENCH_OBJECTS 1000000
+#define PC_BENCH_RING 1024
+#define PC_BENCH_MAX_CONSUMERS 4
+
+typedef struct {
+    void* slots[PC_BENCH_RING];
+    size_t head; /* written by the producer */
+    size_t tail; /* written by the consumer */
+    tlsf_t alloc;
+    size_t expected;
+} pc_ring_t;
+
+static void* pc_consumer(void* arg) {
+    pc_ring_t* ring = (pc_ring_t*)arg;
+    for (size_t done = 0; done < ring->expected; done++) {
+        size_t tail = ring->tail;
+        while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) sched_yield();
+        void* p = ring->slots[tail % PC_BENCH_RING];
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        mm_free(ring->alloc, p);
+    }
+    return NULL;
+}
+
+static double run_pc_round(void* backing, int consumers, unsigned int flags) {
+    /* The creating thread (this one, the producer) owns the instance. */
+    tlsf_t alloc = mm_create_with_pool_ex(backing, PC_BENCH_POOL_SIZE, flags);
+    static pc_ring_t rings[PC_BENCH_MAX_CONSUMERS];
+    pthread_t tids[PC_BENCH_MAX_CONSUMERS];
+    for (int c = 0; c < consumers; c++) {
+        memset(&rings[c], 0, sizeof(rings[c]));
+        rings[c].alloc = alloc;
+        rings[c].expected = PC_BENCH_OBJECTS / (size_t)consumers;
+    }
+
+    double start = get_time_sec();
+    for (int c = 0; c < consumers; c++) pthread_create(&tids[c], NULL, pc_consumer, &rings[c]);
+    unsigned int x = RANDOM_SEED;
+    for (size_t i = 0; i < PC_BENCH_OBJECTS / (size_t)consumers; i++) {
+        for (int c = 0; c < consumers; c++) {
+            pc_ring_t* ring = &rings[c];
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            void* p = mm_malloc(alloc, 32 + ((x >> 8) % 480));
+            if (!p) { perror("alloc failed"); exit(1); }
+            *(volatile char*)p = (char)i;
+            size_t head = ring->head;
+            while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == PC_BENCH_RING) sched_yield();
+            ring->slots[head % PC_BENCH_RING] = p;
+            __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+        }
+    }
+    for (int c = 0; c < consumers; c++) pthread_join(tids[c], NULL);
+    double duration = get_time_sec() - start;
+
+    mm_drain_remote_frees(alloc);
+    mm_stats_t st;
+    mm_get_stats(alloc, &st);
+    if (!mm_validate(alloc) || st.bytes_in_use != 0) {
+        printf(ANSI_COLOR_RED "    heap validation failed" ANSI_COLOR_RESET "\n");
+    }
+    mm_destroy(alloc);
+    return duration;
+}
+
+void run_producer_consumer(void) {
+    printf("========================================\n");
+    printf("Benchmarking: %sMemoman producer/consumer, locked vs. remote frees%s\n", ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("========================================\n");
+
+    void* backing = malloc(PC_BENCH_POOL_SIZE);
+    if (!backing) { perror("malloc failed"); exit(1); }
+
+    for (int consumers = 1; consumers <= PC_BENCH_MAX_CONSUMERS; consumers *= 2) {
+        double objs = (double)(PC_BENCH_OBJECTS / consumers * consumers);
+        double t_locked = run_pc_round(backing, consumers, MM_FLAG_THREAD_SAFE);
+        double t_remote = run_pc_round(backing, consumers, MM_FLAG_THREAD_SAFE | MM_FLAG_REMOTE_FREE);
+        printf("  [Producer/Consumer] consumers=%d | THREAD_SAFE: %.0f objs/sec | REMOTE_FREE: %.0f objs/sec\n",
+               consumers, objs / t_locked, objs / t_remote);
+    }
+
+    free(backing);
+    printf("\n");
+}
+
 /* Helper to try loading jemalloc dynamically */
 int try_load_jemalloc(allocator_vtable_t* vtable) {
     const char* libs[] = { "libjemalloc.so.2", "libjemalloc.so.1", "libjemalloc.so", NULL };
@@ -243,6 +723,13 @@ int main(void) {
     }
     
     run_suite(&memoman_alloc);
+    run_free_vs_pool_count();
+    run_mt_scaling();
+    run_tcache_small_pairs();
+    run_batch_vs_individual();
+    run_append_growth();
+    run_arena_vs_individual();
+    run_producer_consumer();
     
     return 0;
 }
@@ -12,8 +12,54 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/* Build-time geometry (must match src/memoman.c; build tests with the same -D overrides). */
+#if SIZE_MAX > 0xffffffffu
+#define MM_SIZE_T_BYTES 8
+#else
+#define MM_SIZE_T_BYTES 4
+#endif
+#ifndef MM_ALIGN_SIZE
+#define MM_ALIGN_SIZE MM_SIZE_T_BYTES
+#endif
+#ifndef MM_SL_INDEX_COUNT_LOG2
+#define MM_SL_INDEX_COUNT_LOG2 5
+#endif
+#ifndef MM_FL_INDEX_MAX
+#if UINTPTR_MAX > 0xffffffffu
+#define MM_FL_INDEX_MAX 32
+#else
+#define MM_FL_INDEX_MAX 30
+#endif
+#endif
+#if MM_ALIGN_SIZE > MM_SIZE_T_BYTES
+#define MM_HEADER_PAD_BYTES (MM_ALIGN_SIZE - MM_SIZE_T_BYTES)
+#else
+#define MM_HEADER_PAD_BYTES 0
+#endif
+#if MM_ALIGN_SIZE >= 16
+#define MM_ALIGN_SIZE_LOG2 4
+#elif MM_ALIGN_SIZE >= 8
+#define MM_ALIGN_SIZE_LOG2 3
+#else
+#define MM_ALIGN_SIZE_LOG2 2
+#endif
+#if !defined(MM_BITMAP_64) && \
+    (MM_SL_INDEX_COUNT_LOG2 > 5 || (MM_FL_INDEX_MAX - MM_SL_INDEX_COUNT_LOG2 - MM_ALIGN_SIZE_LOG2 + 1) > 32)
+#define MM_BITMAP_64 1
+#endif
+#if defined(MM_BITMAP_64)
+typedef uint64_t mm_bitmap_t;
+#else
+typedef unsigned int mm_bitmap_t;
+#endif
+#define MM_BITMAP_BITS ((int)(sizeof(mm_bitmap_t) * 8))
+#define MM_BIT(i) ((mm_bitmap_t)1 << (i))
+
 typedef struct tlsf_block_t {
   size_t size; /* LSBs used for flags (TLSF_BLOCK_FREE, TLSF_PREV_FREE) */
+#if MM_HEADER_PAD_BYTES > 0
+  unsigned char header_pad[MM_HEADER_PAD_BYTES];
+#endif
   struct tlsf_block_t* next_free;
   struct tlsf_block_t* prev_free;
 } tlsf_block_t;
@@ -27,11 +73,10 @@ typedef struct mm_pool_desc_t {
   size_t live_allocations;
   int active;
   struct mm_pool_desc_t* next_global;
-  struct mm_pool_desc_t* prev_global;
 } mm_pool_desc_t;
 
-/* The block header exposed to used blocks is a single size word. */
-#define BLOCK_HEADER_OVERHEAD sizeof(size_t)
+/* The block header exposed to used blocks is a single size word (plus padding up to MM_ALIGN_SIZE). */
+#define BLOCK_HEADER_OVERHEAD (sizeof(size_t) + MM_HEADER_PAD_BYTES)
 #define BLOCK_START_OFFSET BLOCK_HEADER_OVERHEAD
 
 /* Flags stored in the size word. */
@@ -39,8 +84,8 @@ typedef struct mm_pool_desc_t {
 #define TLSF_PREV_FREE    (size_t)2
 #define TLSF_SIZE_MASK    (~(TLSF_BLOCK_FREE | TLSF_PREV_FREE))
 
-/* Default alignment (TLSF uses ALIGN_SIZE; we key off size_t). */
-#define ALIGNMENT         sizeof(size_t)
+/* Payload alignment (TLSF's ALIGN_SIZE); defaults to size_t. */
+#define ALIGNMENT         ((size_t)MM_ALIGN_SIZE)
 
 /* Derived minimum payload required for a free block (TLSF 3.1 semantics):
  * - next_free/prev_free stored at payload start (2 pointers)
@@ -51,14 +96,10 @@ typedef struct mm_pool_desc_t {
 #define MM_MIN_FREE_PAYLOAD_BYTES (MM_FREELIST_LINKS_BYTES + MM_PREV_PHYS_FOOTER_BYTES)
 #define TLSF_MIN_BLOCK_SIZE ((MM_MIN_FREE_PAYLOAD_BYTES + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
 
-/* TLSF-style mapping configuration (defaults match TLSF 3.1). */
-#define SL_INDEX_COUNT_LOG2 5
+/* TLSF-style mapping configuration. */
+#define SL_INDEX_COUNT_LOG2 MM_SL_INDEX_COUNT_LOG2
 #define SL_INDEX_COUNT (1 << SL_INDEX_COUNT_LOG2)
-#if UINTPTR_MAX > 0xffffffffu
-#define FL_INDEX_MAX 32
-#else
-#define FL_INDEX_MAX 30
-#endif
+#define FL_INDEX_MAX MM_FL_INDEX_MAX
 #define MM_ALIGN_SHIFT \
   ((ALIGNMENT == 1) ? 0 : (ALIGNMENT == 2) ? 1 : (ALIGNMENT == 4) ? 2 : \
    (ALIGNMENT == 8) ? 3 : (ALIGNMENT == 16) ? 4 : (ALIGNMENT == 32) ? 5 : -1)
@@ -71,17 +112,66 @@ typedef struct mm_pool_desc_t {
 #define TLSF_FLI_OFFSET   FL_INDEX_SHIFT
 #define TLSF_FLI_MAX      FL_INDEX_COUNT
 
+/* Slab front end limits (must match src/memoman.c defaults). */
+#define MM_SLAB_MAX 64
+#define MM_SLAB_CLASS_COUNT 16
+
+/* Latency histograms (must match src/memoman.c; only present with -DMM_LATENCY=1). */
+#ifndef MM_LATENCY
+#define MM_LATENCY 0
+#endif
+#define MM_LAT_SUB_BITS 4
+#define MM_LAT_SUB_COUNT (1 << MM_LAT_SUB_BITS)
+#define MM_LAT_MAX_LOG2 32
+#define MM_LAT_BUCKETS (MM_LAT_SUB_COUNT * (MM_LAT_MAX_LOG2 - MM_LAT_SUB_BITS + 1))
+typedef struct mm_latency_hist_t {
+  uint64_t min;
+  uint64_t max;
+  uint64_t total;
+  uint64_t count;
+  uint64_t buckets[MM_LAT_BUCKETS];
+} mm_latency_hist_t;
+
 /* Complete the opaque type for tests. */
+#ifndef MM_CACHE_LINE
+#define MM_CACHE_LINE 64
+#endif
+
 struct mm_allocator_t {
-  tlsf_block_t block_null;
-  unsigned int fl_bitmap;
-  unsigned int sl_bitmap[FL_INDEX_COUNT];
+  mm_bitmap_t fl_bitmap;
+  mm_bitmap_t sl_bitmap[FL_INDEX_COUNT];
   tlsf_block_t* blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
   size_t current_free_size;
   size_t total_pool_size;
   mm_pool_desc_t pools[MM_MAX_POOLS];
+  unsigned char pool_order[MM_MAX_POOLS];
+  size_t pool_count;
+  unsigned int flags;
+  unsigned int lock_next;
+  unsigned int lock_owner;
+  unsigned int slab_count;
+  struct mm_slab_t* slab_index[MM_SLAB_MAX];
+  struct mm_slab_t* slab_partial[MM_SLAB_CLASS_COUNT];
+  mm_stats_t stats;
+  mm_trace_hook trace_hook;
+  void* trace_user;
+  struct mm_handle_table_t* handles;
+  uint64_t signature;
+  void* base;
+  void* root;
+  unsigned int remote_ticks;
+  unsigned char remote_pad_before[MM_CACHE_LINE];
+  void* remote_head;
+  uintptr_t owner_thread;
+  unsigned char remote_pad_after[MM_CACHE_LINE - sizeof(void*) - sizeof(uintptr_t)];
+#if MM_LATENCY
+  mm_latency_hist_t latency[MM_OP_COUNT];
+#endif
 };
 
+/* Bytes reserved for the control block by `mm_size()`/`mm_create_with_pool`. */
+#define MM_CONTROL_BYTES ((sizeof(struct mm_allocator_t) + 15) & ~(size_t)15)
+
 /* Test-only helper exposed by the implementation. */
 void mm_get_mapping_indices(size_t size, int* fl, int* sl);
 void mm_get_mapping_search_indices(size_t size, int* fl, int* sl);
@@ -0,0 +1,173 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+/* A class lower bound: good fit takes blocks of exactly this size from their own list. */
+#define BLOCK 8192u
+#define COUNT 8
+
+/* Frees COUNT equal blocks (kept apart by live guards) in a scrambled order. */
+static int free_scrambled(tlsf_t alloc, void** blocks, void** guards) {
+  for (int i = 0; i < COUNT; i++) {
+    blocks[i] = (mm_malloc)(alloc, BLOCK);
+    guards[i] = (mm_malloc)(alloc, 64);
+    if (!blocks[i] || !guards[i]) return 0;
+  }
+  static const int order[COUNT] = {5, 2, 7, 0, 3, 6, 1, 4};
+  for (int i = 0; i < COUNT; i++) (mm_free)(alloc, blocks[order[i]]);
+  return 1;
+}
+
+static int test_class_hands_out_lowest_address_first(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_ADDRESS_ORDERED);
+  ASSERT_NOT_NULL(alloc);
+
+  void* blocks[COUNT];
+  void* guards[COUNT];
+  ASSERT(free_scrambled(alloc, blocks, guards));
+  ASSERT((mm_validate)(alloc));
+
+  /* Blocks were carved in address order, so they must come back in carving order. */
+  for (int i = 0; i < COUNT; i++) {
+    void* p = (mm_malloc)(alloc, BLOCK);
+    ASSERT_EQ(p, blocks[i]);
+  }
+  for (int i = 0; i < COUNT; i++) {
+    (mm_free)(alloc, blocks[i]);
+    (mm_free)(alloc, guards[i]);
+  }
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_default_stays_lifo(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* blocks[COUNT];
+  void* guards[COUNT];
+  ASSERT(free_scrambled(alloc, blocks, guards));
+
+  /* The last block freed (order[COUNT - 1]) is reused first. */
+  void* p = (mm_malloc)(alloc, BLOCK);
+  ASSERT_EQ(p, blocks[4]);
+  (mm_free)(alloc, p);
+  for (int i = 0; i < COUNT; i++) (mm_free)(alloc, guards[i]);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+#define POOLS 4
+#define POOL_BYTES (256 * 1024)
+#define LIVE 64
+
+/*
+** Fills every pool, keeps every 8th block as a long-lived object scattered over all pools and releases those one
+** by one while a small live set churns. Returns how many pools end up empty.
+*/
+static size_t churn_and_count_empty(unsigned int flags) {
+  static uint8_t ctrl_mem[64 * 1024] __attribute__((aligned(16)));
+  static uint8_t backing[POOLS][POOL_BYTES] __attribute__((aligned(16)));
+  if (mm_size() > sizeof(ctrl_mem)) return SIZE_MAX;
+  tlsf_t alloc = mm_create_ex(ctrl_mem, flags);
+  if (!alloc) return SIZE_MAX;
+  pool_t pools[POOLS];
+  for (int i = 0; i < POOLS; i++) {
+    pools[i] = mm_add_pool(alloc, backing[i], sizeof(backing[i]));
+    if (!pools[i]) return SIZE_MAX;
+  }
+
+  static void* fill[4096];
+  size_t filled = 0;
+  uint32_t seed = 0xADD2E55u;
+  while (filled < 4096) {
+    seed = seed * 1103515245u + 12345u;
+    void* p = (mm_malloc)(alloc, 32 + (seed >> 8) % 1024);
+    if (!p) break;
+    fill[filled++] = p;
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < filled; i++) {
+    if (i % 8 == 0) fill[kept++] = fill[i];
+    else (mm_free)(alloc, fill[i]);
+  }
+
+  void* live[LIVE] = {0};
+  for (int i = 0; i < 20000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int slot = (int)((seed >> 16) % LIVE);
+    (mm_free)(alloc, live[slot]);
+    live[slot] = (mm_malloc)(alloc, 16 + (seed >> 4) % 2048);
+    if (kept && (i % 16) == 0) {
+      size_t j = (seed >> 8) % kept;
+      (mm_free)(alloc, fill[j]);
+      fill[j] = fill[--kept];
+    }
+  }
+  for (size_t i = 0; i < kept; i++) (mm_free)(alloc, fill[i]);
+
+  /* Drained pools can be handed back while the heap stays live. */
+  size_t empty = 0;
+  for (int i = 0; i < POOLS; i++) {
+    if (!mm_pool_is_empty(alloc, pools[i])) continue;
+    mm_remove_pool(alloc, pools[i]);
+    empty++;
+  }
+  if (!(mm_validate)(alloc)) return SIZE_MAX;
+  for (int i = 0; i < LIVE; i++) (mm_free)(alloc, live[i]);
+  if (!(mm_validate)(alloc)) return SIZE_MAX;
+  (mm_destroy)(alloc);
+  return empty;
+}
+
+static int test_high_pools_drain(void) {
+  /* The small live set ends up packed into a single pool. */
+  size_t ordered = churn_and_count_empty(MM_FLAG_ADDRESS_ORDERED);
+  ASSERT_NE(ordered, SIZE_MAX);
+  ASSERT_GE(ordered, POOLS - 1);
+
+  size_t lifo = churn_and_count_empty(0);
+  ASSERT_NE(lifo, SIZE_MAX);
+  ASSERT_LE(lifo, ordered);
+  return 1;
+}
+
+static int test_ordered_churn_with_best_fit(void) {
+  static uint8_t backing[1024 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_ADDRESS_ORDERED | MM_FLAG_BEST_FIT);
+  ASSERT_NOT_NULL(alloc);
+
+  void* live[512] = {0};
+  uint32_t seed = 0x0DE7ED5u;
+  for (int i = 0; i < 50000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int slot = (int)((seed >> 16) % 512);
+    size_t size = 1 + (seed >> 3) % 3000;
+    if ((seed & 3u) == 0 && live[slot]) {
+      void* q = (mm_realloc)(alloc, live[slot], size);
+      if (q) live[slot] = q;
+    } else {
+      (mm_free)(alloc, live[slot]);
+      live[slot] = (seed & 7u) == 1 ? (mm_memalign)(alloc, 128, size) : (mm_malloc)(alloc, size);
+    }
+    if ((i & 4095) == 0) ASSERT((mm_validate)(alloc));
+  }
+  for (int i = 0; i < 512; i++) (mm_free)(alloc, live[i]);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Address-ordered free lists");
+  RUN_TEST(test_class_hands_out_lowest_address_first);
+  RUN_TEST(test_default_stays_lifo);
+  RUN_TEST(test_high_pools_drain);
+  RUN_TEST(test_ordered_churn_with_best_fit);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
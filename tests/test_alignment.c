@@ -47,6 +47,17 @@ static int test_memalign_gap_adjusts_to_minimum(void) {
   tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
   ASSERT_NOT_NULL(alloc);
 
+  /* With a 16-byte header the first payload can already sit on the 64-byte grid; shift it off so a gap is needed. */
+  void* pad = NULL;
+  void* probe = (mm_malloc)(alloc, 1);
+  ASSERT_NOT_NULL(probe);
+  int probe_aligned = ((uintptr_t)probe % 64) == 0;
+  (mm_free)(alloc, probe);
+  if (probe_aligned) {
+    pad = (mm_malloc)(alloc, 1);
+    ASSERT_NOT_NULL(pad);
+  }
+
   void* p = (mm_memalign)(alloc, 64, 128);
   ASSERT_NOT_NULL(p);
   ASSERT_EQ((uintptr_t)p % 64, 0);
@@ -60,6 +71,7 @@ static int test_memalign_gap_adjusts_to_minimum(void) {
   ASSERT_GE(block_size(prev), (size_t)TLSF_MIN_BLOCK_SIZE);
 
   (mm_free)(alloc, p);
+  (mm_free)(alloc, pad);
   ASSERT((mm_validate)(alloc));
   return 1;
 }
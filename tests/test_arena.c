@@ -0,0 +1,183 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+#define CHUNK 4096u
+
+static int test_bump_within_one_chunk(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  static void* arena_mem[16];
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_LE(mm_arena_size(), sizeof(arena_mem));
+  mm_arena_t arena = mm_arena_create(arena_mem, alloc, CHUNK);
+  ASSERT_NOT_NULL(arena);
+  ASSERT_EQ(mm_arena_footprint(arena), 0);
+
+  /* Objects are packed back to back at the allocator's alignment, with no per-object header. */
+  uint8_t* a = (uint8_t*)mm_arena_alloc(arena, 24);
+  uint8_t* b = (uint8_t*)mm_arena_alloc(arena, 40);
+  uint8_t* c = (uint8_t*)mm_arena_alloc(arena, 1);
+  ASSERT_NOT_NULL(a);
+  ASSERT_EQ((uintptr_t)a % mm_align_size(), 0);
+  ASSERT_EQ(b, a + ((24 + mm_align_size() - 1) & ~(mm_align_size() - 1)));
+  ASSERT_EQ(c, b + ((40 + mm_align_size() - 1) & ~(mm_align_size() - 1)));
+  ASSERT_EQ(mm_arena_footprint(arena), CHUNK);
+  ASSERT_NULL(mm_arena_alloc(arena, 0));
+
+  memset(a, 0xA5, 24);
+  memset(b, 0x5A, 40);
+  ASSERT((mm_validate)(alloc));
+
+  mm_arena_release(arena);
+  ASSERT_EQ(mm_arena_footprint(arena), 0);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_chunks_grow_and_release_at_once(void) {
+  static uint8_t backing[1024 * 1024] __attribute__((aligned(16)));
+  static void* arena_mem[16];
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  mm_arena_t arena = mm_arena_create(arena_mem, alloc, CHUNK);
+  ASSERT_NOT_NULL(arena);
+
+  /* 200 objects of 100 bytes need several chunks; every object stays intact. */
+  uint8_t* objs[200];
+  for (int i = 0; i < 200; i++) {
+    objs[i] = (uint8_t*)mm_arena_alloc(arena, 100);
+    ASSERT_NOT_NULL(objs[i]);
+    memset(objs[i], i, 100);
+  }
+  for (int i = 0; i < 200; i++) ASSERT_EQ(objs[i][99], (uint8_t)i);
+  ASSERT_GE(mm_arena_footprint(arena), 5 * CHUNK);
+
+  /* A request larger than a chunk gets a chunk of its own. */
+  uint8_t* big = (uint8_t*)mm_arena_alloc(arena, 3 * CHUNK);
+  ASSERT_NOT_NULL(big);
+  memset(big, 0xEE, 3 * CHUNK);
+  ASSERT((mm_validate)(alloc));
+
+  mm_arena_release(arena);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+
+  /* The arena stays usable after a release. */
+  ASSERT_NOT_NULL(mm_arena_alloc(arena, 64));
+  mm_arena_destroy(arena);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_nested_savepoints(void) {
+  static uint8_t backing[512 * 1024] __attribute__((aligned(16)));
+  static void* arena_mem[16];
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  mm_arena_t arena = mm_arena_create(arena_mem, alloc, CHUNK);
+  ASSERT_NOT_NULL(arena);
+
+  mm_arena_mark_t empty = mm_arena_save(arena);
+  void* keep = mm_arena_alloc(arena, 128);
+  ASSERT_NOT_NULL(keep);
+
+  mm_arena_mark_t outer = mm_arena_save(arena);
+  void* first = mm_arena_alloc(arena, 256);
+  ASSERT_NOT_NULL(first);
+  size_t outer_footprint = mm_arena_footprint(arena);
+
+  mm_arena_mark_t inner = mm_arena_save(arena);
+  void* second = mm_arena_alloc(arena, 64);
+  for (int i = 0; i < 100; i++) ASSERT_NOT_NULL(mm_arena_alloc(arena, 200));
+  ASSERT_GT(mm_arena_footprint(arena), outer_footprint);
+
+  /* Rewinding the inner savepoint frees the chunks it spilled into and reuses the same bytes. */
+  mm_arena_rewind(arena, inner);
+  ASSERT_EQ(mm_arena_footprint(arena), outer_footprint);
+  ASSERT_EQ(mm_arena_alloc(arena, 64), second);
+
+  mm_arena_rewind(arena, outer);
+  ASSERT_EQ(mm_arena_alloc(arena, 256), first);
+  ASSERT((mm_validate)(alloc));
+
+  /* A savepoint taken before the first chunk rewinds to nothing. */
+  mm_arena_rewind(arena, empty);
+  ASSERT_EQ(mm_arena_footprint(arena), 0);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_memalign(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  static void* arena_mem[16];
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  mm_arena_t arena = mm_arena_create(arena_mem, alloc, CHUNK);
+  ASSERT_NOT_NULL(arena);
+
+  ASSERT_NOT_NULL(mm_arena_alloc(arena, 3));
+  static const size_t aligns[] = {1, 8, 32, 256, 4096, 16384};
+  for (size_t i = 0; i < sizeof(aligns) / sizeof(aligns[0]); i++) {
+    void* p = mm_arena_memalign(arena, aligns[i], 40);
+    ASSERT_NOT_NULL(p);
+    ASSERT_EQ((uintptr_t)p % aligns[i], 0);
+    memset(p, 0x11, 40);
+  }
+  ASSERT_NULL(mm_arena_memalign(arena, 48, 16));
+  ASSERT_NULL(mm_arena_memalign(arena, 0, 16));
+  ASSERT((mm_validate)(alloc));
+
+  mm_arena_destroy(arena);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_exhaustion_and_bad_arguments(void) {
+  static uint8_t backing[32 * 1024] __attribute__((aligned(16)));
+  static void* arena_mem[16];
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_NULL(mm_arena_create(NULL, alloc, CHUNK));
+  ASSERT_NULL(mm_arena_create(arena_mem, NULL, CHUNK));
+  ASSERT_NULL(mm_arena_create((char*)arena_mem + 1, alloc, CHUNK));
+  ASSERT_NULL(mm_arena_create(arena_mem, alloc, 1));
+
+  mm_arena_t arena = mm_arena_create(arena_mem, alloc, CHUNK);
+  ASSERT_NOT_NULL(arena);
+  ASSERT_NULL(mm_arena_alloc(arena, SIZE_MAX));
+  ASSERT_NULL(mm_arena_alloc(arena, sizeof(backing)));
+
+  /* Running out of heap fails the request but keeps what was already carved. */
+  size_t got = 0;
+  void* last = NULL;
+  for (;;) {
+    void* p = mm_arena_alloc(arena, 1000);
+    if (!p) break;
+    last = p;
+    got++;
+  }
+  ASSERT_GT(got, 10);
+  memset(last, 0x77, 1000);
+  ASSERT((mm_validate)(alloc));
+
+  mm_arena_release(arena);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Arenas");
+  RUN_TEST(test_bump_within_one_chunk);
+  RUN_TEST(test_chunks_grow_and_release_at_once);
+  RUN_TEST(test_nested_savepoints);
+  RUN_TEST(test_memalign);
+  RUN_TEST(test_exhaustion_and_bad_arguments);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -0,0 +1,118 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+static int test_malloc_batch_carves_contiguous_blocks(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* out[100];
+  ASSERT_EQ(mm_malloc_batch(alloc, 100, 100, out), 100);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_NOT_NULL(out[i]);
+    ASSERT_GE(mm_block_size(out[i]), 100);
+    ASSERT_EQ((uintptr_t)out[i] % mm_align_size(), 0);
+    memset(out[i], i, 100);
+  }
+  /* Carved back to back from one free block. */
+  for (int i = 1; i < 100; i++) {
+    ASSERT_EQ((char*)out[i] - (char*)out[i - 1], (ptrdiff_t)(mm_block_size(out[i - 1]) + mm_alloc_overhead()));
+  }
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 100; j++) ASSERT_EQ(((unsigned char*)out[i])[j], (unsigned char)i);
+  }
+  ASSERT((mm_validate)(alloc));
+
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.malloc_count, 100);
+
+  for (int i = 0; i < 100; i++) (mm_free)(alloc, out[i]);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_malloc_batch_partial_when_exhausted(void) {
+  uint8_t backing[32 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  static void* out[1024];
+  size_t got = mm_malloc_batch(alloc, 256, 1024, out);
+  ASSERT_GT(got, 0);
+  ASSERT_LT(got, 1024);
+  ASSERT((mm_validate)(alloc));
+
+  mm_free_batch(alloc, out, got);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  ASSERT_EQ(mm_malloc_batch(alloc, 0, 4, out), 0);
+  ASSERT_EQ(mm_malloc_batch(alloc, 64, 0, out), 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_free_batch_merges_runs(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* ptrs[64];
+  for (int i = 0; i < 64; i++) {
+    ptrs[i] = (mm_malloc)(alloc, 64 + (size_t)(i % 5) * 40);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  void* keep = ptrs[10];
+
+  /* Free all but one, in scrambled order, including a NULL and a duplicate. */
+  void* batch[66];
+  size_t n = 0;
+  for (int i = 63; i >= 0; i -= 2) batch[n++] = ptrs[i];
+  for (int i = 0; i < 64; i += 2) {
+    if (ptrs[i] != keep) batch[n++] = ptrs[i];
+  }
+  batch[n++] = NULL;
+  batch[n++] = ptrs[3];
+  mm_free_batch(alloc, batch, n);
+  ASSERT((mm_validate)(alloc));
+
+  /* Sorted in place. */
+  for (size_t i = 1; i < n; i++) ASSERT_LE((uintptr_t)batch[i - 1], (uintptr_t)batch[i]);
+
+  ASSERT_EQ((mm_reset)(alloc), 0);
+  (mm_free)(alloc, keep);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_batch_roundtrip_slab_instance(void) {
+  const size_t bytes = 1024 * 1024;
+  void* mem = malloc(bytes);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, bytes, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  void* small[200];
+  void* large[20];
+  ASSERT_EQ(mm_malloc_batch(alloc, 48, 200, small), 200);
+  ASSERT_EQ(mm_malloc_batch(alloc, 2000, 20, large), 20);
+  mm_free_batch(alloc, small, 200);
+  mm_free_batch(alloc, large, 20);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Batch allocation");
+  RUN_TEST(test_malloc_batch_carves_contiguous_blocks);
+  RUN_TEST(test_malloc_batch_partial_when_exhausted);
+  RUN_TEST(test_free_batch_merges_runs);
+  RUN_TEST(test_batch_roundtrip_slab_instance);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
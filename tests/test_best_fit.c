@@ -0,0 +1,141 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+#ifndef MM_BEST_FIT_SCAN
+#define MM_BEST_FIT_SCAN 8
+#endif
+
+/* Sizes inside one second-level class: [8192, 8192 + 8192 / SL_COUNT) spans at least 128 bytes for SL <= 64. */
+#define CLASS_BASE 8192u
+#define SMALLER (CLASS_BASE + 16u)
+#define REQUEST (CLASS_BASE + 48u)
+#define LARGER (CLASS_BASE + 96u)
+
+/* Leaves free blocks of `sizes[i]` separated by live guards; the last one freed is the list head. */
+static int carve_free_blocks(tlsf_t alloc, const size_t* sizes, size_t n, void** blocks, void** guards) {
+  for (size_t i = 0; i < n; i++) {
+    blocks[i] = (mm_malloc)(alloc, sizes[i]);
+    guards[i] = (mm_malloc)(alloc, 64);
+    if (!blocks[i] || !guards[i]) return 0;
+    if ((mm_block_size)(blocks[i]) != sizes[i]) return 0;
+  }
+  for (size_t i = 0; i < n; i++) (mm_free)(alloc, blocks[i]);
+  return 1;
+}
+
+static int test_best_fit_takes_exact_block(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_BEST_FIT);
+  ASSERT_NOT_NULL(alloc);
+
+  /* Head of the class list is too small, the next one is larger than needed, the oldest fits exactly. */
+  const size_t sizes[] = {REQUEST, LARGER, SMALLER};
+  void* blocks[3];
+  void* guards[3];
+  ASSERT(carve_free_blocks(alloc, sizes, 3, blocks, guards));
+
+  void* p = (mm_malloc)(alloc, REQUEST);
+  ASSERT_EQ(p, blocks[0]);
+  /* Next best in the class. */
+  void* q = (mm_malloc)(alloc, REQUEST);
+  ASSERT_EQ(q, blocks[1]);
+  ASSERT((mm_validate)(alloc));
+
+  (mm_free)(alloc, p);
+  (mm_free)(alloc, q);
+  for (int i = 0; i < 3; i++) (mm_free)(alloc, guards[i]);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_good_fit_rounds_up(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  const size_t sizes[] = {REQUEST, LARGER, SMALLER};
+  void* blocks[3];
+  void* guards[3];
+  ASSERT(carve_free_blocks(alloc, sizes, 3, blocks, guards));
+
+  /* Without the flag the request skips its own class and splits a block from a larger one. */
+  void* p = (mm_malloc)(alloc, REQUEST);
+  ASSERT_NOT_NULL(p);
+  for (int i = 0; i < 3; i++) ASSERT_NE(p, blocks[i]);
+
+  (mm_free)(alloc, p);
+  for (int i = 0; i < 3; i++) (mm_free)(alloc, guards[i]);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_scan_is_bounded(void) {
+  static uint8_t backing[512 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_BEST_FIT);
+  ASSERT_NOT_NULL(alloc);
+
+  /* The exact fit is freed first, so MM_BEST_FIT_SCAN larger blocks sit in front of it. */
+  enum { N = MM_BEST_FIT_SCAN + 1 };
+  size_t sizes[N];
+  void* blocks[N];
+  void* guards[N];
+  sizes[0] = REQUEST;
+  for (int i = 1; i < N; i++) sizes[i] = LARGER;
+  ASSERT(carve_free_blocks(alloc, sizes, N, blocks, guards));
+
+  void* p = (mm_malloc)(alloc, REQUEST);
+  ASSERT_NOT_NULL(p);
+  ASSERT_NE(p, blocks[0]);
+  int from_class = 0;
+  for (int i = 1; i < N; i++) from_class |= (p == blocks[i]);
+  ASSERT(from_class);
+
+  (mm_free)(alloc, p);
+  for (int i = 0; i < N; i++) (mm_free)(alloc, guards[i]);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_best_fit_churn_with_memalign(void) {
+  static uint8_t backing[1024 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_BEST_FIT);
+  ASSERT_NOT_NULL(alloc);
+
+  void* live[512] = {0};
+  uint32_t seed = 0xBE57F17u;
+  for (int i = 0; i < 50000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int slot = (int)((seed >> 16) % 512);
+    (mm_free)(alloc, live[slot]);
+    size_t size = 1 + (seed >> 3) % 3000;
+    live[slot] = (seed & 7u) == 0 ? (mm_memalign)(alloc, 64, size) : (mm_malloc)(alloc, size);
+    if (live[slot]) memset(live[slot], slot, size);
+    if ((i & 4095) == 0) ASSERT((mm_validate)(alloc));
+  }
+  for (int i = 0; i < 512; i++) (mm_free)(alloc, live[i]);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_best_fit_flag_accepted(void) {
+  uint8_t backing[32 * 1024] __attribute__((aligned(16)));
+  ASSERT_NOT_NULL(mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_BEST_FIT | MM_FLAG_THREAD_SAFE));
+  ASSERT_NULL(mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_MASK + 1u));
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Best fit");
+  RUN_TEST(test_best_fit_takes_exact_block);
+  RUN_TEST(test_good_fit_rounds_up);
+  RUN_TEST(test_scan_is_bounded);
+  RUN_TEST(test_best_fit_churn_with_memalign);
+  RUN_TEST(test_best_fit_flag_accepted);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -2,8 +2,8 @@
 #include "memoman_test_internal.h"
 
 static int test_constants_match_tlsf(void) {
-  ASSERT_EQ(BLOCK_HEADER_OVERHEAD, sizeof(size_t));
-  ASSERT_EQ(BLOCK_START_OFFSET, offsetof(tlsf_block_t, size) + sizeof(size_t));
+  ASSERT_EQ(BLOCK_HEADER_OVERHEAD, sizeof(size_t) > ALIGNMENT ? sizeof(size_t) : ALIGNMENT);
+  ASSERT_EQ(BLOCK_START_OFFSET, offsetof(tlsf_block_t, next_free));
   return 1;
 }
 
@@ -5,7 +5,9 @@ static int test_derived_constants_sane(void) {
   ASSERT((ALIGNMENT & (ALIGNMENT - 1)) == 0);
   ASSERT_GE(ALIGNMENT, sizeof(void*));
 
-  ASSERT_EQ(BLOCK_HEADER_OVERHEAD, sizeof(size_t));
+  /* One size word, padded to ALIGNMENT when that is wider so payloads stay aligned. */
+  ASSERT_EQ(BLOCK_HEADER_OVERHEAD, (sizeof(size_t) > ALIGNMENT) ? sizeof(size_t) : ALIGNMENT);
+  ASSERT_EQ(BLOCK_HEADER_OVERHEAD % ALIGNMENT, 0);
   ASSERT_EQ(BLOCK_START_OFFSET, BLOCK_HEADER_OVERHEAD);
   ASSERT_EQ(offsetof(tlsf_block_t, next_free), BLOCK_START_OFFSET);
   ASSERT_EQ(offsetof(tlsf_block_t, prev_free), BLOCK_START_OFFSET + sizeof(void*));
@@ -14,8 +16,9 @@ static int test_derived_constants_sane(void) {
   ASSERT_GE(TLSF_MIN_BLOCK_SIZE, 3 * sizeof(void*));
 
   ASSERT_EQ(TLSF_FLI_MAX, FL_INDEX_COUNT);
-  ASSERT_LE(FL_INDEX_COUNT, (int)(sizeof(unsigned int) * 8));
-  ASSERT_LE(SL_INDEX_COUNT, (int)(sizeof(unsigned int) * 8));
+  ASSERT_LE(FL_INDEX_COUNT, MM_BITMAP_BITS);
+  ASSERT_LE(SL_INDEX_COUNT, MM_BITMAP_BITS);
+  ASSERT_EQ(MM_BITMAP_BITS, (int)(sizeof(((struct mm_allocator_t*)0)->fl_bitmap) * 8));
 
   return 1;
 }
@@ -69,7 +72,7 @@ static int test_split_respects_min_block_size(void) {
   ASSERT_NOT_NULL(alloc2);
 
   void* g1 = (mm_malloc)(alloc2, 64);
-  void* t = (mm_malloc)(alloc2, 240);
+  void* t = (mm_malloc)(alloc2, small_block_size - 16);
   void* g2 = (mm_malloc)(alloc2, 64);
   ASSERT_NOT_NULL(g1);
   ASSERT_NOT_NULL(t);
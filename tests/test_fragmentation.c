@@ -22,7 +22,7 @@ static double calculate_fragmentation(void) {
 
   /* Iterate through all free lists */
   for (int fl = 0; fl < TLSF_FLI_MAX; fl++) {
-    if (!((ctrl->fl_bitmap & (1U << fl)))) continue;
+    if (!((ctrl->fl_bitmap & MM_BIT(fl)))) continue;
 
     for (int sl = 0; sl < TLSF_SLI_COUNT; sl++) {
       tlsf_block_t* block = ctrl->blocks[fl][sl];
@@ -54,7 +54,7 @@ static int count_free_blocks(void) {
 
   int count = 0;
   for (int fl = 0; fl < TLSF_FLI_MAX; fl++) {
-    if (!((ctrl->fl_bitmap & (1U << fl)))) continue;
+    if (!((ctrl->fl_bitmap & MM_BIT(fl)))) continue;
     for (int sl = 0; sl < TLSF_SLI_COUNT; sl++) {
       tlsf_block_t* block = ctrl->blocks[fl][sl];
       while (block != NULL) {
@@ -168,12 +168,142 @@ static int test_extreme_fragmentation(void) {
   #undef NUM_EXTREME
 }
 
+/* Test 4: mm_fragmentation_report agrees with a direct walk of the free lists. */
+static int test_report_matches_free_lists(void) {
+  mm_reset_allocator();
+
+  #define NUM_REPORT 64
+  void* ptrs[NUM_REPORT];
+  for (int i = 0; i < NUM_REPORT; i++) {
+    ptrs[i] = mm_malloc(32 + (size_t)i * 24);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  for (int i = 0; i < NUM_REPORT; i += 2) mm_free(ptrs[i]);
+
+  mm_frag_report_t r;
+  ASSERT_EQ(mm_fragmentation_report(sys_allocator, &r), 1);
+  ASSERT_EQ((int)r.free_blocks, count_free_blocks());
+  ASSERT_EQ(r.free_bytes, ((struct mm_allocator_t*)sys_allocator)->current_free_size);
+  ASSERT_LE(r.smallest_free_block, r.largest_free_block);
+  double expected = calculate_fragmentation() / 100.0;
+  ASSERT(r.external_fragmentation > expected - 1e-9 && r.external_fragmentation < expected + 1e-9);
+
+  /* The histogram partitions the free blocks by floor(log2(size)). */
+  size_t blocks = 0;
+  size_t bytes = 0;
+  for (int i = 0; i < MM_FRAG_HIST_BINS; i++) {
+    if (r.hist_blocks[i]) {
+      ASSERT_GE(r.hist_bytes[i], r.hist_blocks[i] * ((size_t)1 << i));
+      ASSERT_LT(r.hist_bytes[i], r.hist_blocks[i] * ((size_t)2 << i));
+    }
+    blocks += r.hist_blocks[i];
+    bytes += r.hist_bytes[i];
+  }
+  ASSERT_EQ(blocks, r.free_blocks);
+  ASSERT_EQ(bytes, r.free_bytes);
+
+  /* The exact largest block is never below the class-granular estimate from mm_get_stats. */
+  mm_stats_t st;
+  ASSERT_EQ(mm_get_stats(sys_allocator, &st), 1);
+  ASSERT_GE(r.largest_free_block, st.largest_free_block);
+
+  for (int i = 1; i < NUM_REPORT; i += 2) mm_free(ptrs[i]);
+  ASSERT_EQ(mm_fragmentation_report(sys_allocator, &r), 1);
+  ASSERT_EQ(r.free_blocks, 1);
+  ASSERT(r.external_fragmentation == 0.0);
+  return 1;
+  #undef NUM_REPORT
+}
+
+/* Test 5: mm_free_space_map lists every non-empty class, ascending, with blocks inside each class range. */
+static int test_free_space_map(void) {
+  mm_reset_allocator();
+
+  #define NUM_MAP 48
+  void* ptrs[NUM_MAP];
+  for (int i = 0; i < NUM_MAP; i++) {
+    ptrs[i] = mm_malloc(16 + (size_t)i * 40);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  for (int i = 0; i < NUM_MAP; i += 3) mm_free(ptrs[i]);
+
+  mm_frag_report_t r;
+  ASSERT_EQ(mm_fragmentation_report(sys_allocator, &r), 1);
+  size_t n = mm_free_space_map(sys_allocator, NULL, 0);
+  ASSERT_EQ(n, r.nonempty_classes);
+  ASSERT_GT(n, 1);
+
+  mm_free_class_t map[64];
+  ASSERT_LE(n, 64);
+  ASSERT_EQ(mm_free_space_map(sys_allocator, map, 64), n);
+  struct mm_allocator_t* ctrl = (struct mm_allocator_t*)sys_allocator;
+  size_t blocks = 0;
+  size_t bytes = 0;
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_GT(map[i].blocks, 0);
+    ASSERT_LE(map[i].min_size, map[i].max_size);
+    if (i) ASSERT_GT(map[i].min_size, map[i - 1].max_size);
+    for (tlsf_block_t* b = ctrl->blocks[map[i].fl][map[i].sl]; b; b = b->next_free) {
+      size_t size = b->size & TLSF_SIZE_MASK;
+      ASSERT_GE(size, map[i].min_size);
+      ASSERT_LE(size, map[i].max_size);
+    }
+    blocks += map[i].blocks;
+    bytes += map[i].bytes;
+  }
+  ASSERT_EQ(blocks, r.free_blocks);
+  ASSERT_EQ(bytes, r.free_bytes);
+
+  /* A short output array gets the smallest classes first. */
+  mm_free_class_t first[2];
+  ASSERT_EQ(mm_free_space_map(sys_allocator, first, 2), 2);
+  ASSERT_EQ(first[1].min_size, map[1].min_size);
+
+  for (int i = 0; i < NUM_MAP; i++) {
+    if (i % 3) mm_free(ptrs[i]);
+  }
+  return 1;
+  #undef NUM_MAP
+}
+
+/* Test 6: the report never reads used blocks, so a clobbered used header does not affect it. */
+static int test_report_skips_used_blocks(void) {
+  mm_reset_allocator();
+
+  void* a = mm_malloc(256);
+  void* b = mm_malloc(256);
+  void* c = mm_malloc(256);
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+  ASSERT_NOT_NULL(c);
+  mm_free(a);
+
+  mm_frag_report_t before;
+  ASSERT_EQ(mm_fragmentation_report(sys_allocator, &before), 1);
+  tlsf_block_t* used = (tlsf_block_t*)((char*)b - BLOCK_START_OFFSET);
+  size_t saved = used->size;
+  used->size = 0xDEADBEEF;
+  mm_frag_report_t during;
+  ASSERT_EQ(mm_fragmentation_report(sys_allocator, &during), 1);
+  used->size = saved;
+
+  ASSERT_EQ(during.free_blocks, before.free_blocks);
+  ASSERT_EQ(during.free_bytes, before.free_bytes);
+  ASSERT_EQ(during.largest_free_block, before.largest_free_block);
+  mm_free(b);
+  mm_free(c);
+  return 1;
+}
+
 int main(void) {
   TEST_SUITE_BEGIN("Memory Fragementation Tests");
 
   RUN_TEST(test_no_fragmentation);
   RUN_TEST(test_checkerboard_fragmentation);
   RUN_TEST(test_extreme_fragmentation);
+  RUN_TEST(test_report_matches_free_lists);
+  RUN_TEST(test_free_space_map);
+  RUN_TEST(test_report_skips_used_blocks);
 
   TEST_SUITE_END();
   TEST_MAIN_END();
@@ -94,6 +94,13 @@ static inline const char* _format_size(size_t size, char* buf, size_t buflen) {
   return buf;
 }
 
+/* Payload bytes currently allocated from `alloc`, per mm_get_stats. */
+static inline size_t bytes_in_use(tlsf_t alloc) {
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  return st.bytes_in_use;
+}
+
 /* Run parameterized test for each size */
 #define RUN_PARAMETERIZED(fn, sizes, count) do { \
   char _sizebuf[32]; \
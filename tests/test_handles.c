@@ -0,0 +1,295 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+#define CAPACITY 2048
+
+static uint8_t g_table[64 * 1024] __attribute__((aligned(16)));
+
+static tlsf_t create_with_handles(void* backing, size_t bytes, unsigned int flags, size_t capacity) {
+  if (mm_handle_table_size(capacity) > sizeof(g_table)) return NULL;
+  tlsf_t alloc = mm_create_with_pool_ex(backing, bytes, flags);
+  if (!alloc || !mm_handles_attach(alloc, g_table, capacity)) return NULL;
+  return alloc;
+}
+
+static void fill(mm_handle_t h, void* p, size_t n) {
+  for (size_t i = 0; i < n; i++) ((uint8_t*)p)[i] = (uint8_t)(h * 31u + i);
+}
+
+static int check(mm_handle_t h, const void* p, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (((const uint8_t*)p)[i] != (uint8_t)(h * 31u + i)) return 0;
+  }
+  return 1;
+}
+
+static int test_lock_round_trip(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = create_with_handles(backing, sizeof(backing), 0, 16);
+  ASSERT_NOT_NULL(alloc);
+
+  mm_handle_t h = mm_halloc(alloc, 100);
+  ASSERT_NE(h, 0);
+  void* p = mm_hlock(alloc, h);
+  ASSERT_NOT_NULL(p);
+  ASSERT_EQ((uintptr_t)p % mm_align_size(), 0);
+  fill(h, p, 100);
+  /* Pins nest and the address is stable while pinned. */
+  ASSERT_EQ(mm_hlock(alloc, h), p);
+  mm_hunlock(alloc, h);
+  mm_hunlock(alloc, h);
+  ASSERT_EQ(mm_hlock(alloc, h), p);
+  ASSERT(check(h, p, 100));
+  mm_hunlock(alloc, h);
+
+  mm_hfree(alloc, h);
+  ASSERT_NULL(mm_hlock(alloc, h));
+  mm_hfree(alloc, h);
+  /* The entry is reused under a new generation. */
+  mm_handle_t again = mm_halloc(alloc, 100);
+  ASSERT_NE(again, 0);
+  ASSERT_NE(again, h);
+  ASSERT_NULL(mm_hlock(alloc, h));
+  mm_hfree(alloc, again);
+
+  ASSERT_EQ(mm_halloc(alloc, 0), 0);
+  ASSERT_NULL(mm_hlock(alloc, 0));
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_table_limits(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  ASSERT_EQ(mm_handle_table_size(0), 0);
+  ASSERT_EQ(mm_handle_table_size((size_t)1 << 20), 0);
+  tlsf_t alloc = create_with_handles(backing, sizeof(backing), 0, 4);
+  ASSERT_NOT_NULL(alloc);
+
+  mm_handle_t hs[4];
+  for (int i = 0; i < 4; i++) {
+    hs[i] = mm_halloc(alloc, 32);
+    ASSERT_NE(hs[i], 0);
+  }
+  ASSERT_EQ(mm_halloc(alloc, 32), 0);
+
+  /* The table cannot be swapped out from under live handles; a heap without handles compacts trivially. */
+  ASSERT_EQ(mm_handles_attach(alloc, NULL, 0), 0);
+  for (int i = 0; i < 4; i++) mm_hfree(alloc, hs[i]);
+  ASSERT_EQ(mm_handles_attach(alloc, NULL, 0), 1);
+  ASSERT_EQ(mm_halloc(alloc, 32), 0);
+  ASSERT_EQ(mm_compact(alloc, 1000), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+/* Frees every other handle of `n` equal blocks, leaving one hole between each pair of survivors. */
+static size_t make_holes(tlsf_t alloc, mm_handle_t* hs, size_t n, size_t bytes) {
+  size_t made = 0;
+  for (size_t i = 0; i < n; i++) {
+    hs[i] = mm_halloc(alloc, bytes);
+    if (!hs[i]) break;
+    void* p = mm_hlock(alloc, hs[i]);
+    fill(hs[i], p, bytes);
+    mm_hunlock(alloc, hs[i]);
+    made++;
+  }
+  for (size_t i = 0; i < made; i += 2) {
+    mm_hfree(alloc, hs[i]);
+    hs[i] = 0;
+  }
+  return made;
+}
+
+static int test_compact_merges_free_space(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  static mm_handle_t hs[64];
+  tlsf_t alloc = create_with_handles(backing, sizeof(backing), 0, CAPACITY);
+  ASSERT_NOT_NULL(alloc);
+
+  size_t n = make_holes(alloc, hs, 64, 1000);
+  ASSERT_EQ(n, 64);
+  mm_frag_report_t before;
+  ASSERT_EQ(mm_fragmentation_report(alloc, &before), 1);
+  ASSERT_GT(before.free_blocks, 30);
+
+  ASSERT_EQ(mm_compact(alloc, 1000000), 1);
+  ASSERT((mm_validate)(alloc));
+  mm_frag_report_t after;
+  ASSERT_EQ(mm_fragmentation_report(alloc, &after), 1);
+  ASSERT_EQ(after.free_blocks, 1);
+  ASSERT_EQ(after.free_bytes, after.largest_free_block);
+  ASSERT_GT(after.largest_free_block, before.largest_free_block);
+
+  /* Survivors kept their bytes and now sit back to back in address order. */
+  uintptr_t last = 0;
+  for (size_t i = 1; i < n; i += 2) {
+    void* p = mm_hlock(alloc, hs[i]);
+    ASSERT_NOT_NULL(p);
+    ASSERT(check(hs[i], p, 1000));
+    ASSERT_GT((uintptr_t)p, last);
+    last = (uintptr_t)p;
+    mm_hunlock(alloc, hs[i]);
+  }
+  /* Nothing left to move. */
+  ASSERT_EQ(mm_compact(alloc, 1000000), 1);
+
+  for (size_t i = 1; i < n; i += 2) mm_hfree(alloc, hs[i]);
+  ASSERT((mm_validate)(alloc));
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.bytes_in_use, 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_pinned_and_raw_blocks_stay(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  static mm_handle_t hs[32];
+  tlsf_t alloc = create_with_handles(backing, sizeof(backing), 0, CAPACITY);
+  ASSERT_NOT_NULL(alloc);
+
+  size_t n = make_holes(alloc, hs, 16, 512);
+  ASSERT_EQ(n, 16);
+  /* A raw block after the handles, then more holes behind it. */
+  void* raw = (mm_malloc)(alloc, 512);
+  ASSERT_NOT_NULL(raw);
+  memset(raw, 0x5A, 512);
+  ASSERT_EQ(make_holes(alloc, hs + 16, 16, 512), 16);
+
+  void* pinned = mm_hlock(alloc, hs[7]);
+  ASSERT_NOT_NULL(pinned);
+  ASSERT_EQ(mm_compact(alloc, 1000000), 1);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_hlock(alloc, hs[7]), pinned);
+  mm_hunlock(alloc, hs[7]);
+  for (size_t i = 0; i < 512; i++) ASSERT_EQ(((uint8_t*)raw)[i], 0x5A);
+
+  /* Blocks behind the pin and behind the raw block were packed up against them. */
+  mm_frag_report_t report;
+  ASSERT_EQ(mm_fragmentation_report(alloc, &report), 1);
+  ASSERT_LE(report.free_blocks, 3);
+
+  mm_hunlock(alloc, hs[7]);
+  ASSERT_EQ(mm_compact(alloc, 1000000), 1);
+  ASSERT_EQ(mm_fragmentation_report(alloc, &report), 1);
+  ASSERT_LE(report.free_blocks, 2);
+
+  for (size_t i = 0; i < 32; i++) {
+    if (!hs[i]) continue;
+    void* p = mm_hlock(alloc, hs[i]);
+    ASSERT(check(hs[i], p, 512));
+    mm_hunlock(alloc, hs[i]);
+    mm_hfree(alloc, hs[i]);
+  }
+  (mm_free)(alloc, raw);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_budget_is_incremental(void) {
+  static uint8_t backing[2 * 1024 * 1024] __attribute__((aligned(16)));
+  static mm_handle_t hs[CAPACITY];
+  tlsf_t alloc = create_with_handles(backing, sizeof(backing), 0, CAPACITY);
+  ASSERT_NOT_NULL(alloc);
+
+  uint32_t seed = 0xC0A1E5Cu;
+  for (size_t i = 0; i < CAPACITY; i++) {
+    seed = seed * 1103515245u + 12345u;
+    size_t bytes = 16 + (seed >> 8) % 400;
+    hs[i] = mm_halloc(alloc, bytes);
+    ASSERT_NE(hs[i], 0);
+    void* p = mm_hlock(alloc, hs[i]);
+    fill(hs[i], p, 16);
+    mm_hunlock(alloc, hs[i]);
+  }
+  for (size_t i = 0; i < CAPACITY; i++) {
+    seed = seed * 1103515245u + 12345u;
+    if (seed & 0x100u) {
+      mm_hfree(alloc, hs[i]);
+      hs[i] = 0;
+    }
+  }
+
+  /* A zero budget still makes progress: every call visits at least one block. */
+  size_t calls = 1;
+  while (!mm_compact(alloc, 0)) {
+    calls++;
+    ASSERT_LT(calls, 1000000);
+    /* The heap stays usable between slices. */
+    if ((calls & 1023) == 0) {
+      mm_handle_t t = mm_halloc(alloc, 64);
+      ASSERT_NE(t, 0);
+      mm_hfree(alloc, t);
+    }
+  }
+  ASSERT_GT(calls, 100);
+  ASSERT((mm_validate)(alloc));
+
+  mm_frag_report_t report;
+  ASSERT_EQ(mm_fragmentation_report(alloc, &report), 1);
+  ASSERT_LE(report.free_blocks, 2);
+  for (size_t i = 0; i < CAPACITY; i++) {
+    if (!hs[i]) continue;
+    void* p = mm_hlock(alloc, hs[i]);
+    ASSERT(check(hs[i], p, 16));
+    mm_hunlock(alloc, hs[i]);
+    mm_hfree(alloc, hs[i]);
+  }
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+typedef struct move_log_t {
+  size_t moves;
+  size_t mallocs;
+  size_t frees;
+} move_log_t;
+
+static void count_events(void* user, const mm_trace_event_t* event) {
+  move_log_t* log = (move_log_t*)user;
+  if (event->op == MM_OP_REALLOC) log->moves++;
+  if (event->op == MM_OP_MALLOC) log->mallocs++;
+  if (event->op == MM_OP_FREE) log->frees++;
+}
+
+static int test_slab_instance_and_trace(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  static mm_handle_t hs[64];
+  tlsf_t alloc = create_with_handles(backing, sizeof(backing), MM_FLAG_SLAB, CAPACITY);
+  ASSERT_NOT_NULL(alloc);
+  move_log_t log = {0, 0, 0};
+  mm_set_trace_hook(alloc, count_events, &log);
+
+  /* Small handle blocks bypass the slab front end, so they can still move. */
+  ASSERT_EQ(make_holes(alloc, hs, 64, 24), 64);
+  ASSERT_EQ(mm_compact(alloc, 1000000), 1);
+  ASSERT_GT(log.moves, 0);
+  ASSERT_EQ(log.mallocs, 64);
+  ASSERT_EQ(log.frees, 32);
+  for (size_t i = 1; i < 64; i += 2) {
+    void* p = mm_hlock(alloc, hs[i]);
+    ASSERT(check(hs[i], p, 24));
+    mm_hunlock(alloc, hs[i]);
+    mm_hfree(alloc, hs[i]);
+  }
+  mm_set_trace_hook(alloc, NULL, NULL);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Handles and compaction");
+  RUN_TEST(test_lock_round_trip);
+  RUN_TEST(test_table_limits);
+  RUN_TEST(test_compact_merges_free_space);
+  RUN_TEST(test_pinned_and_raw_blocks_stay);
+  RUN_TEST(test_budget_is_incremental);
+  RUN_TEST(test_slab_instance_and_trace);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
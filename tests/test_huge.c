@@ -0,0 +1,153 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include "../src/memoman_os.h"
+#include <stdint.h>
+
+#define HUGE_2M ((size_t)2 << 20)
+
+static int test_huge_map_rounds_and_aligns(void) {
+  mm_huge_region_t r;
+  ASSERT(mm_huge_map(&r, 3 * 1024 * 1024, 0));
+  ASSERT_NOT_NULL(r.base);
+  ASSERT_EQ(r.page_size, HUGE_2M);
+  ASSERT_EQ(r.bytes, 2 * HUGE_2M);
+  ASSERT_EQ((uintptr_t)r.base % HUGE_2M, 0);
+  ASSERT(r.backing == MM_HUGE_NONE || r.backing == MM_HUGE_THP || r.backing == MM_HUGE_HUGETLB);
+  ((volatile char*)r.base)[0] = 1;
+  ((volatile char*)r.base)[r.bytes - 1] = 2;
+  mm_huge_unmap(&r);
+  ASSERT_NULL(r.base);
+
+  /* Page sizes must be powers of two no smaller than a base page. */
+  ASSERT_EQ(mm_huge_map(&r, HUGE_2M, 3 * 1024 * 1024), 0);
+  ASSERT_EQ(mm_huge_map(&r, HUGE_2M, 512), 0);
+  ASSERT_EQ(mm_huge_map(&r, 0, HUGE_2M), 0);
+  ASSERT_EQ(mm_huge_map(NULL, HUGE_2M, HUGE_2M), 0);
+  ASSERT_EQ(mm_huge_map(&r, SIZE_MAX, HUGE_2M), 0);
+  return 1;
+}
+
+static int test_huge_pool_serves_allocations(void) {
+  static uint8_t ctrl_mem[64 * 1024] __attribute__((aligned(16)));
+  ASSERT_LE(mm_size(), sizeof(ctrl_mem));
+  tlsf_t alloc = mm_create_ex(ctrl_mem, MM_FLAG_CLUSTER_SMALL);
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_NULL((mm_malloc)(alloc, 64));
+
+  mm_huge_region_t r;
+  pool_t pool = mm_add_huge_pool(alloc, &r, HUGE_2M, 0);
+  ASSERT_NOT_NULL(pool);
+  void* small = (mm_malloc)(alloc, 64);
+  void* large = (mm_malloc)(alloc, 256 * 1024);
+  ASSERT_NOT_NULL(small);
+  ASSERT_NOT_NULL(large);
+  ASSERT_EQ(mm_get_pool_for_ptr(alloc, small), pool);
+  ASSERT_EQ(mm_get_pool_for_ptr(alloc, large), pool);
+  ASSERT((mm_validate)(alloc));
+
+  (mm_free)(alloc, small);
+  (mm_free)(alloc, large);
+  ASSERT(mm_pool_is_empty(alloc, pool));
+  mm_remove_pool(alloc, pool);
+  mm_huge_unmap(&r);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+#define PAIRS 64
+#define SMALL 48
+#define LARGE 8192
+
+/* Alternates small and large requests; returns nonzero if every small block lies below every large one. */
+static int small_below_large(tlsf_t alloc, void** small, void** large) {
+  for (int i = 0; i < PAIRS; i++) {
+    small[i] = (mm_malloc)(alloc, SMALL);
+    large[i] = (mm_malloc)(alloc, LARGE);
+    if (!small[i] || !large[i]) return -1;
+  }
+  uintptr_t max_small = 0;
+  uintptr_t min_large = UINTPTR_MAX;
+  for (int i = 0; i < PAIRS; i++) {
+    if ((uintptr_t)small[i] > max_small) max_small = (uintptr_t)small[i];
+    if ((uintptr_t)large[i] < min_large) min_large = (uintptr_t)large[i];
+  }
+  return max_small < min_large;
+}
+
+static int test_cluster_small_packs_small_blocks(void) {
+  static uint8_t backing[1024 * 1024] __attribute__((aligned(16)));
+  void* small[PAIRS];
+  void* large[PAIRS];
+
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_CLUSTER_SMALL);
+  ASSERT_NOT_NULL(alloc);
+  mm_stats_t fresh;
+  mm_get_stats(alloc, &fresh);
+  ASSERT_EQ(small_below_large(alloc, small, large), 1);
+
+  /* The small blocks are contiguous: one 4 KiB page holds dozens of them. */
+  uintptr_t lo = UINTPTR_MAX, hi = 0;
+  for (int i = 0; i < PAIRS; i++) {
+    if ((uintptr_t)small[i] < lo) lo = (uintptr_t)small[i];
+    if ((uintptr_t)small[i] > hi) hi = (uintptr_t)small[i];
+  }
+  ASSERT_LT(hi - lo, (uintptr_t)PAIRS * (SMALL + 2 * mm_alloc_overhead() + mm_align_size()));
+  ASSERT((mm_validate)(alloc));
+
+  /* Freeing in any order merges everything back into the original free block. */
+  for (int i = 0; i < PAIRS; i++) (mm_free)(alloc, large[(i * 7) % PAIRS]);
+  for (int i = 0; i < PAIRS; i++) (mm_free)(alloc, small[i]);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.largest_free_block, fresh.largest_free_block);
+  (mm_destroy)(alloc);
+
+  /* Without the flag the same sequence interleaves. */
+  alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_EQ(small_below_large(alloc, small, large), 0);
+  for (int i = 0; i < PAIRS; i++) {
+    (mm_free)(alloc, small[i]);
+    (mm_free)(alloc, large[i]);
+  }
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_cluster_small_churn(void) {
+  static uint8_t backing[2 * 1024 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_CLUSTER_SMALL | MM_FLAG_ADDRESS_ORDERED);
+  ASSERT_NOT_NULL(alloc);
+
+  void* live[512] = {0};
+  uint32_t seed = 0x4B6E7u;
+  for (int i = 0; i < 50000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int slot = (int)((seed >> 16) % 512);
+    size_t size = (seed & 8u) ? 1 + (seed >> 5) % 256 : 4096 + (seed >> 5) % 20000;
+    if ((seed & 3u) == 0 && live[slot]) {
+      void* q = (mm_realloc)(alloc, live[slot], size);
+      if (q) live[slot] = q;
+    } else {
+      (mm_free)(alloc, live[slot]);
+      live[slot] = (seed & 7u) == 1 ? (mm_memalign)(alloc, 256, size) : (mm_malloc)(alloc, size);
+    }
+    if ((i & 4095) == 0) ASSERT((mm_validate)(alloc));
+  }
+  for (int i = 0; i < 512; i++) (mm_free)(alloc, live[i]);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Huge-page pools and small-block clustering");
+  RUN_TEST(test_huge_map_rounds_and_aligns);
+  RUN_TEST(test_huge_pool_serves_allocations);
+  RUN_TEST(test_cluster_small_packs_small_blocks);
+  RUN_TEST(test_cluster_small_churn);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -49,9 +49,10 @@ static int test_realloc_inst_growth() {
 }
 
 static int test_realloc_inst_oom() {
-  /* Create a small pool (16KB) - enough for struct (~8KB) + heap */
-  uint8_t buffer[16384] __attribute__((aligned(16)));
-  tlsf_t alloc = mm_create_with_pool(buffer, sizeof(buffer));
+  /* Create a small pool: the control block (mm_size(), geometry-dependent) plus ~4KB of heap */
+  uint8_t buffer[32768] __attribute__((aligned(16)));
+  ASSERT_LE(mm_size() + 4096, sizeof(buffer));
+  tlsf_t alloc = mm_create_with_pool(buffer, mm_size() + 4096);
   ASSERT_NOT_NULL(alloc);
   
   /* Use up some space */
@@ -0,0 +1,160 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <pthread.h>
+#include <stdint.h>
+
+/* Built with -DMM_LATENCY=1 (see the Makefile rule for this binary). */
+
+static int check_summary_ordered(const mm_latency_t* lat) {
+  ASSERT_LE(lat->min, lat->p50);
+  ASSERT_LE(lat->p50, lat->p90);
+  ASSERT_LE(lat->p90, lat->p99);
+  ASSERT_LE(lat->p99, lat->p999);
+  ASSERT_LE(lat->p999, lat->max);
+  ASSERT_GE(lat->mean, lat->min);
+  ASSERT_LE(lat->mean, lat->max);
+  return 1;
+}
+
+static int test_counts_every_operation(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* ptrs[100];
+  for (int i = 0; i < 100; i++) ptrs[i] = (mm_malloc)(alloc, 16 + (size_t)i * 8);
+  for (int i = 0; i < 10; i++) ptrs[i] = (mm_realloc)(alloc, ptrs[i], 2000);
+  void* aligned = (mm_memalign)(alloc, 256, 100);
+  ASSERT_NOT_NULL(aligned);
+  for (int i = 0; i < 100; i++) (mm_free)(alloc, ptrs[i]);
+  (mm_free)(alloc, aligned);
+
+  mm_latency_t lat;
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_MALLOC, &lat), 1);
+  ASSERT_EQ(lat.count, 100);
+  ASSERT(check_summary_ordered(&lat));
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_REALLOC, &lat), 1);
+  ASSERT_EQ(lat.count, 10);
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_MEMALIGN, &lat), 1);
+  ASSERT_EQ(lat.count, 1);
+  ASSERT_EQ(lat.min, lat.max);
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_FREE, &lat), 1);
+  ASSERT_EQ(lat.count, 101);
+  ASSERT(check_summary_ordered(&lat));
+
+  /* A failed request is still a call the caller waited for. */
+  ASSERT_NULL((mm_malloc)(alloc, sizeof(backing) * 2));
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_MALLOC, &lat), 1);
+  ASSERT_EQ(lat.count, 101);
+
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_buckets_match_count(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  for (int i = 0; i < 1000; i++) (mm_free)(alloc, (mm_malloc)(alloc, 1 + (size_t)(i * 37) % 4000));
+
+  uint64_t upper[512];
+  uint64_t counts[512];
+  size_t n = mm_get_latency_buckets(alloc, MM_OP_MALLOC, upper, counts, 512);
+  ASSERT_GT(n, 0);
+  ASSERT_EQ(mm_get_latency_buckets(alloc, MM_OP_MALLOC, NULL, NULL, 0), n);
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_GT(counts[i], 0);
+    if (i) ASSERT_GT(upper[i], upper[i - 1]);
+    total += counts[i];
+  }
+  ASSERT_EQ(total, 1000);
+
+  /* Percentiles are monotonic and bounded by the recorded extremes. */
+  mm_latency_t lat;
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_MALLOC, &lat), 1);
+  uint64_t prev = 0;
+  for (int q = 0; q <= 100; q += 5) {
+    uint64_t v = mm_latency_percentile(alloc, MM_OP_MALLOC, q / 100.0);
+    ASSERT_GE(v, prev);
+    ASSERT_GE(v, lat.min);
+    ASSERT_LE(v, lat.max);
+    prev = v;
+  }
+  ASSERT_EQ(mm_latency_percentile(alloc, MM_OP_MALLOC, 1.0), lat.max);
+
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_reset_and_bad_arguments(void) {
+  uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  (mm_free)(alloc, (mm_malloc)(alloc, 64));
+  mm_latency_t lat;
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_FREE, &lat), 1);
+  ASSERT_EQ(lat.count, 1);
+
+  mm_reset_latency(alloc);
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_FREE, &lat), 1);
+  ASSERT_EQ(lat.count, 0);
+  ASSERT_EQ(lat.max, 0);
+  ASSERT_EQ(mm_latency_percentile(alloc, MM_OP_FREE, 0.5), 0);
+  ASSERT_EQ(mm_get_latency_buckets(alloc, MM_OP_FREE, NULL, NULL, 0), 0);
+
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_COUNT, &lat), 0);
+  ASSERT_EQ(mm_get_latency(NULL, MM_OP_MALLOC, &lat), 0);
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_MALLOC, NULL), 0);
+
+  ASSERT_GT(mm_latency_tick_ns(), 0.0);
+  ASSERT_LT(mm_latency_tick_ns(), 1000.0);
+
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+#define LAT_THREADS 4
+#define LAT_OPS 5000
+
+static void* lat_worker(void* arg) {
+  tlsf_t alloc = (tlsf_t)arg;
+  for (int i = 0; i < LAT_OPS; i++) {
+    void* p = (mm_malloc)(alloc, 32 + (size_t)(i % 64) * 16);
+    (mm_free)(alloc, p);
+  }
+  return NULL;
+}
+
+static int test_thread_safe_instance_counts_all(void) {
+  static uint8_t backing[1024 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_THREAD_SAFE);
+  ASSERT_NOT_NULL(alloc);
+
+  pthread_t threads[LAT_THREADS];
+  for (int i = 0; i < LAT_THREADS; i++) ASSERT_EQ(pthread_create(&threads[i], NULL, lat_worker, alloc), 0);
+  for (int i = 0; i < LAT_THREADS; i++) pthread_join(threads[i], NULL);
+
+  mm_latency_t lat;
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_MALLOC, &lat), 1);
+  ASSERT_EQ(lat.count, LAT_THREADS * LAT_OPS);
+  ASSERT(check_summary_ordered(&lat));
+  ASSERT_EQ(mm_get_latency(alloc, MM_OP_FREE, &lat), 1);
+  ASSERT_EQ(lat.count, LAT_THREADS * LAT_OPS);
+
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Latency histograms");
+  RUN_TEST(test_counts_every_operation);
+  RUN_TEST(test_buckets_match_count);
+  RUN_TEST(test_reset_and_bad_arguments);
+  RUN_TEST(test_thread_safe_instance_counts_all);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -1,5 +1,8 @@
+#define _GNU_SOURCE
+
 #include "test_framework.h"
 #include "memoman_test_internal.h"
+#include <sys/mman.h>
 
 static int ref_fls_u32(unsigned int word) {
   if (!word) return -1;
@@ -103,11 +106,84 @@ static int test_automated_coverage(void) {
   return 1;
 }
 
+static int test_wide_sizes(void) {
+  /* Powers of two and their neighbours up to the block size limit (beyond 4 GiB with a raised MM_FL_INDEX_MAX). */
+  const size_t max = mm_block_size_max();
+  for (int bit = FL_INDEX_SHIFT; bit < FL_INDEX_MAX; bit++) {
+    const size_t base = (size_t)1 << bit;
+    const size_t sizes[] = {base - ALIGNMENT, base, base + ALIGNMENT, base + (base >> 1), base + (base - ALIGNMENT)};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      if (sizes[i] > max) continue;
+      if (!check_mapping_insert(sizes[i])) return 0;
+      if (!check_mapping_search(sizes[i])) return 0;
+    }
+  }
+  return 1;
+}
+
+static int test_indices_fit_bitmaps(void) {
+  ASSERT(FL_INDEX_COUNT <= MM_BITMAP_BITS);
+  ASSERT(SL_INDEX_COUNT <= MM_BITMAP_BITS);
+
+  /* The largest block lands in the top bucket, i.e. the highest bit of both bitmaps in use. */
+  int fl, sl;
+  mm_get_mapping_indices(mm_block_size_max(), &fl, &sl);
+  ASSERT_EQ(fl, FL_INDEX_COUNT - 1);
+  ASSERT_EQ(sl, SL_INDEX_COUNT - 1);
+  return 1;
+}
+
+static int test_multi_gib_pool(void) {
+#if SIZE_MAX > 0xffffffffu
+  /* Reserve without committing: the allocator only touches headers and the bytes written below. */
+  const int top = (FL_INDEX_MAX - 1 < 39) ? FL_INDEX_MAX - 1 : 39;
+  const size_t big = (FL_INDEX_MAX > 32) ? (size_t)1 << top : (size_t)3 << 30;
+  const size_t reserve = (FL_INDEX_MAX > 32) ? big + ((size_t)1 << 20) : (size_t)6 << 30;
+  void* mem = mmap(NULL, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mem == MAP_FAILED) {
+    printf("  cannot reserve %zu bytes, skipping\n", reserve);
+    return 1;
+  }
+
+  if (FL_INDEX_MAX <= 32) {
+    /* A pool larger than one block can describe is rejected rather than mis-bucketed. */
+    ASSERT_NULL(mm_create_with_pool(mem, reserve));
+  } else {
+    tlsf_t alloc = mm_create_with_pool(mem, reserve);
+    ASSERT_NOT_NULL(alloc);
+
+    int fl, sl;
+    mm_get_mapping_indices(big, &fl, &sl);
+    ASSERT_LT(fl, FL_INDEX_COUNT);
+
+    unsigned char* p = (mm_malloc)(alloc, big);
+    ASSERT_NOT_NULL(p);
+    p[0] = 0xA5;
+    p[big - 1] = 0x5A;
+    ASSERT_GE(mm_block_size(p), big);
+
+    void* small = (mm_malloc)(alloc, 64);
+    ASSERT_NOT_NULL(small);
+    ASSERT((mm_validate)(alloc));
+
+    (mm_free)(alloc, p);
+    (mm_free)(alloc, small);
+    ASSERT((mm_validate)(alloc));
+    (mm_destroy)(alloc);
+  }
+  munmap(mem, reserve);
+#endif
+  return 1;
+}
+
 int main(void) {
   TEST_SUITE_BEGIN("TLSF Mapping Parity");
   RUN_TEST(test_small_blocks);
   RUN_TEST(test_large_blocks);
   RUN_TEST(test_automated_coverage);
+  RUN_TEST(test_wide_sizes);
+  RUN_TEST(test_indices_fit_bitmaps);
+  RUN_TEST(test_multi_gib_pool);
   TEST_SUITE_END();
   TEST_MAIN_END();
 }
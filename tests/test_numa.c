@@ -0,0 +1,181 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include "../src/memoman_os.h"
+#include <pthread.h>
+#include <stdint.h>
+
+#define NODE_BYTES (256 * 1024)
+
+/* Fake topology: the "CPU" a thread runs on is whatever it last set. */
+static __thread int fake_node;
+
+static int fake_current_node(void* user) {
+  (void)user;
+  return fake_node;
+}
+
+static mm_numa_topology_t fake_topology(size_t nodes) {
+  mm_numa_topology_t topo;
+  memset(&topo, 0, sizeof(topo));
+  topo.node_count = nodes;
+  /* Node 0 exists everywhere; the others are unbound. */
+  topo.os_node[0] = 0;
+  for (size_t i = 1; i < nodes; i++) topo.os_node[i] = -1;
+  topo.current_node = fake_current_node;
+  return topo;
+}
+
+static int test_routes_by_current_node(void) {
+  mm_numa_topology_t topo = fake_topology(3);
+  mm_numa_heap_t* heap = mm_numa_heap_create(NODE_BYTES, 0, &topo);
+  ASSERT_NOT_NULL(heap);
+  ASSERT_EQ(mm_numa_node_count(heap), 3);
+  ASSERT_EQ(mm_numa_node_bound(heap, 1), 0);
+
+  void* p[3];
+  for (int n = 0; n < 3; n++) {
+    fake_node = n;
+    ASSERT_EQ(mm_numa_current_node(heap), n);
+    p[n] = mm_numa_malloc(heap, 100);
+    ASSERT_NOT_NULL(p[n]);
+    ASSERT_EQ(mm_numa_node_of(heap, p[n]), n);
+    tlsf_t owner = mm_numa_allocator(heap, (size_t)n);
+    ASSERT_EQ(mm_get_pool_for_ptr(owner, p[n]), mm_get_pool(owner));
+  }
+
+  /* Out-of-range answers from the topology fall back to node 0. */
+  fake_node = 7;
+  ASSERT_EQ(mm_numa_current_node(heap), 0);
+
+  /* Frees go to the owner whatever node the caller is on. */
+  fake_node = 2;
+  for (int n = 0; n < 3; n++) mm_numa_free(heap, p[n]);
+  for (size_t n = 0; n < 3; n++) ASSERT_EQ(bytes_in_use(mm_numa_allocator(heap, n)), 0);
+
+  static uint64_t foreign[4];
+  ASSERT_EQ(mm_numa_node_of(heap, foreign), -1);
+  mm_numa_free(heap, foreign);
+  mm_numa_free(heap, NULL);
+  mm_numa_heap_destroy(heap);
+  return 1;
+}
+
+typedef struct remote_free_t {
+  mm_numa_heap_t* heap;
+  void** ptrs;
+  int count;
+} remote_free_t;
+
+static void* free_on_node_one(void* arg) {
+  remote_free_t* job = (remote_free_t*)arg;
+  fake_node = 1;
+  for (int i = 0; i < job->count; i++) mm_numa_free(job->heap, job->ptrs[i]);
+  /* This thread's own allocations are local to node 1. */
+  void* mine = mm_numa_malloc(job->heap, 64);
+  int ok = mine && mm_numa_node_of(job->heap, mine) == 1;
+  mm_numa_free(job->heap, mine);
+  return ok ? job : NULL;
+}
+
+static int test_cross_thread_free_returns_to_owner(void) {
+  mm_numa_topology_t topo = fake_topology(2);
+  mm_numa_heap_t* heap = mm_numa_heap_create(NODE_BYTES, MM_FLAG_THREAD_SAFE, &topo);
+  ASSERT_NOT_NULL(heap);
+
+  fake_node = 0;
+  void* ptrs[200];
+  for (int i = 0; i < 200; i++) {
+    ptrs[i] = mm_numa_malloc(heap, 16 + (size_t)i * 8);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  ASSERT_GT(bytes_in_use(mm_numa_allocator(heap, 0)), 0);
+
+  remote_free_t job = {heap, ptrs, 200};
+  pthread_t t;
+  ASSERT_EQ(pthread_create(&t, NULL, free_on_node_one, &job), 0);
+  void* result = NULL;
+  ASSERT_EQ(pthread_join(t, &result), 0);
+  ASSERT_EQ(result, &job);
+
+  ASSERT_EQ(bytes_in_use(mm_numa_allocator(heap, 0)), 0);
+  ASSERT_EQ(bytes_in_use(mm_numa_allocator(heap, 1)), 0);
+  ASSERT((mm_validate)(mm_numa_allocator(heap, 0)));
+  ASSERT((mm_validate)(mm_numa_allocator(heap, 1)));
+  mm_numa_heap_destroy(heap);
+  return 1;
+}
+
+static int test_full_node_falls_back(void) {
+  mm_numa_topology_t topo = fake_topology(2);
+  mm_numa_heap_t* heap = mm_numa_heap_create(NODE_BYTES, 0, &topo);
+  ASSERT_NOT_NULL(heap);
+
+  /* Fill node 1; the next request spills over to node 0 instead of failing. */
+  fake_node = 1;
+  static void* fill[4096];
+  int n = 0;
+  for (void* p; (p = mm_numa_malloc_node(heap, 1, 1000)) != NULL && n < 4096;) fill[n++] = p;
+  ASSERT_GT(n, 100);
+  ASSERT_NULL(mm_numa_malloc_node(heap, 1, 1000));
+  char* spill = (char*)mm_numa_malloc(heap, 1000);
+  ASSERT_NOT_NULL(spill);
+  ASSERT_EQ(mm_numa_node_of(heap, spill), 0);
+
+  /* realloc grows on the owner, and moves to another node once the owner is full. */
+  memset(spill, 0x3C, 1000);
+  char* grown = (char*)mm_numa_realloc(heap, fill[0], 4000);
+  ASSERT_NOT_NULL(grown);
+  ASSERT_EQ(mm_numa_node_of(heap, grown), 0);
+  fill[0] = grown;
+  spill = (char*)mm_numa_realloc(heap, spill, 2000);
+  ASSERT_NOT_NULL(spill);
+  ASSERT_EQ(spill[999], 0x3C);
+  ASSERT_NULL(mm_numa_realloc(heap, spill, 0));
+
+  for (int i = 0; i < n; i++) mm_numa_free(heap, fill[i]);
+  ASSERT_EQ(bytes_in_use(mm_numa_allocator(heap, 0)), 0);
+  ASSERT_EQ(bytes_in_use(mm_numa_allocator(heap, 1)), 0);
+  ASSERT_NULL(mm_numa_malloc_node(heap, 2, 16));
+  ASSERT_NULL(mm_numa_allocator(heap, 2));
+  mm_numa_heap_destroy(heap);
+  return 1;
+}
+
+static int test_detected_topology(void) {
+  mm_numa_topology_t topo;
+  ASSERT(mm_numa_topology_detect(&topo));
+  ASSERT_GE(topo.node_count, 1);
+  ASSERT_LE(topo.node_count, MM_NUMA_MAX_NODES);
+  ASSERT_NULL(topo.current_node);
+
+  mm_numa_heap_t* heap = mm_numa_heap_create(NODE_BYTES, 0, NULL);
+  ASSERT_NOT_NULL(heap);
+  ASSERT_EQ(mm_numa_node_count(heap), topo.node_count);
+  int local = mm_numa_current_node(heap);
+  ASSERT_GE(local, 0);
+  void* p = mm_numa_malloc(heap, 256);
+  ASSERT_NOT_NULL(p);
+  ASSERT_EQ(mm_numa_node_of(heap, p), local);
+  mm_numa_free(heap, p);
+  mm_numa_heap_destroy(heap);
+
+  /* Topologies the front end cannot hold are refused. */
+  topo.node_count = 0;
+  ASSERT_NULL(mm_numa_heap_create(NODE_BYTES, 0, &topo));
+  topo.node_count = MM_NUMA_MAX_NODES + 1;
+  ASSERT_NULL(mm_numa_heap_create(NODE_BYTES, 0, &topo));
+  /* So are slab heaps, whose slots have no header for mm_numa_realloc to size the copy from. */
+  topo.node_count = 1;
+  ASSERT_NULL(mm_numa_heap_create(NODE_BYTES, MM_FLAG_SLAB, &topo));
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("NUMA multi-heap");
+  RUN_TEST(test_routes_by_current_node);
+  RUN_TEST(test_cross_thread_free_returns_to_owner);
+  RUN_TEST(test_full_node_falls_back);
+  RUN_TEST(test_detected_topology);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -0,0 +1,123 @@
+#include "test_framework.h"
+#include "../src/memoman_os.h"
+#include <stdint.h>
+
+#define OS_HEAP_INITIAL (64 * 1024)
+
+static int test_os_heap_grows_on_demand(void) {
+  mm_os_heap_t* heap = mm_os_heap_create(OS_HEAP_INITIAL, 0);
+  ASSERT_NOT_NULL(heap);
+  ASSERT_EQ(mm_os_heap_region_count(heap), 1);
+
+  /* Larger than the first region: must map a new one. */
+  void* big = mm_os_malloc(heap, 256 * 1024);
+  ASSERT_NOT_NULL(big);
+  memset(big, 0xAB, 256 * 1024);
+  ASSERT_EQ(mm_os_heap_region_count(heap), 2);
+
+  void* small[64];
+  for (int i = 0; i < 64; i++) {
+    small[i] = mm_os_malloc(heap, 4000);
+    ASSERT_NOT_NULL(small[i]);
+  }
+  void* aligned = mm_os_memalign(heap, 4096, 100000);
+  ASSERT_NOT_NULL(aligned);
+  ASSERT_EQ((uintptr_t)aligned % 4096, 0);
+  ASSERT((mm_validate)(mm_os_heap_allocator(heap)));
+
+  for (int i = 0; i < 64; i++) mm_os_free(heap, small[i]);
+  mm_os_free(heap, aligned);
+  mm_os_free(heap, big);
+  ASSERT((mm_validate)(mm_os_heap_allocator(heap)));
+  mm_os_heap_destroy(heap);
+  return 1;
+}
+
+static int test_os_heap_keeps_one_spare(void) {
+  mm_os_heap_t* heap = mm_os_heap_create(OS_HEAP_INITIAL, 0);
+  ASSERT_NOT_NULL(heap);
+
+  /* Each request is too big for any existing region, so every one maps its own. */
+  void* a = mm_os_malloc(heap, 200 * 1024);
+  void* b = mm_os_malloc(heap, 600 * 1024);
+  void* c = mm_os_malloc(heap, 2 * 1024 * 1024);
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+  ASSERT_NOT_NULL(c);
+  ASSERT_EQ(mm_os_heap_region_count(heap), 4);
+
+  /* The first empty region stays mapped as the spare. */
+  mm_os_free(heap, a);
+  ASSERT_EQ(mm_os_heap_region_count(heap), 4);
+
+  /* A second one replaces it; the older spare goes back to the OS. */
+  mm_os_free(heap, b);
+  ASSERT_EQ(mm_os_heap_region_count(heap), 3);
+  ASSERT((mm_validate)(mm_os_heap_allocator(heap)));
+
+  /* The spare is reused before anything new is mapped. */
+  void* again = mm_os_malloc(heap, 500 * 1024);
+  ASSERT_NOT_NULL(again);
+  ASSERT_EQ(mm_os_heap_region_count(heap), 3);
+  mm_os_free(heap, again);
+
+  mm_os_free(heap, c);
+  size_t before = mm_os_heap_mapped_bytes(heap);
+  size_t released = mm_os_heap_trim(heap);
+  ASSERT_GT(released, 0);
+  ASSERT_EQ(mm_os_heap_region_count(heap), 1);
+  ASSERT_EQ(mm_os_heap_mapped_bytes(heap), before - released);
+  ASSERT((mm_validate)(mm_os_heap_allocator(heap)));
+  ASSERT_EQ((mm_reset)(mm_os_heap_allocator(heap)), 1);
+
+  mm_os_heap_destroy(heap);
+  return 1;
+}
+
+static int test_os_heap_realloc_grows(void) {
+  mm_os_heap_t* heap = mm_os_heap_create(OS_HEAP_INITIAL, MM_FLAG_THREAD_SAFE);
+  ASSERT_NOT_NULL(heap);
+
+  unsigned char* p = mm_os_realloc(heap, NULL, 1000);
+  ASSERT_NOT_NULL(p);
+  for (int i = 0; i < 1000; i++) p[i] = (unsigned char)i;
+
+  p = mm_os_realloc(heap, p, 1024 * 1024);
+  ASSERT_NOT_NULL(p);
+  for (int i = 0; i < 1000; i++) ASSERT_EQ(p[i], (unsigned char)i);
+  ASSERT_GE(mm_os_heap_region_count(heap), 2);
+
+  mm_os_free(heap, p);
+  ASSERT((mm_validate)(mm_os_heap_allocator(heap)));
+  mm_os_heap_destroy(heap);
+  return 1;
+}
+
+static int test_os_heap_growth_covers_fit_rounding(void) {
+  mm_os_heap_t* heap = mm_os_heap_create(OS_HEAP_INITIAL, 0);
+  ASSERT_NOT_NULL(heap);
+
+  /* Each size rounds up by a whole class at coarse geometries; it must fit the one region mapped for it. */
+  static const size_t sizes[] = {3158073, 15728632};
+  size_t regions = mm_os_heap_region_count(heap);
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    ASSERT_LT(mm_fit_slack(sizes[i]), sizes[i] >> 1);
+    void* p = mm_os_malloc(heap, sizes[i]);
+    ASSERT_NOT_NULL(p);
+    ASSERT_EQ(mm_os_heap_region_count(heap), ++regions);
+    memset(p, 0x3C, sizes[i]);
+  }
+  ASSERT((mm_validate)(mm_os_heap_allocator(heap)));
+  mm_os_heap_destroy(heap);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("OS-backed heap");
+  RUN_TEST(test_os_heap_grows_on_demand);
+  RUN_TEST(test_os_heap_keeps_one_spare);
+  RUN_TEST(test_os_heap_realloc_grows);
+  RUN_TEST(test_os_heap_growth_covers_fit_rounding);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
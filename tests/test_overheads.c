@@ -13,7 +13,8 @@ static int test_sizing_constants(void) {
   ASSERT(mm_block_size_max() < ((size_t)1 << FL_INDEX_MAX));
   ASSERT(mm_block_size_max() >= mm_block_size_min());
 
-  ASSERT_EQ(mm_size(), sizeof(struct mm_allocator_t));
+  ASSERT_EQ(mm_size(), MM_CONTROL_BYTES);
+  ASSERT_EQ(mm_size() % 16, 0);
   return 1;
 }
 
@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include "../src/memoman_os.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define HEAP_BYTES (1024 * 1024)
+#define NODES 500
+
+/* Persisted objects link to each other by offsets from the allocator. */
+typedef struct node_t {
+  size_t next;
+  int value;
+  char payload[40];
+} node_t;
+
+static void heap_path(char* out, size_t n, const char* tag) {
+  snprintf(out, n, "/tmp/mm_test_%s_%ld.heap", tag, (long)getpid());
+}
+
+/* The file is mapped from its first byte, and the allocator sits in the first page of the mapping. */
+static char* mapping_base(tlsf_t alloc) {
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  return (char*)((uintptr_t)alloc & ~(page - 1));
+}
+
+/* Block headers start with the size word, padded to the alignment. */
+static size_t header_bytes(void) {
+  return mm_align_size() > sizeof(size_t) ? mm_align_size() : sizeof(size_t);
+}
+
+static int test_reopen_keeps_live_blocks(void) {
+  char path[64];
+  heap_path(path, sizeof(path), "reopen");
+  unlink(path);
+  tlsf_t alloc = mm_file_heap_open(path, HEAP_BYTES, 0);
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_NULL(mm_get_root(alloc));
+
+  /* A list built back to front; the root slot holds its head. */
+  size_t next = 0;
+  node_t* head = NULL;
+  for (int i = NODES - 1; i >= 0; i--) {
+    head = (node_t*)(mm_malloc)(alloc, sizeof(node_t));
+    ASSERT_NOT_NULL(head);
+    head->next = next;
+    head->value = i;
+    snprintf(head->payload, sizeof(head->payload), "node %d", i);
+    next = (size_t)((char*)head - (char*)alloc);
+  }
+  mm_set_root(alloc, head);
+  ASSERT_EQ(mm_get_root(alloc), head);
+  size_t in_use = bytes_in_use(alloc);
+  ASSERT_EQ(mm_file_heap_sync(alloc), 1);
+  char* old_base = mapping_base(alloc);
+  mm_file_heap_close(alloc);
+
+  /* Keep the old address busy so the heap has to come back somewhere else. */
+  void* blocker = mmap(old_base, 4096, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT(blocker != MAP_FAILED);
+  alloc = mm_file_heap_open(path, 0, 0);
+  munmap(blocker, 4096);
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_NE(mapping_base(alloc), old_base);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(bytes_in_use(alloc), in_use);
+
+  node_t* walk = (node_t*)mm_get_root(alloc);
+  ASSERT_NOT_NULL(walk);
+  ASSERT((char*)walk > (char*)alloc);
+  for (int i = 0; i < NODES; i++) {
+    char expect[40];
+    snprintf(expect, sizeof(expect), "node %d", i);
+    ASSERT_NOT_NULL(walk);
+    ASSERT_EQ(walk->value, i);
+    ASSERT_EQ(strcmp(walk->payload, expect), 0);
+    ASSERT_EQ((mm_block_size)(walk), (mm_block_size)(mm_get_root(alloc)));
+    node_t* done = walk;
+    walk = walk->next ? (node_t*)((char*)alloc + walk->next) : NULL;
+    if (i % 2) (mm_free)(alloc, done);
+  }
+  ASSERT_NULL(walk);
+
+  /* The reopened heap keeps allocating and merging around the survivors. */
+  void* big = (mm_malloc)(alloc, 64 * 1024);
+  ASSERT_NOT_NULL(big);
+  (mm_free)(alloc, big);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_LT(bytes_in_use(alloc), in_use);
+  mm_file_heap_close(alloc);
+  ASSERT_EQ(unlink(path), 0);
+  return 1;
+}
+
+static int test_attach_checks_layout(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  static uint8_t moved[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_THREAD_SAFE);
+  ASSERT_NOT_NULL(alloc);
+  char* p = (char*)(mm_malloc)(alloc, 200);
+  ASSERT_NOT_NULL(p);
+  strcpy(p, "persisted");
+  mm_set_root(alloc, p);
+  size_t off = (size_t)(p - (char*)backing);
+
+  memcpy(moved, backing, sizeof(backing));
+  tlsf_t copy = mm_attach(moved, sizeof(moved));
+  ASSERT_EQ(copy, (tlsf_t)moved);
+  ASSERT_EQ(mm_get_root(copy), moved + off);
+  ASSERT_EQ(strcmp((char*)mm_get_root(copy), "persisted"), 0);
+  (mm_free)(copy, mm_get_root(copy));
+  mm_set_root(copy, NULL);
+  ASSERT_EQ(bytes_in_use(copy), 0);
+  (mm_destroy)(copy);
+
+  /* Too small to hold the pool, misaligned, foreign bytes, a broken block header: all refused. */
+  memcpy(moved, backing, sizeof(backing));
+  ASSERT_NULL(mm_attach(moved, sizeof(moved) / 2));
+  ASSERT_NULL(mm_attach(moved + 1, sizeof(moved) - 1));
+  ASSERT_NULL(mm_attach(NULL, sizeof(moved)));
+  *(size_t*)(void*)(moved + off - header_bytes()) ^= 0x40;
+  ASSERT_NULL(mm_attach(moved, sizeof(moved)));
+  memset(moved, 0x5A, sizeof(moved));
+  ASSERT_NULL(mm_attach(moved, sizeof(moved)));
+
+  /* The original stays intact. */
+  ASSERT((mm_validate)(alloc));
+  (mm_free)(alloc, p);
+  (mm_destroy)(alloc);
+
+  /* Slab pointers are absolute, so slab heaps cannot be attached. */
+  alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_NULL(mm_attach(backing, sizeof(backing)));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_attach_rejects_stray_free_link(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  static uint8_t moved[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), 0);
+  ASSERT_NOT_NULL(alloc);
+
+  /* Two free blocks of one class, kept apart by used guards; the later free heads the list. */
+  char* x1 = (char*)(mm_malloc)(alloc, 200);
+  char* g1 = (char*)(mm_malloc)(alloc, 200);
+  char* x2 = (char*)(mm_malloc)(alloc, 200);
+  char* used = (char*)(mm_malloc)(alloc, 200);
+  ASSERT_NOT_NULL(x1);
+  ASSERT_NOT_NULL(g1);
+  ASSERT_NOT_NULL(x2);
+  ASSERT_NOT_NULL(used);
+  (mm_free)(alloc, x1);
+  (mm_free)(alloc, x2);
+  memcpy(moved, backing, sizeof(backing));
+  tlsf_t copy = mm_attach(moved, sizeof(moved));
+  ASSERT_NOT_NULL(copy);
+  (mm_destroy)(copy);
+
+  /*
+  ** Point x2's next link into the middle of a used block whose bytes pass the per-node checks but carry a size
+  ** word far past the pool. Links are self-relative in this build (first payload words: next, then prev).
+  */
+  memcpy(moved, backing, sizeof(backing));
+  char* fake = (char*)moved + (used - (char*)backing) + 64;
+  char* x2_block = (char*)moved + (x2 - (char*)backing) - header_bytes();
+  *(size_t*)(void*)fake = ((SIZE_MAX >> 2) & ~(size_t)0xF) | 1u;
+  intptr_t* fake_prev = (intptr_t*)(void*)(fake + header_bytes() + sizeof(intptr_t));
+  *fake_prev = (intptr_t)(x2_block - (char*)fake_prev);
+  intptr_t* x2_next = (intptr_t*)(void*)(x2_block + header_bytes());
+  *x2_next = (intptr_t)(fake - (char*)x2_next);
+  ASSERT_NULL(mm_attach(moved, sizeof(moved)));
+  return 1;
+}
+
+static int test_attach_in_place_keeps_registry(void) {
+  static uint8_t first[64 * 1024] __attribute__((aligned(16)));
+  static uint8_t second[64 * 1024] __attribute__((aligned(16)));
+  static uint8_t foreign[4096] __attribute__((aligned(16)));
+  tlsf_t a = mm_create_with_pool(first, sizeof(first));
+  tlsf_t b = mm_create_with_pool(second, sizeof(second));
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+
+  /* `a` is still registered and no longer the list head; reattaching it must not cut `b` off or loop. */
+  ASSERT_EQ(mm_attach(first, sizeof(first)), a);
+  ASSERT_EQ(mm_validate_pool(mm_get_pool(a)), 1);
+  ASSERT_EQ(mm_validate_pool(mm_get_pool(b)), 1);
+  ASSERT_EQ(mm_validate_pool((pool_t)foreign), 0);
+  void* p = (mm_malloc)(a, 100);
+  ASSERT_EQ(mm_get_pool_for_ptr(a, p), mm_get_pool(a));
+  (mm_free)(a, p);
+
+  (mm_destroy)(a);
+  (mm_destroy)(b);
+  ASSERT_EQ(mm_validate_pool((pool_t)foreign), 0);
+  return 1;
+}
+
+static int test_rejects_foreign_files(void) {
+  char path[64];
+  heap_path(path, sizeof(path), "foreign");
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  ASSERT_GE(fd, 0);
+  static char junk[64 * 1024];
+  memset(junk, 'x', sizeof(junk));
+  ASSERT_EQ(write(fd, junk, sizeof(junk)), (ssize_t)sizeof(junk));
+  close(fd);
+
+  /* A file that is not a heap is neither opened nor overwritten. */
+  ASSERT_NULL(mm_file_heap_open(path, HEAP_BYTES, 0));
+  fd = open(path, O_RDONLY);
+  ASSERT_GE(fd, 0);
+  char first = 0;
+  ASSERT_EQ(read(fd, &first, 1), 1);
+  ASSERT_EQ(lseek(fd, 0, SEEK_END), (off_t)sizeof(junk));
+  close(fd);
+  ASSERT_EQ(first, 'x');
+  ASSERT_EQ(unlink(path), 0);
+
+  /* A block header damaged on disk fails validation on open. */
+  heap_path(path, sizeof(path), "damaged");
+  unlink(path);
+  tlsf_t alloc = mm_file_heap_open(path, HEAP_BYTES, 0);
+  ASSERT_NOT_NULL(alloc);
+  char* p = (char*)(mm_malloc)(alloc, 1000);
+  ASSERT_NOT_NULL(p);
+  off_t size_word = (off_t)(p - mapping_base(alloc)) - (off_t)header_bytes();
+  size_t in_use = bytes_in_use(alloc);
+  mm_file_heap_close(alloc);
+  alloc = mm_file_heap_open(path, 0, 0);
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_EQ(bytes_in_use(alloc), in_use);
+  mm_file_heap_close(alloc);
+
+  fd = open(path, O_RDWR);
+  ASSERT_GE(fd, 0);
+  size_t header = 0;
+  ASSERT_EQ(pread(fd, &header, sizeof(header), size_word), (ssize_t)sizeof(header));
+  header += 4096;
+  ASSERT_EQ(pwrite(fd, &header, sizeof(header), size_word), (ssize_t)sizeof(header));
+  close(fd);
+  ASSERT_NULL(mm_file_heap_open(path, 0, 0));
+  ASSERT_EQ(unlink(path), 0);
+  ASSERT_NULL(mm_file_heap_open(NULL, HEAP_BYTES, 0));
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Persistent heaps");
+  RUN_TEST(test_reopen_keeps_live_blocks);
+  RUN_TEST(test_attach_checks_layout);
+  RUN_TEST(test_attach_rejects_stray_free_link);
+  RUN_TEST(test_attach_in_place_keeps_registry);
+  RUN_TEST(test_rejects_foreign_files);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
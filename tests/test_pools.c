@@ -7,10 +7,10 @@ static inline size_t block_size(const tlsf_block_t* block) { return block->size
 static inline int block_is_prev_free(const tlsf_block_t* block) { return (block->size & TLSF_PREV_FREE) != 0; }
 
 static int test_allocation_across_pools(void) {
-  /* Pool 1: ~12KB. 
-   * mm_size() is ~8KB, leaving ~4KB for allocation. */
-  uint8_t pool1[12288] __attribute__((aligned(8)));
-  tlsf_t alloc = mm_create_with_pool(pool1, sizeof(pool1));
+  /* Pool 1: the control block plus ~4KB for allocation (mm_size() depends on the build geometry). */
+  uint8_t pool1[32768] __attribute__((aligned(16)));
+  ASSERT_LE(mm_size() + 4096, sizeof(pool1));
+  tlsf_t alloc = mm_create_with_pool(pool1, mm_size() + 4096);
   
   /* Fill Pool 1 */
   void* p1 = (mm_malloc)(alloc, 3000);
@@ -21,7 +21,7 @@ static int test_allocation_across_pools(void) {
   ASSERT_NULL(p2);
 
   /* Add Pool 2: 8KB */
-  uint8_t pool2[8192] __attribute__((aligned(8)));
+  uint8_t pool2[8192] __attribute__((aligned(16)));
   ASSERT_NOT_NULL(mm_add_pool(alloc, pool2, sizeof(pool2)));
 
   /* Now alloc should succeed (from Pool 2) */
@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+
+#include "test_framework.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef MM_PRELOAD_LIB
+#define MM_PRELOAD_LIB "libmemoman.so"
+#endif
+
+#define CHILD_ARG "--preload-child"
+#define SORT_LINES 20000
+
+/* Runs argv[0] with LD_PRELOAD set, stdin/stdout redirected to the given files (NULL keeps the parent's). */
+static int run_preloaded(char* const argv[], const char* in_path, const char* out_path) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    if (in_path && !freopen(in_path, "r", stdin)) _exit(126);
+    if (out_path && !freopen(out_path, "w", stdout)) _exit(126);
+    setenv("LD_PRELOAD", MM_PRELOAD_LIB, 1);
+    execv(argv[0], argv);
+    _exit(127);
+  }
+  int status = 0;
+  if (waitpid(pid, &status, 0) != pid) return -1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/* --- Child side: executed under LD_PRELOAD, exit status 0 means every check held. --- */
+
+static void* child_thread(void* arg) {
+  unsigned int seed = (unsigned int)(uintptr_t)arg;
+  void* live[64] = {0};
+  for (int i = 0; i < 20000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int slot = (int)((seed >> 16) % 64);
+    free(live[slot]);
+    size_t size = 1 + (seed >> 8) % 2048;
+    live[slot] = malloc(size);
+    if (!live[slot] || ((uintptr_t)live[slot] & 15) != 0) return (void*)1;
+    memset(live[slot], (int)slot, size);
+  }
+  for (int i = 0; i < 64; i++) free(live[i]);
+  return NULL;
+}
+
+static int child_main(void) {
+  /* malloc must resolve into the interposer, not libc. */
+  Dl_info info;
+  if (!dladdr((void*)(uintptr_t)&malloc, &info) || !info.dli_fname || !strstr(info.dli_fname, "libmemoman")) return 2;
+
+  unsigned char* p = malloc(100);
+  if (!p || ((uintptr_t)p & 15) != 0 || malloc_usable_size(p) < 100) return 3;
+  memset(p, 0x7E, 100);
+  p = realloc(p, 100000);
+  if (!p || p[0] != 0x7E || p[99] != 0x7E || ((uintptr_t)p & 15) != 0) return 4;
+  free(p);
+
+  unsigned char* z = calloc(1000, 8);
+  if (!z) return 5;
+  for (int i = 0; i < 8000; i++) {
+    if (z[i]) return 5;
+  }
+  free(z);
+  volatile size_t huge = SIZE_MAX / 2;
+  errno = 0;
+  if (calloc(huge, 4) != NULL || errno != ENOMEM) return 5;
+
+  void* a = NULL;
+  if (posix_memalign(&a, 4096, 5000) != 0 || ((uintptr_t)a & 4095) != 0) return 6;
+  if (posix_memalign(&a, 3, 16) != EINVAL) return 6;
+  void* b = aligned_alloc(256, 512);
+  void* c = memalign(64, 1);
+  if (!b || ((uintptr_t)b & 255) != 0 || !c || ((uintptr_t)c & 63) != 0) return 6;
+  free(b);
+  free(c);
+
+  void* zero = malloc(0);
+  if (!zero) return 7;
+  free(zero);
+  free(NULL);
+
+  /* Larger than the initial region: the backend maps more. */
+  char* big = malloc((size_t)64 << 20);
+  if (!big) return 8;
+  memset(big, 1, (size_t)64 << 20);
+  free(big);
+
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++) {
+    if (pthread_create(&threads[i], NULL, child_thread, (void*)(uintptr_t)(i + 1)) != 0) return 9;
+  }
+  for (int i = 0; i < 4; i++) {
+    void* ret = NULL;
+    pthread_join(threads[i], &ret);
+    if (ret) return 9;
+  }
+  return 0;
+}
+
+/* --- Parent side. --- */
+
+static int test_preload_api_under_interposer(void) {
+  char self[4096];
+  ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  ASSERT_GT(n, 0);
+  self[n] = '\0';
+  char* argv[] = {self, CHILD_ARG, NULL};
+  ASSERT_EQ(run_preloaded(argv, NULL, NULL), 0);
+  return 1;
+}
+
+static int test_preload_runs_unmodified_sort(void) {
+  const char* sort_path = access("/usr/bin/sort", X_OK) == 0 ? "/usr/bin/sort" : "/bin/sort";
+  if (access(sort_path, X_OK) != 0) {
+    printf("  sort not found, skipping\n");
+    return 1;
+  }
+
+  char in_path[] = "/tmp/mm_preload_inXXXXXX";
+  char out_path[] = "/tmp/mm_preload_outXXXXXX";
+  int in_fd = mkstemp(in_path);
+  int out_fd = mkstemp(out_path);
+  ASSERT_GE(in_fd, 0);
+  ASSERT_GE(out_fd, 0);
+  close(out_fd);
+
+  /* Lines i * 7919 mod SORT_LINES are a permutation of 0..SORT_LINES-1. */
+  FILE* in = fdopen(in_fd, "w");
+  ASSERT_NOT_NULL(in);
+  for (int i = 0; i < SORT_LINES; i++) fprintf(in, "%08d\n", (int)(((long)i * 7919) % SORT_LINES));
+  fclose(in);
+
+  char* argv[] = {(char*)sort_path, NULL};
+  int rc = run_preloaded(argv, in_path, out_path);
+
+  FILE* out = fopen(out_path, "r");
+  ASSERT_NOT_NULL(out);
+  int expected = 0;
+  int value = 0;
+  while (fscanf(out, "%d", &value) == 1) {
+    if (value != expected) break;
+    expected++;
+  }
+  fclose(out);
+  unlink(in_path);
+  unlink(out_path);
+
+  ASSERT_EQ(rc, 0);
+  ASSERT_EQ(expected, SORT_LINES);
+  return 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], CHILD_ARG) == 0) return child_main();
+
+  TEST_SUITE_BEGIN("LD_PRELOAD Interposer");
+  RUN_TEST(test_preload_api_under_interposer);
+  RUN_TEST(test_preload_runs_unmodified_sort);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
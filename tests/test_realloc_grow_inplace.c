@@ -212,6 +212,107 @@ static int grow_next_block_too_small(void) {
   return 1;
 }
 
+/* === Grow Backward Into Previous Block === */
+
+static int grow_into_previous_block(void) {
+  mm_reset_allocator();
+
+  void* prev = mm_malloc(512);
+  void* ptr = mm_malloc(128);
+  void* guard = mm_malloc(64);
+  ASSERT_NOT_NULL(prev);
+  ASSERT_NOT_NULL(ptr);
+  ASSERT_NOT_NULL(guard);
+
+  for (int i = 0; i < 128; i++) ((unsigned char*)ptr)[i] = (unsigned char)(i * 7);
+  mm_free(prev);
+
+  /* Next block is used, previous is free and large enough: payload slides down into it. */
+  void* new_ptr = mm_realloc(ptr, 400);
+  ASSERT_EQ(new_ptr, prev);
+  for (int i = 0; i < 128; i++) ASSERT_EQ(((unsigned char*)new_ptr)[i], (unsigned char)(i * 7));
+  ASSERT(mm_validate());
+
+  mm_free(new_ptr);
+  mm_free(guard);
+  ASSERT(mm_validate());
+  return 1;
+}
+
+static int grow_into_both_neighbors(void) {
+  mm_reset_allocator();
+
+  void* prev = mm_malloc(256);
+  void* ptr = mm_malloc(256);
+  void* next = mm_malloc(256);
+  void* guard = mm_malloc(64);
+  ASSERT_NOT_NULL(guard);
+
+  for (int i = 0; i < 256; i++) ((unsigned char*)ptr)[i] = (unsigned char)(255 - i);
+  mm_free(prev);
+  mm_free(next);
+
+  /* Neither neighbour alone fits 700 bytes; together they do. */
+  void* new_ptr = mm_realloc(ptr, 700);
+  ASSERT_EQ(new_ptr, prev);
+  for (int i = 0; i < 256; i++) ASSERT_EQ(((unsigned char*)new_ptr)[i], (unsigned char)(255 - i));
+  ASSERT(mm_validate());
+
+  mm_free(new_ptr);
+  mm_free(guard);
+  ASSERT(mm_validate());
+  return 1;
+}
+
+static int grow_backward_splits_excess(void) {
+  mm_reset_allocator();
+
+  void* prev = mm_malloc(4096);
+  void* ptr = mm_malloc(128);
+  void* guard = mm_malloc(64);
+  ASSERT_NOT_NULL(guard);
+  memset(ptr, 0x3C, 128);
+  mm_free(prev);
+
+  void* new_ptr = mm_realloc(ptr, 256);
+  ASSERT_EQ(new_ptr, prev);
+  ASSERT_EQ(((unsigned char*)new_ptr)[127], 0x3C);
+
+  /* The unused tail of the merged block is handed back as one free block before `guard`. */
+  tlsf_block_t* used = (tlsf_block_t*)((char*)new_ptr - BLOCK_START_OFFSET);
+  size_t used_size = used->size & TLSF_SIZE_MASK;
+  ASSERT_LT(used_size, 512);
+  tlsf_block_t* tail = (tlsf_block_t*)((char*)used + BLOCK_HEADER_OVERHEAD + used_size);
+  ASSERT(tail->size & TLSF_BLOCK_FREE);
+  ASSERT_EQ((char*)tail + BLOCK_HEADER_OVERHEAD + (tail->size & TLSF_SIZE_MASK) + BLOCK_START_OFFSET, (char*)guard);
+  ASSERT(mm_validate());
+
+  mm_free(new_ptr);
+  mm_free(guard);
+  return 1;
+}
+
+static int grow_backward_too_small_moves(void) {
+  mm_reset_allocator();
+
+  void* prev = mm_malloc(64);
+  void* ptr = mm_malloc(128);
+  void* guard = mm_malloc(64);
+  ASSERT_NOT_NULL(guard);
+  mm_free(prev);
+
+  /* Previous block cannot hold the request: fall back to a fresh block elsewhere. */
+  void* new_ptr = mm_realloc(ptr, 2048);
+  ASSERT_NOT_NULL(new_ptr);
+  ASSERT_NE(new_ptr, prev);
+  ASSERT_NE(new_ptr, ptr);
+  ASSERT(mm_validate());
+
+  mm_free(new_ptr);
+  mm_free(guard);
+  return 1;
+}
+
 /* === Edge Cases === */
 
 static int grow_coalesces_multiple_free_blocks(void) {
@@ -342,6 +443,12 @@ int main(void) {
   RUN_TEST(grow_next_block_used);
   RUN_TEST(grow_next_block_too_small);
 
+  TEST_SECTION("Grow Backward");
+  RUN_TEST(grow_into_previous_block);
+  RUN_TEST(grow_into_both_neighbors);
+  RUN_TEST(grow_backward_splits_excess);
+  RUN_TEST(grow_backward_too_small_moves);
+
   TEST_SECTION("Edge Cases");
   RUN_TEST(grow_coalesces_multiple_free_blocks);
   RUN_TEST(grow_same_size_returns_same_pointer);
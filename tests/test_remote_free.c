@@ -0,0 +1,252 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+typedef struct free_job_t {
+  tlsf_t alloc;
+  void** ptrs;
+  size_t count;
+} free_job_t;
+
+static void* free_all(void* arg) {
+  free_job_t* job = (free_job_t*)arg;
+  for (size_t i = 0; i < job->count; i++) (mm_free)(job->alloc, job->ptrs[i]);
+  return NULL;
+}
+
+static int free_on_other_thread(tlsf_t alloc, void** ptrs, size_t count) {
+  free_job_t job = {alloc, ptrs, count};
+  pthread_t t;
+  if (pthread_create(&t, NULL, free_all, &job) != 0) return 0;
+  return pthread_join(t, NULL) == 0;
+}
+
+static int test_remote_frees_are_drained_in_bulk(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_REMOTE_FREE);
+  ASSERT_NOT_NULL(alloc);
+
+  void* ptrs[100];
+  for (int i = 0; i < 100; i++) {
+    ptrs[i] = (mm_malloc)(alloc, 2000);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  size_t in_use = bytes_in_use(alloc);
+  ASSERT(free_on_other_thread(alloc, ptrs, 100));
+
+  /* Queued, not freed: the heap is unchanged and still consistent. */
+  ASSERT_EQ(bytes_in_use(alloc), in_use);
+  ASSERT((mm_validate)(alloc));
+
+  /* A request that only fits in the queued memory drains the queue instead of failing; the run merged back. */
+  void* big = (mm_malloc)(alloc, 150 * 1024);
+  ASSERT_NOT_NULL(big);
+  ASSERT_EQ(big, ptrs[0]);
+  ASSERT_EQ(bytes_in_use(alloc), (mm_block_size)(big));
+  (mm_free)(alloc, big);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 0);
+
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.free_count, 101);
+
+  /* Small allocations drain periodically without any failure. */
+  for (int i = 0; i < 10; i++) ptrs[i] = (mm_malloc)(alloc, 64);
+  ASSERT(free_on_other_thread(alloc, ptrs, 10));
+  for (int i = 0; i < 200 && bytes_in_use(alloc) != 0; i++) (mm_free)(alloc, (mm_malloc)(alloc, 64));
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static void* take_ownership(void* alloc) {
+  mm_set_owner_thread((tlsf_t)alloc);
+  return NULL;
+}
+
+static int test_owner_and_explicit_drain(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_REMOTE_FREE);
+  ASSERT_NOT_NULL(alloc);
+
+  /* The owner's own frees take effect at once. */
+  void* p = (mm_malloc)(alloc, 500);
+  ASSERT_NOT_NULL(p);
+  (mm_free)(alloc, p);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+
+  void* ptrs[10];
+  for (int i = 0; i < 10; i++) ptrs[i] = (mm_malloc)(alloc, 128);
+  ASSERT(free_on_other_thread(alloc, ptrs, 10));
+  ASSERT_GT(bytes_in_use(alloc), 0);
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 10);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+
+  /* Handing ownership away makes this thread's frees remote; reset drains whatever is queued. */
+  for (int i = 0; i < 10; i++) ptrs[i] = (mm_malloc)(alloc, 128);
+  pthread_t t;
+  ASSERT_EQ(pthread_create(&t, NULL, take_ownership, alloc), 0);
+  ASSERT_EQ(pthread_join(t, NULL), 0);
+  for (int i = 0; i < 10; i++) (mm_free)(alloc, ptrs[i]);
+  ASSERT_GT(bytes_in_use(alloc), 0);
+  ASSERT_EQ(mm_reset(alloc), 1);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 0);
+
+  /* Without the flag there is nothing to drain, and shared heaps cannot take remote frees. */
+  tlsf_t plain = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(plain);
+  ASSERT_EQ(mm_drain_remote_frees(plain), 0);
+  ASSERT_NULL(mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_REMOTE_FREE | MM_FLAG_SHARED));
+  return 1;
+}
+
+/* MM_DEBUG builds abort on a double remote free unless told otherwise. */
+#if !defined(MM_DEBUG) || (defined(MM_DEBUG_ABORT_ON_REMOTE_CYCLE) && !MM_DEBUG_ABORT_ON_REMOTE_CYCLE)
+static int test_double_remote_free_is_dropped(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_REMOTE_FREE);
+  ASSERT_NOT_NULL(alloc);
+
+  /* A pointer pushed twice while queued links the stack into a cycle; the drain must still end. */
+  void* a = (mm_malloc)(alloc, 100);
+  void* b = (mm_malloc)(alloc, 100);
+  void* c = (mm_malloc)(alloc, 100);
+  void* twice[] = {a, b, a};
+  ASSERT(free_on_other_thread(alloc, twice, 3));
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 2);
+  void* self[] = {c, c};
+  ASSERT(free_on_other_thread(alloc, self, 2));
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 1);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  ASSERT((mm_validate)(alloc));
+
+  /* The second push of `p` overwrote its link to `x`: `x` is leaked, and validation cannot tell. */
+  void* x = (mm_malloc)(alloc, 100);
+  void* p = (mm_malloc)(alloc, 100);
+  void* q = (mm_malloc)(alloc, 100);
+  void* buried[] = {x, p, q, p};
+  ASSERT(free_on_other_thread(alloc, buried, 4));
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 2);
+  ASSERT_EQ(bytes_in_use(alloc), (mm_block_size)(x));
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 0);
+  ASSERT_EQ(bytes_in_use(alloc), (mm_block_size)(x));
+  ASSERT((mm_validate)(alloc));
+  return 1;
+}
+#endif
+
+static int test_tcache_refill_drains_before_failing(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  static void* cache_mem[1024];
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_REMOTE_FREE);
+  ASSERT_NOT_NULL(alloc);
+  ASSERT_LE(mm_tcache_size(), sizeof(cache_mem));
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+
+  /* Exhaust the heap, then queue every block from another thread: a refill must drain instead of failing. */
+  void* ptrs[256];
+  size_t n = 0;
+  while (n < 256 && (ptrs[n] = (mm_malloc)(alloc, 1000)) != NULL) n++;
+  ASSERT_GT(n, 0);
+  /* The tail left by the large blocks may still fit a refill in some geometries; use it up too. */
+  while (n < 256 && (ptrs[n] = (mm_malloc)(alloc, 1)) != NULL) n++;
+  ASSERT_LT(n, 256);
+  ASSERT_EQ(mm_drain_remote_frees(alloc), 0); /* restarts the periodic count */
+  ASSERT(free_on_other_thread(alloc, ptrs, n));
+  void* small = mm_tcache_malloc(cache, 64);
+  ASSERT_NOT_NULL(small);
+  mm_tcache_free(cache, small);
+  mm_tcache_destroy(cache);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  ASSERT((mm_validate)(alloc));
+  return 1;
+}
+
+#define CONSUMERS 3
+#define OBJECTS 30000
+#define RING 256
+
+typedef struct ring_t {
+  void* slots[RING];
+  size_t head;
+  size_t tail;
+  tlsf_t alloc;
+  size_t expected;
+  int corrupt;
+} ring_t;
+
+static void* consume(void* arg) {
+  ring_t* ring = (ring_t*)arg;
+  for (size_t done = 0; done < ring->expected; done++) {
+    size_t tail = ring->tail;
+    while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) sched_yield();
+    uint32_t* p = (uint32_t*)ring->slots[tail % RING];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    if (p[0] != (uint32_t)(uintptr_t)p || p[1] != 0xC0FFEEu) ring->corrupt = 1;
+    (mm_free)(ring->alloc, p);
+  }
+  return NULL;
+}
+
+static int test_producer_consumer_pipeline(void) {
+  static uint8_t backing[4 * 1024 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_REMOTE_FREE);
+  ASSERT_NOT_NULL(alloc);
+
+  static ring_t rings[CONSUMERS];
+  pthread_t tids[CONSUMERS];
+  for (int c = 0; c < CONSUMERS; c++) {
+    memset(&rings[c], 0, sizeof(rings[c]));
+    rings[c].alloc = alloc;
+    rings[c].expected = OBJECTS;
+    ASSERT_EQ(pthread_create(&tids[c], NULL, consume, &rings[c]), 0);
+  }
+
+  /* Consumers push concurrently onto one stack while the producer keeps draining it. */
+  uint32_t seed = 0x5EED5u;
+  for (size_t i = 0; i < OBJECTS; i++) {
+    for (int c = 0; c < CONSUMERS; c++) {
+      ring_t* ring = &rings[c];
+      seed = seed * 1103515245u + 12345u;
+      uint32_t* p = (uint32_t*)(mm_malloc)(alloc, 8 + (seed >> 8) % 600);
+      ASSERT_NOT_NULL(p);
+      p[0] = (uint32_t)(uintptr_t)p;
+      p[1] = 0xC0FFEEu;
+      size_t head = ring->head;
+      while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == RING) sched_yield();
+      ring->slots[head % RING] = p;
+      __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+    if ((i & 4095) == 0) ASSERT((mm_validate)(alloc));
+  }
+  for (int c = 0; c < CONSUMERS; c++) {
+    ASSERT_EQ(pthread_join(tids[c], NULL), 0);
+    ASSERT_EQ(rings[c].corrupt, 0);
+  }
+
+  mm_drain_remote_frees(alloc);
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Remote frees");
+  RUN_TEST(test_remote_frees_are_drained_in_bulk);
+  RUN_TEST(test_owner_and_explicit_drain);
+#if !defined(MM_DEBUG) || (defined(MM_DEBUG_ABORT_ON_REMOTE_CYCLE) && !MM_DEBUG_ABORT_ON_REMOTE_CYCLE)
+  RUN_TEST(test_double_remote_free_is_dropped);
+#endif
+  RUN_TEST(test_tcache_refill_drains_before_failing);
+  RUN_TEST(test_producer_consumer_pipeline);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
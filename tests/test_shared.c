@@ -0,0 +1,177 @@
+#define _GNU_SOURCE
+
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include "../src/memoman_os.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define HEAP_BYTES (4 * 1024 * 1024)
+
+static void shm_name(char* out, size_t n, const char* tag) {
+  snprintf(out, n, "/mm_test_%s_%ld", tag, (long)getpid());
+}
+
+static int test_two_views_share_one_heap(void) {
+  char name[64];
+  shm_name(name, sizeof(name), "views");
+  tlsf_t a = mm_shm_create(name, HEAP_BYTES, 0);
+  ASSERT_NOT_NULL(a);
+  /* A second mapping of the same object lands at another address. */
+  tlsf_t b = mm_shm_open(name);
+  ASSERT_NOT_NULL(b);
+  ASSERT_NE(a, b);
+
+  char* msg = (char*)(mm_malloc)(a, 100);
+  ASSERT_NOT_NULL(msg);
+  strcpy(msg, "hello from view a");
+  size_t off = mm_shm_offset(a, msg);
+  ASSERT_NE(off, 0);
+
+  /* View b sees the same block and can allocate around it and free it. */
+  char* seen = (char*)mm_shm_pointer(b, off);
+  ASSERT_EQ(strcmp(seen, "hello from view a"), 0);
+  ASSERT_EQ((mm_block_size)(seen), (mm_block_size)(msg));
+  void* other = (mm_malloc)(b, 4000);
+  ASSERT_NOT_NULL(other);
+  (mm_free)(b, seen);
+  ASSERT((mm_validate)(a));
+  ASSERT((mm_validate)(b));
+  (mm_free)(a, mm_shm_pointer(a, mm_shm_offset(b, other)));
+  ASSERT_EQ(bytes_in_use(a), 0);
+  ASSERT_EQ(mm_shm_offset(a, NULL), 0);
+  ASSERT_NULL(mm_shm_pointer(a, 0));
+
+  mm_shm_close(b);
+  mm_shm_close(a);
+  ASSERT_EQ(mm_shm_unlink(name), 1);
+  ASSERT_NULL(mm_shm_open(name));
+  return 1;
+}
+
+#define MESSAGES 256
+#define CHURN_OPS 20000
+#define SLOTS 64
+
+typedef struct mailbox_t {
+  size_t offsets[MESSAGES]; /* message buffers left behind by the child */
+} mailbox_t;
+
+/* Allocation churn with every live block tagged; returns 0 on corruption. */
+static int churn(tlsf_t alloc, uint32_t seed, unsigned char tag) {
+  void* live[SLOTS] = {0};
+  size_t sizes[SLOTS] = {0};
+  for (int i = 0; i < CHURN_OPS; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int slot = (int)((seed >> 16) % SLOTS);
+    if (live[slot]) {
+      const unsigned char* p = (const unsigned char*)live[slot];
+      for (size_t j = 0; j < sizes[slot]; j++) if (p[j] != tag) return 0;
+      (mm_free)(alloc, live[slot]);
+    }
+    sizes[slot] = 1 + (seed >> 4) % 1500;
+    live[slot] = (mm_malloc)(alloc, sizes[slot]);
+    if (!live[slot]) return 0;
+    memset(live[slot], tag, sizes[slot]);
+  }
+  for (int i = 0; i < SLOTS; i++) (mm_free)(alloc, live[i]);
+  return 1;
+}
+
+static int child_main(const char* name, size_t mailbox_off, void* parent_view) {
+  tlsf_t alloc = mm_shm_open(name);
+  if (!alloc || alloc == parent_view) return 2;
+  mailbox_t* box = (mailbox_t*)mm_shm_pointer(alloc, mailbox_off);
+  if (!churn(alloc, 0xC41D, 0xCC)) return 3;
+  for (int i = 0; i < MESSAGES; i++) {
+    char* msg = (char*)(mm_malloc)(alloc, 64);
+    if (!msg) return 4;
+    snprintf(msg, 64, "message %d", i);
+    box->offsets[i] = mm_shm_offset(alloc, msg);
+  }
+  if (!(mm_validate)(alloc)) return 5;
+  mm_shm_close(alloc);
+  return 0;
+}
+
+static int test_fork_allocates_concurrently(void) {
+  char name[64];
+  shm_name(name, sizeof(name), "fork");
+  tlsf_t alloc = mm_shm_create(name, HEAP_BYTES, 0);
+  ASSERT_NOT_NULL(alloc);
+  mailbox_t* box = (mailbox_t*)(mm_malloc)(alloc, sizeof(mailbox_t));
+  ASSERT_NOT_NULL(box);
+  memset(box, 0, sizeof(*box));
+  size_t mailbox_off = mm_shm_offset(alloc, box);
+
+  fflush(stdout);
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) _exit(child_main(name, mailbox_off, alloc));
+
+  /* The parent churns on its own view while the child works through a different mapping. */
+  int parent_ok = churn(alloc, 0x9A2E, 0xAA);
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT(parent_ok);
+  ASSERT(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+  ASSERT((mm_validate)(alloc));
+
+  for (int i = 0; i < MESSAGES; i++) {
+    char expect[64];
+    snprintf(expect, sizeof(expect), "message %d", i);
+    char* msg = (char*)mm_shm_pointer(alloc, box->offsets[i]);
+    ASSERT_NOT_NULL(msg);
+    ASSERT_EQ(strcmp(msg, expect), 0);
+    (mm_free)(alloc, msg);
+  }
+  (mm_free)(alloc, box);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(bytes_in_use(alloc), 0);
+
+  mm_shm_close(alloc);
+  ASSERT_EQ(mm_shm_unlink(name), 1);
+  return 1;
+}
+
+static int test_shared_flag_restrictions(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  static void* table[1024];
+  ASSERT_NULL(mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_SHARED | MM_FLAG_SLAB));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_SHARED);
+  ASSERT_NOT_NULL(alloc);
+
+  /* Process-local pointers never enter the control block. */
+  ASSERT_EQ(mm_handles_attach(alloc, table, 16), 0);
+  ASSERT_EQ(mm_validate_pool(mm_get_pool(alloc)), 0);
+  ASSERT((mm_validate)(alloc));
+
+  /* The heap stays valid when its bytes move as a whole. */
+  static uint8_t moved[64 * 1024] __attribute__((aligned(16)));
+  void* p = (mm_malloc)(alloc, 300);
+  ASSERT_NOT_NULL(p);
+  size_t off = (size_t)((char*)p - (char*)backing);
+  memcpy(moved, backing, sizeof(backing));
+  tlsf_t copy = (tlsf_t)moved;
+  ASSERT((mm_validate)(copy));
+  (mm_free)(copy, moved + off);
+  ASSERT((mm_validate)(copy));
+  ASSERT_EQ(bytes_in_use(copy), 0);
+
+  char name[64];
+  shm_name(name, sizeof(name), "missing");
+  ASSERT_NULL(mm_shm_open(name));
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Shared-memory heaps");
+  RUN_TEST(test_two_views_share_one_heap);
+  RUN_TEST(test_fork_allocates_concurrently);
+  RUN_TEST(test_shared_flag_restrictions);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -0,0 +1,175 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+#define SLAB_HEAP_BYTES (1024 * 1024)
+
+static int test_slab_small_objects_have_no_header(void) {
+  void* mem = malloc(SLAB_HEAP_BYTES);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, SLAB_HEAP_BYTES, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  /* Consecutive 16-byte objects are packed back to back (TLSF would add a header and round up to 24). */
+  char* a = (mm_malloc)(alloc, 16);
+  char* b = (mm_malloc)(alloc, 16);
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+  ASSERT_EQ(b - a, 16);
+  ASSERT_EQ((uintptr_t)a % 16, 0);
+
+  /* Same slab, same pool. */
+  ASSERT_EQ(mm_get_pool_for_ptr(alloc, a), mm_get_pool_for_ptr(alloc, b));
+  ASSERT((mm_validate)(alloc));
+
+  (mm_free)(alloc, a);
+  (mm_free)(alloc, b);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+static int test_slab_slot_reuse_and_classes(void) {
+  void* mem = malloc(SLAB_HEAP_BYTES);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, SLAB_HEAP_BYTES, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  static const size_t sizes[] = {1, 16, 17, 100, 128, 129, 200, 256, 300, 512};
+  void* ptrs[sizeof(sizes) / sizeof(sizes[0])];
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    ptrs[i] = (mm_malloc)(alloc, sizes[i]);
+    ASSERT_NOT_NULL(ptrs[i]);
+    memset(ptrs[i], (int)i, sizes[i]);
+  }
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for (size_t j = 0; j < sizes[i]; j++) ASSERT_EQ(((unsigned char*)ptrs[i])[j], (unsigned char)i);
+  }
+
+  /* Freed slot is handed out again for the same class. */
+  void* p = ptrs[3];
+  (mm_free)(alloc, p);
+  ASSERT_EQ((mm_malloc)(alloc, 97), p);
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) (mm_free)(alloc, ptrs[i]);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+static int test_slab_large_requests_use_tlsf(void) {
+  void* mem = malloc(SLAB_HEAP_BYTES);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, SLAB_HEAP_BYTES, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  void* big = (mm_malloc)(alloc, 4096);
+  ASSERT_NOT_NULL(big);
+  ASSERT_GE(mm_block_size(big), 4096);
+  (mm_free)(alloc, big);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+static int test_slab_realloc_across_boundary(void) {
+  void* mem = malloc(SLAB_HEAP_BYTES);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, SLAB_HEAP_BYTES, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  unsigned char* p = (mm_malloc)(alloc, 40);
+  ASSERT_NOT_NULL(p);
+  for (int i = 0; i < 40; i++) p[i] = (unsigned char)i;
+
+  /* Fits the 48-byte slot: stays put. */
+  ASSERT_EQ((mm_realloc)(alloc, p, 48), p);
+
+  /* Grows out of the slab into the TLSF heap. */
+  unsigned char* q = (mm_realloc)(alloc, p, 2000);
+  ASSERT_NOT_NULL(q);
+  for (int i = 0; i < 40; i++) ASSERT_EQ(q[i], (unsigned char)i);
+
+  /* Shrinks back into a slab slot. */
+  unsigned char* r = (mm_realloc)(alloc, q, 64);
+  ASSERT_NOT_NULL(r);
+  for (int i = 0; i < 40; i++) ASSERT_EQ(r[i], (unsigned char)i);
+
+  (mm_free)(alloc, r);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+static int test_slab_empty_slabs_return_to_heap(void) {
+  void* mem = malloc(SLAB_HEAP_BYTES);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, SLAB_HEAP_BYTES, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  /* Enough 64-byte objects to span several slabs. */
+  enum { N = 2000 };
+  static void* ptrs[N];
+  for (int i = 0; i < N; i++) {
+    ptrs[i] = (mm_malloc)(alloc, 64);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  for (int i = 0; i < N; i++) (mm_free)(alloc, ptrs[i]);
+  ASSERT((mm_validate)(alloc));
+
+  /* Only one cached empty slab may remain; a large block close to the whole heap must fit again after reset. */
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  void* big = (mm_malloc)(alloc, SLAB_HEAP_BYTES / 2);
+  ASSERT_NOT_NULL(big);
+  (mm_free)(alloc, big);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+static int test_slab_double_free_ignored(void) {
+  void* mem = malloc(SLAB_HEAP_BYTES);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, SLAB_HEAP_BYTES, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  void* keep = (mm_malloc)(alloc, 32);
+  void* p = (mm_malloc)(alloc, 32);
+  ASSERT_NOT_NULL(keep);
+  ASSERT_NOT_NULL(p);
+  (mm_free)(alloc, p);
+  (mm_free)(alloc, p);
+  ASSERT((mm_validate)(alloc));
+
+  (mm_free)(alloc, keep);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+static int test_slab_rejects_tcache(void) {
+  void* mem = malloc(SLAB_HEAP_BYTES);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, SLAB_HEAP_BYTES, MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+  void* cache_mem = malloc(mm_tcache_size());
+  ASSERT_NULL(mm_tcache_create(cache_mem, alloc));
+  free(cache_mem);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Slab front end");
+  RUN_TEST(test_slab_small_objects_have_no_header);
+  RUN_TEST(test_slab_slot_reuse_and_classes);
+  RUN_TEST(test_slab_large_requests_use_tlsf);
+  RUN_TEST(test_slab_realloc_across_boundary);
+  RUN_TEST(test_slab_empty_slabs_return_to_heap);
+  RUN_TEST(test_slab_double_free_ignored);
+  RUN_TEST(test_slab_rejects_tcache);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -67,6 +67,17 @@ static void* mm_backend_memalign(size_t a, size_t size) { return (mm_memalign)(s
 static size_t mm_backend_block_size(void* ptr) { return (mm_block_size)(ptr); }
 static int mm_backend_validate(void) { return (mm_validate)(sys_allocator); }
 
+/* Same pool as `memoman`, re-created with MM_FLAG_BEST_FIT (bounded best fit inside the request's class). */
+static void mm_bestfit_backend_reset(void) {
+  TEST_RESET();
+  (mm_destroy)(sys_allocator);
+  sys_allocator = mm_create_with_pool_ex(_test_pool, TEST_POOL_SIZE, MM_FLAG_BEST_FIT);
+}
+static int mm_bestfit_backend_init(void) {
+  mm_bestfit_backend_reset();
+  return sys_allocator != NULL;
+}
+
 static int sys_backend_init(void) { return 1; }
 static void sys_backend_reset(void) {}
 static void sys_backend_destroy(void) {}
@@ -117,6 +128,20 @@ static const soak_alloc_api_t g_memoman_api = {
   .has_pools = 1,
 };
 
+static const soak_alloc_api_t g_memoman_bestfit_api = {
+  .name = "memoman_bestfit",
+  .init_fn = mm_bestfit_backend_init,
+  .reset_fn = mm_bestfit_backend_reset,
+  .destroy_fn = mm_backend_destroy,
+  .malloc_fn = mm_backend_malloc,
+  .free_fn = mm_backend_free,
+  .realloc_fn = mm_backend_realloc,
+  .memalign_fn = mm_backend_memalign,
+  .block_size_fn = mm_backend_block_size,
+  .validate_fn = mm_backend_validate,
+  .has_pools = 1,
+};
+
 static const soak_alloc_api_t g_malloc_api = {
   .name = "malloc",
   .init_fn = sys_backend_init,
@@ -237,6 +262,7 @@ static const soak_alloc_api_t g_conte_api = {
 static const soak_alloc_api_t* soak_backend_by_name(const char* name) {
   if (!name || !*name) return &g_memoman_api;
   if (!strcmp(name, "memoman")) return &g_memoman_api;
+  if (!strcmp(name, "memoman_bestfit")) return &g_memoman_bestfit_api;
   if (!strcmp(name, "malloc")) return &g_malloc_api;
 #if defined(MM_SOAK_HAVE_CONTE_TLSF)
   if (!strcmp(name, "conte")) return &g_conte_api;
@@ -517,6 +543,7 @@ typedef struct {
   size_t steps;
   size_t slots;
   uint64_t elapsed_ns;
+  size_t footprint;
   soak_stats_t stats;
 } soak_time_result_t;
 
@@ -699,7 +726,7 @@ static int soak_pool_add_remove(uint32_t seed) {
   (void)seed;
   if (!api->has_pools) return 1;
 
-  TEST_RESET();
+  if (api->reset_fn) api->reset_fn();
 
   size_t pool_bytes = 256 * 1024;
   void* raw = malloc(pool_bytes);
@@ -894,6 +921,9 @@ static int soak_random_time(uint32_t seed, unsigned seconds, size_t slots_n, uns
   soak_stats_t total = {0};
   size_t in_use = 0;
   const int strict = soak_strict();
+  /* Address span ever handed out: for a pool allocator, how much of the pool the workload needed. */
+  uintptr_t span_lo = UINTPTR_MAX;
+  uintptr_t span_hi = 0;
 
   const uint64_t t0 = now_ns();
   const uint64_t deadline = t0 + (uint64_t)seconds * 1000000000ull;
@@ -1016,6 +1046,10 @@ static int soak_random_time(uint32_t seed, unsigned seconds, size_t slots_n, uns
     }
 
     uint64_t op_ns = now_ns() - t_op0;
+    if (s->ptr) {
+      if ((uintptr_t)s->ptr < span_lo) span_lo = (uintptr_t)s->ptr;
+      if ((uintptr_t)s->ptr + s->req > span_hi) span_hi = (uintptr_t)s->ptr + s->req;
+    }
     if (op == OP_MALLOC) stat_add(&total.malloc_s, op_ns, ok);
     else if (op == OP_FREE) stat_add(&total.free_s, op_ns, ok);
     else if (op == OP_REALLOC) stat_add(&total.realloc_s, op_ns, ok);
@@ -1092,6 +1126,7 @@ static int soak_random_time(uint32_t seed, unsigned seconds, size_t slots_n, uns
       out->steps = step;
       out->slots = slots_n;
       out->elapsed_ns = t_end - t0;
+      out->footprint = span_hi > span_lo ? (size_t)(span_hi - span_lo) : 0;
       out->stats = total;
     }
   }
@@ -1099,17 +1134,27 @@ static int soak_random_time(uint32_t seed, unsigned seconds, size_t slots_n, uns
   return 1;
 }
 
+static double op_avg_ns(const op_stat_t* s) {
+  return s->ops ? (double)s->total_ns / (double)s->ops : 0.0;
+}
+
 static void soak_print_time_summary(const soak_time_result_t* r) {
   if (!r) return;
   const double sec = r->elapsed_ns ? ((double)r->elapsed_ns / 1000000000.0) : 0.0;
   const double ops_s = sec > 0.0 ? (double)r->steps / sec : 0.0;
 
   printf(
-    "soak: summary backend=%s seconds=%u steps=%zu ops/s=%.0f max_us{m=%llu f=%llu r=%llu a=%llu} fails{m=%llu r=%llu a=%llu} validate=%llu\n",
+    "soak: summary backend=%s seconds=%u steps=%zu ops/s=%.0f footprint_kib=%zu avg_ns{m=%.0f f=%.0f r=%.0f a=%.0f} "
+    "max_us{m=%llu f=%llu r=%llu a=%llu} fails{m=%llu r=%llu a=%llu} validate=%llu\n",
     r->backend ? r->backend : "?",
     r->seconds,
     r->steps,
     ops_s,
+    r->footprint / 1024u,
+    op_avg_ns(&r->stats.malloc_s),
+    op_avg_ns(&r->stats.free_s),
+    op_avg_ns(&r->stats.realloc_s),
+    op_avg_ns(&r->stats.memalign_s),
     (unsigned long long)(r->stats.malloc_s.max_ns / 1000ull),
     (unsigned long long)(r->stats.free_s.max_ns / 1000ull),
     (unsigned long long)(r->stats.realloc_s.max_ns / 1000ull),
@@ -1121,24 +1166,177 @@ static void soak_print_time_summary(const soak_time_result_t* r) {
   );
 }
 
+static double pct_change(double from, double to) {
+  return from > 0.0 ? ((to - from) / from) * 100.0 : 0.0;
+}
+
 static void soak_print_time_compare(const soak_time_result_t* a, const soak_time_result_t* b) {
   if (!a || !b) return;
   double a_sec = a->elapsed_ns ? ((double)a->elapsed_ns / 1000000000.0) : 0.0;
   double b_sec = b->elapsed_ns ? ((double)b->elapsed_ns / 1000000000.0) : 0.0;
   double a_ops = a_sec > 0.0 ? (double)a->steps / a_sec : 0.0;
   double b_ops = b_sec > 0.0 ? (double)b->steps / b_sec : 0.0;
-  double pct = (a_ops > 0.0) ? ((b_ops - a_ops) / a_ops) * 100.0 : 0.0;
 
   printf(
-    "soak: compare %s vs %s ops/s %.0f vs %.0f (%.2f%%)\n",
+    "soak: compare %s vs %s ops/s %.0f vs %.0f (%.2f%%) footprint_kib %zu vs %zu (%.2f%%) "
+    "avg_ns{m=%.2f%% f=%.2f%% r=%.2f%% a=%.2f%%}\n",
     a->backend ? a->backend : "?",
     b->backend ? b->backend : "?",
     a_ops,
     b_ops,
-    pct
+    pct_change(a_ops, b_ops),
+    a->footprint / 1024u,
+    b->footprint / 1024u,
+    pct_change((double)a->footprint, (double)b->footprint),
+    pct_change(op_avg_ns(&a->stats.malloc_s), op_avg_ns(&b->stats.malloc_s)),
+    pct_change(op_avg_ns(&a->stats.free_s), op_avg_ns(&b->stats.free_s)),
+    pct_change(op_avg_ns(&a->stats.realloc_s), op_avg_ns(&b->stats.realloc_s)),
+    pct_change(op_avg_ns(&a->stats.memalign_s), op_avg_ns(&b->stats.memalign_s))
   );
 }
 
+/*
+** Pool drain soak (MM_SOAK_BACKEND=pool_drain): a long-running heap over MM_SOAK_DRAIN_POOLS pools whose live set
+** ramps up to most of the capacity, then shrinks to a fifth of it and keeps churning with mixed lifetimes. It
+** reports how many pools are fully empty (removable with `mm_remove_pool`) at each checkpoint, once with the
+** default LIFO free lists and once with MM_FLAG_ADDRESS_ORDERED.
+*/
+#define SOAK_DRAIN_SLOTS 8192
+#define SOAK_DRAIN_CHECKPOINTS 20
+
+typedef struct {
+  size_t empty_final;
+  size_t empty_min;
+  double empty_avg; /* over the checkpoints after the live set has shrunk */
+  size_t live_final;
+} soak_drain_result_t;
+
+static size_t soak_drain_target(size_t step, size_t steps, size_t capacity) {
+  /* Ramp to 85% over the first 10%, decay to 20% by 60%, then hold. */
+  const size_t hi = capacity / 100 * 85;
+  const size_t lo = capacity / 100 * 20;
+  if (step < steps / 10) return hi / (steps / 10) * step;
+  if (step < steps / 10 * 6) return hi - (hi - lo) / (steps / 2) * (step - steps / 10);
+  return lo;
+}
+
+static int soak_pool_drain(uint32_t seed, unsigned int flags, size_t steps, soak_drain_result_t* out) {
+  const size_t pool_n = soak_iter_override("MM_SOAK_DRAIN_POOLS", 8);
+  const size_t pool_bytes = soak_iter_override("MM_SOAK_DRAIN_POOL_BYTES", 1024 * 1024);
+  const int verbose = soak_verbose();
+  const char* policy = (flags & MM_FLAG_ADDRESS_ORDERED) ? "address_ordered" : "lifo";
+  ASSERT(pool_n >= 1 && pool_n <= 16);
+  if (steps < 100 * SOAK_DRAIN_CHECKPOINTS) steps = 100 * SOAK_DRAIN_CHECKPOINTS;
+
+  void* ctrl_mem = malloc(mm_size());
+  ASSERT_NOT_NULL(ctrl_mem);
+  tlsf_t alloc = mm_create_ex(ctrl_mem, flags);
+  ASSERT_NOT_NULL(alloc);
+  void* raw[16] = {0};
+  pool_t pools[16] = {0};
+  for (size_t i = 0; i < pool_n; i++) {
+    raw[i] = malloc(pool_bytes);
+    ASSERT_NOT_NULL(raw[i]);
+    pools[i] = mm_add_pool(alloc, raw[i], pool_bytes);
+    ASSERT_NOT_NULL(pools[i]);
+  }
+
+  static slot_t slots[SOAK_DRAIN_SLOTS];
+  static uint8_t long_lived[SOAK_DRAIN_SLOTS];
+  memset(slots, 0, sizeof(slots));
+  uint32_t rng = seed ^ 0xD4A1D4A1u;
+  size_t live = 0;
+  size_t empty_min = SIZE_MAX;
+  size_t empty_sum = 0;
+  size_t empty_samples = 0;
+  size_t empty = 0;
+  const size_t capacity = pool_n * pool_bytes;
+  const size_t check_every = steps / SOAK_DRAIN_CHECKPOINTS;
+
+  for (size_t step = 1; step <= steps; step++) {
+    const size_t target = soak_drain_target(step, steps, capacity);
+    size_t idx = (size_t)(xorshift32(&rng) % SOAK_DRAIN_SLOTS);
+    slot_t* s = &slots[idx];
+    uint32_t r = xorshift32(&rng);
+    if (s->ptr) {
+      /* Short-lived objects die quickly, long-lived ones rarely; anything goes once over target. */
+      if (live > target || (long_lived[idx] ? (r & 255u) == 0 : (r & 3u) == 0)) {
+        if (!check_pattern(s->ptr, s->req, s->pat)) {
+          print_repro("pool_drain", seed, 0, step, OP_FREE, idx, s->req, 0);
+          return 0;
+        }
+        live -= s->req;
+        (mm_free)(alloc, s->ptr);
+        s->ptr = NULL;
+      }
+    } else if (live < target) {
+      size_t req = pick_size(r);
+      if (req == 0) req = 1;
+      void* p = (mm_malloc)(alloc, req);
+      if (p) {
+        s->ptr = p;
+        s->req = req;
+        s->pat = (uint8_t)(r >> 24);
+        long_lived[idx] = (uint8_t)((r >> 8) % 10 == 0);
+        fill_pattern(p, req, s->pat);
+        live += req;
+      }
+    }
+
+    if (step % check_every == 0) {
+      ASSERT((mm_validate)(alloc));
+      empty = 0;
+      for (size_t i = 0; i < pool_n; i++) empty += mm_pool_is_empty(alloc, pools[i]) ? 1u : 0u;
+      if (step > steps / 10 * 6) {
+        empty_sum += empty;
+        empty_samples++;
+        if (empty < empty_min) empty_min = empty;
+      }
+      if (verbose) {
+        printf("soak: pool_drain policy=%s step=%zu live_kib=%zu target_kib=%zu empty_pools=%zu/%zu\n",
+          policy, step, live / 1024u, target / 1024u, empty, pool_n);
+      }
+    }
+  }
+
+  if (out) {
+    out->empty_final = empty;
+    out->empty_min = empty_min == SIZE_MAX ? 0 : empty_min;
+    out->empty_avg = empty_samples ? (double)empty_sum / (double)empty_samples : 0.0;
+    out->live_final = live;
+  }
+
+  /* Empty pools really are removable mid-run. */
+  for (size_t i = 0; i < pool_n; i++) {
+    if (!mm_pool_is_empty(alloc, pools[i])) continue;
+    mm_remove_pool(alloc, pools[i]);
+    pools[i] = NULL;
+  }
+  ASSERT((mm_validate)(alloc));
+  for (size_t i = 0; i < SOAK_DRAIN_SLOTS; i++) {
+    if (slots[i].ptr) (mm_free)(alloc, slots[i].ptr);
+  }
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  for (size_t i = 0; i < pool_n; i++) free(raw[i]);
+  free(ctrl_mem);
+  return 1;
+}
+
+static int soak_pool_drain_compare(uint32_t seed) {
+  const size_t steps = soak_iter_override("MM_SOAK_DRAIN_STEPS", 4000000);
+  soak_drain_result_t lifo = {0};
+  soak_drain_result_t ordered = {0};
+  if (!soak_pool_drain(seed, 0, steps, &lifo)) return 0;
+  if (!soak_pool_drain(seed, MM_FLAG_ADDRESS_ORDERED, steps, &ordered)) return 0;
+
+  printf("soak: pool_drain policy=lifo steps=%zu empty_final=%zu empty_min=%zu empty_avg=%.2f live_kib=%zu\n",
+    steps, lifo.empty_final, lifo.empty_min, lifo.empty_avg, lifo.live_final / 1024u);
+  printf("soak: pool_drain policy=address_ordered steps=%zu empty_final=%zu empty_min=%zu empty_avg=%.2f live_kib=%zu\n",
+    steps, ordered.empty_final, ordered.empty_min, ordered.empty_avg, ordered.live_final / 1024u);
+  return 1;
+}
+
 static int soak_run_backend_time(
   const soak_alloc_api_t* api,
   uint32_t seed0,
@@ -1193,13 +1391,17 @@ static int test_soak(void) {
 #endif
   const int verbose = soak_verbose();
   const size_t progress_every = soak_progress_every();
-  const int want_compare = (env_backend && !strcmp(env_backend, "compare"));
+  /* compare: memoman vs Conte TLSF (or malloc); compare_fit: memoman good fit vs MM_FLAG_BEST_FIT. */
+  const int want_compare_fit = (env_backend && !strcmp(env_backend, "compare_fit"));
+  const int want_compare = want_compare_fit || (env_backend && !strcmp(env_backend, "compare"));
   const soak_alloc_api_t* api = want_compare ? NULL : soak_backend();
 
   if (env_seed0 && *env_seed0) seed0 = (uint32_t)strtoul(env_seed0, NULL, 0);
   if (env_seed_count && *env_seed_count) seeds = (size_t)strtoull(env_seed_count, NULL, 0);
   if (env_steps && *env_steps) steps = (size_t)strtoull(env_steps, NULL, 0);
   if (env_slots && *env_slots) slots_n = (size_t)strtoull(env_slots, NULL, 0);
+
+  if (env_backend && !strcmp(env_backend, "pool_drain")) return soak_pool_drain_compare(seed0);
   if (env_validate && *env_validate) validate_shift = (unsigned)strtoul(env_validate, NULL, 0);
 
   if (seeds == 0) seeds = 1;
@@ -1215,8 +1417,8 @@ static int test_soak(void) {
     const char* build = "release";
 #endif
     if (want_compare) {
-      printf("soak: build=%s backend=compare seed0=0x%08x seeds=%zu steps=%zu slots=%zu validate_shift=%u progress_every=%zu\n",
-        build, seed0, seeds, steps, slots_n, validate_shift, progress_every);
+      printf("soak: build=%s backend=%s seed0=0x%08x seeds=%zu steps=%zu slots=%zu validate_shift=%u progress_every=%zu\n",
+        build, want_compare_fit ? "compare_fit" : "compare", seed0, seeds, steps, slots_n, validate_shift, progress_every);
     } else {
       printf("soak: build=%s backend=%s seed0=0x%08x seeds=%zu steps=%zu slots=%zu validate_shift=%u progress_every=%zu\n",
         build, api->name, seed0, seeds, steps, slots_n, validate_shift, progress_every);
@@ -1235,14 +1437,14 @@ static int test_soak(void) {
     soak_time_result_t r0 = {0};
     soak_time_result_t r1 = {0};
 
-#if defined(MM_SOAK_HAVE_CONTE_TLSF)
     const soak_alloc_api_t* left = &g_memoman_api;
+#if defined(MM_SOAK_HAVE_CONTE_TLSF)
     const soak_alloc_api_t* right = &g_conte_api;
 #else
-    const soak_alloc_api_t* left = &g_memoman_api;
     const soak_alloc_api_t* right = &g_malloc_api;
-    printf("soak: compare note: built without Conte TLSF; comparing memoman vs malloc\n");
+    if (!want_compare_fit) printf("soak: compare note: built without Conte TLSF; comparing memoman vs malloc\n");
 #endif
+    if (want_compare_fit) right = &g_memoman_bestfit_api;
 
     if (!soak_run_backend_time(left, seed0, seconds, slots_n, validate_shift, &r0)) return 0;
     if (!soak_run_backend_time(right, seed0, seconds, slots_n, validate_shift, &r1)) return 0;
@@ -0,0 +1,167 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+static int test_stats_fresh_heap(void) {
+  uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  mm_stats_t st;
+  ASSERT_EQ(mm_get_stats(alloc, &st), 1);
+  ASSERT_EQ(st.bytes_in_use, 0);
+  ASSERT_EQ(st.peak_bytes_in_use, 0);
+  ASSERT_EQ(st.pool_bytes, sizeof(backing) - mm_size());
+  ASSERT_GT(st.bytes_free, 0);
+  /* A single free block: the estimate is exact. */
+  ASSERT_EQ(st.largest_free_block, st.bytes_free);
+  ASSERT_EQ(st.malloc_count + st.free_count + st.realloc_count + st.memalign_count + st.failed_count, 0);
+
+  ASSERT_EQ(mm_get_stats(NULL, &st), 0);
+  ASSERT_EQ(mm_get_stats(alloc, NULL), 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_stats_track_operations(void) {
+  uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* a = (mm_malloc)(alloc, 100);
+  void* b = mm_memalign(alloc, 64, 200);
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.bytes_in_use, mm_block_size(a) + mm_block_size(b));
+  ASSERT_EQ(st.malloc_count, 1);
+  ASSERT_EQ(st.memalign_count, 1);
+
+  a = (mm_realloc)(alloc, a, 1000);
+  ASSERT_NOT_NULL(a);
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.realloc_count, 1);
+  ASSERT_EQ(st.bytes_in_use, mm_block_size(a) + mm_block_size(b));
+  /* A moving realloc briefly holds both blocks. */
+  ASSERT_GE(st.peak_bytes_in_use, st.bytes_in_use);
+  size_t peak = st.peak_bytes_in_use;
+
+  /* Shrink in place lowers in-use bytes but not the peak. */
+  a = (mm_realloc)(alloc, a, 64);
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.bytes_in_use, mm_block_size(a) + mm_block_size(b));
+  ASSERT_EQ(st.peak_bytes_in_use, peak);
+
+  ASSERT_NULL((mm_malloc)(alloc, 1024 * 1024));
+  ASSERT_NULL(mm_memalign(alloc, 4096, 1024 * 1024));
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.failed_count, 2);
+
+  (mm_free)(alloc, a);
+  (mm_free)(alloc, b);
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.free_count, 2);
+  ASSERT_EQ(st.bytes_in_use, 0);
+  ASSERT_EQ(st.peak_bytes_in_use, peak);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_stats_count_released_blocks(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  static void* cache_mem[1024];
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  /* Nothing released, nothing counted. */
+  void* nulls[3] = {NULL, NULL, NULL};
+  mm_free_batch(alloc, nulls, 3);
+#if !(defined(MM_DEBUG) && (!defined(MM_DEBUG_ABORT_ON_INVALID_POINTER) || MM_DEBUG_ABORT_ON_INVALID_POINTER))
+  static uint8_t foreign[256] __attribute__((aligned(16)));
+  (mm_free)(alloc, foreign + 16);
+  (mm_free)(alloc, foreign + 32);
+#endif
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.free_count, 0);
+
+  /* Batches count blocks, not calls. */
+  void* ptrs[3];
+  ASSERT_EQ(mm_malloc_batch(alloc, 48, 3, ptrs), 3);
+  mm_free_batch(alloc, ptrs, 3);
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.malloc_count, 3);
+  ASSERT_EQ(st.free_count, 3);
+
+  /* A cache counts the blocks it moves to and from the heap; the hit in between is not counted. */
+  ASSERT_LE(mm_tcache_size(), sizeof(cache_mem));
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+  void* p = mm_tcache_malloc(cache, 32);
+  ASSERT_NOT_NULL(p);
+  mm_tcache_free(cache, p);
+  ASSERT_EQ(mm_tcache_malloc(cache, 32), p);
+  mm_tcache_free(cache, p);
+  mm_get_stats(alloc, &st);
+  size_t refilled = st.malloc_count - 3;
+  ASSERT_GT(refilled, 0);
+  mm_tcache_destroy(cache);
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.malloc_count - 3, refilled);
+  ASSERT_EQ(st.free_count - 3, refilled);
+  ASSERT_EQ(st.bytes_in_use, 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static void largest_free_walker(void* ptr, size_t size, int used, void* user) {
+  (void)ptr;
+  size_t* largest = (size_t*)user;
+  if (!used && size > *largest) *largest = size;
+}
+
+static int test_stats_largest_free_block_estimate(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  /* Carve holes of different sizes separated by live blocks. */
+  void* hole_small = (mm_malloc)(alloc, 1000);
+  void* sep1 = (mm_malloc)(alloc, 64);
+  void* hole_big = (mm_malloc)(alloc, 20000);
+  void* sep2 = (mm_malloc)(alloc, 64);
+  void* rest = (mm_malloc)(alloc, 150000);
+  ASSERT_NOT_NULL(rest);
+  (mm_free)(alloc, hole_small);
+  (mm_free)(alloc, hole_big);
+
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+
+  /* The estimate is a real free block within one SL class (1/32) of the exact largest one. */
+  size_t exact = 0;
+  mm_walk_pool(mm_get_pool(alloc), largest_free_walker, &exact);
+  ASSERT_GE(exact, 20000);
+  ASSERT_LE(st.largest_free_block, exact);
+  ASSERT_GE(st.largest_free_block, exact - exact / 32);
+
+  (mm_free)(alloc, sep1);
+  (mm_free)(alloc, sep2);
+  (mm_free)(alloc, rest);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Statistics");
+  RUN_TEST(test_stats_fresh_heap);
+  RUN_TEST(test_stats_track_operations);
+  RUN_TEST(test_stats_count_released_blocks);
+  RUN_TEST(test_stats_largest_free_block_estimate);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
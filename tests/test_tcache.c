@@ -0,0 +1,259 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <pthread.h>
+#include <stdint.h>
+
+static int test_tcache_hit_reuses_block(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* cache_mem = malloc(mm_tcache_size());
+  ASSERT_NOT_NULL(cache_mem);
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+
+  void* p = mm_tcache_malloc(cache, 48);
+  ASSERT_NOT_NULL(p);
+  ASSERT_GE(mm_block_size(p), 48);
+  memset(p, 0x5A, 48);
+  mm_tcache_free(cache, p);
+
+  /* Same class: served from the magazine, LIFO. */
+  void* q = mm_tcache_malloc(cache, 40);
+  ASSERT_EQ(q, p);
+  mm_tcache_free(cache, q);
+
+  ASSERT((mm_validate)(alloc));
+  mm_tcache_destroy(cache);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  free(cache_mem);
+  return 1;
+}
+
+static int test_tcache_large_requests_bypass_cache(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* cache_mem = malloc(mm_tcache_size());
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+
+  void* big = mm_tcache_malloc(cache, 4096);
+  ASSERT_NOT_NULL(big);
+  mm_tcache_free(cache, big);
+
+  /* Nothing small was cached, so the heap must be fully free again. */
+  ASSERT_EQ((mm_reset)(alloc), 1);
+
+  mm_tcache_destroy(cache);
+  (mm_destroy)(alloc);
+  free(cache_mem);
+  return 1;
+}
+
+static int test_tcache_minimum_blocks_stay_small(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* cache_mem = malloc(mm_tcache_size());
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+
+  /* Minimum-size blocks (12 bytes on 32-bit builds) must never be handed out for a larger class. */
+  void* tiny = (mm_malloc)(alloc, 1);
+  ASSERT_NOT_NULL(tiny);
+  ASSERT_EQ(mm_block_size(tiny), mm_block_size_min());
+  mm_tcache_free(cache, tiny);
+  for (size_t bytes = 16; bytes <= 256; bytes += 16) {
+    void* p = mm_tcache_malloc(cache, bytes);
+    ASSERT_NOT_NULL(p);
+    ASSERT_GE(mm_block_size(p), bytes);
+    mm_tcache_free(cache, p);
+  }
+
+  mm_tcache_destroy(cache);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(cache_mem);
+  return 1;
+}
+
+static int test_tcache_flush_releases_blocks(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* cache_mem = malloc(mm_tcache_size());
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+
+  void* ptrs[64];
+  for (int i = 0; i < 64; i++) {
+    ptrs[i] = mm_tcache_malloc(cache, 16 + (size_t)(i % 16) * 16);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  for (int i = 0; i < 64; i++) mm_tcache_free(cache, ptrs[i]);
+
+  /* Cached blocks are still live in the allocator until flushed. */
+  ASSERT_EQ((mm_reset)(alloc), 0);
+  mm_tcache_flush(cache);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+
+  mm_tcache_destroy(cache);
+  (mm_destroy)(alloc);
+  free(cache_mem);
+  return 1;
+}
+
+static int test_tcache_memory_is_bounded(void) {
+  uint8_t backing[1024 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* cache_mem = malloc(mm_tcache_size());
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+
+  enum { N = 2000 };
+  static void* ptrs[N];
+  for (int i = 0; i < N; i++) {
+    ptrs[i] = mm_tcache_malloc(cache, 64);
+    ASSERT_NOT_NULL(ptrs[i]);
+  }
+  for (int i = 0; i < N; i++) mm_tcache_free(cache, ptrs[i]);
+
+  /* All but one magazine's worth went back: a fresh 64-byte block from the core must succeed many times over. */
+  size_t reclaimed = 0;
+  for (int i = 0; i < N; i++) {
+    ptrs[i] = (mm_malloc)(alloc, 64);
+    if (!ptrs[i]) break;
+    reclaimed++;
+  }
+  ASSERT_GE(reclaimed, (size_t)N - 64);
+  for (size_t i = 0; i < reclaimed; i++) (mm_free)(alloc, ptrs[i]);
+
+  mm_tcache_destroy(cache);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(cache_mem);
+  return 1;
+}
+
+typedef struct {
+  tlsf_t alloc;
+  unsigned int seed;
+  int failed;
+} tc_worker_t;
+
+static void* tc_worker(void* arg) {
+  tc_worker_t* w = (tc_worker_t*)arg;
+  void* cache_mem = malloc(mm_tcache_size());
+  mm_tcache_t cache = mm_tcache_create(cache_mem, w->alloc);
+  void* slots[128] = {0};
+  unsigned int x = w->seed;
+
+  for (int i = 0; i < 50000; i++) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    int idx = (int)(x % 128);
+    if (slots[idx]) {
+      if (*(unsigned int*)slots[idx] != (unsigned int)idx) w->failed = 1;
+      mm_tcache_free(cache, slots[idx]);
+      slots[idx] = NULL;
+    } else {
+      slots[idx] = mm_tcache_malloc(cache, 16 + ((x >> 8) % 320));
+      if (slots[idx]) *(unsigned int*)slots[idx] = (unsigned int)idx;
+    }
+  }
+  for (int i = 0; i < 128; i++) {
+    if (slots[i]) mm_tcache_free(cache, slots[i]);
+  }
+  mm_tcache_destroy(cache);
+  free(cache_mem);
+  return NULL;
+}
+
+static int test_tcache_per_thread_shared_heap(void) {
+  const size_t bytes = 4 * 1024 * 1024;
+  void* mem = malloc(bytes);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, bytes, MM_FLAG_THREAD_SAFE);
+  ASSERT_NOT_NULL(alloc);
+
+  pthread_t threads[4];
+  tc_worker_t workers[4];
+  for (int i = 0; i < 4; i++) {
+    workers[i].alloc = alloc;
+    workers[i].seed = 0x2545f491u * (unsigned int)(i + 1);
+    workers[i].failed = 0;
+    ASSERT_EQ(pthread_create(&threads[i], NULL, tc_worker, &workers[i]), 0);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+    ASSERT_EQ(workers[i].failed, 0);
+  }
+
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+#if defined(MM_DEBUG) && !(defined(MM_DEBUG_ABORT_ON_DOUBLE_FREE) && MM_DEBUG_ABORT_ON_DOUBLE_FREE)
+/* Release builds cache a double free twice (see memoman.h); MM_DEBUG builds drop the second one. */
+static int test_tcache_double_free_is_ignored(void) {
+  uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+
+  void* cache_mem = malloc(mm_tcache_size());
+  ASSERT_NOT_NULL(cache_mem);
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+
+  void* p = mm_tcache_malloc(cache, 64);
+  void* q = mm_tcache_malloc(cache, 64);
+  ASSERT_NOT_NULL(p);
+  ASSERT_NOT_NULL(q);
+  mm_tcache_free(cache, p);
+  mm_tcache_free(cache, q);
+  mm_tcache_free(cache, p);
+
+  void* a = mm_tcache_malloc(cache, 64);
+  void* b = mm_tcache_malloc(cache, 64);
+  void* c = mm_tcache_malloc(cache, 64);
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+  ASSERT_NOT_NULL(c);
+  ASSERT_NE(a, b);
+  ASSERT_NE(a, c);
+  ASSERT_NE(b, c);
+
+  mm_tcache_free(cache, a);
+  mm_tcache_free(cache, b);
+  mm_tcache_free(cache, c);
+  mm_tcache_destroy(cache);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  free(cache_mem);
+  return 1;
+}
+#endif
+
+int main(void) {
+  TEST_SUITE_BEGIN("Thread caches");
+  RUN_TEST(test_tcache_hit_reuses_block);
+  RUN_TEST(test_tcache_large_requests_bypass_cache);
+  RUN_TEST(test_tcache_minimum_blocks_stay_small);
+  RUN_TEST(test_tcache_flush_releases_blocks);
+  RUN_TEST(test_tcache_memory_is_bounded);
+  RUN_TEST(test_tcache_per_thread_shared_heap);
+#if defined(MM_DEBUG) && !(defined(MM_DEBUG_ABORT_ON_DOUBLE_FREE) && MM_DEBUG_ABORT_ON_DOUBLE_FREE)
+  RUN_TEST(test_tcache_double_free_is_ignored);
+#endif
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
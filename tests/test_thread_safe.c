@@ -0,0 +1,137 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <pthread.h>
+#include <stdint.h>
+
+#define TS_THREADS 4
+#define TS_ITERS 20000
+#define TS_SLOTS 64
+
+typedef struct {
+  tlsf_t alloc;
+  unsigned int seed;
+  int failed;
+} ts_worker_t;
+
+static void* ts_churn_worker(void* arg) {
+  ts_worker_t* w = (ts_worker_t*)arg;
+  void* slots[TS_SLOTS] = {0};
+  unsigned char tags[TS_SLOTS] = {0};
+  unsigned int x = w->seed;
+
+  for (int i = 0; i < TS_ITERS; i++) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    int idx = (int)(x % TS_SLOTS);
+    if (slots[idx]) {
+      /* Another thread scribbling on our block would show up here. */
+      if (((unsigned char*)slots[idx])[0] != tags[idx]) w->failed = 1;
+      if ((x >> 8) & 1) {
+        (mm_free)(w->alloc, slots[idx]);
+        slots[idx] = NULL;
+      } else {
+        size_t sz = 16 + ((x >> 9) % 512);
+        void* p = (mm_realloc)(w->alloc, slots[idx], sz);
+        if (p) slots[idx] = p;
+      }
+    } else {
+      size_t sz = 16 + ((x >> 9) % 1024);
+      void* p = ((x >> 20) & 3) == 0 ? mm_memalign(w->alloc, 64, sz) : (mm_malloc)(w->alloc, sz);
+      if (p) {
+        tags[idx] = (unsigned char)(x >> 24);
+        memset(p, tags[idx], sz);
+        slots[idx] = p;
+      }
+    }
+  }
+
+  for (int i = 0; i < TS_SLOTS; i++) {
+    if (slots[i]) (mm_free)(w->alloc, slots[i]);
+  }
+  return NULL;
+}
+
+static int test_create_ex_rejects_unknown_flags(void) {
+  uint8_t buffer[32768] __attribute__((aligned(16)));
+  ASSERT_NULL(mm_create_ex(buffer, 0x80000000u));
+  ASSERT_NULL(mm_create_with_pool_ex(buffer, sizeof(buffer), ~MM_FLAG_MASK));
+  tlsf_t alloc = mm_create_with_pool_ex(buffer, sizeof(buffer), MM_FLAG_THREAD_SAFE);
+  ASSERT_NOT_NULL(alloc);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_thread_safe_shared_heap(void) {
+  const size_t bytes = 4 * 1024 * 1024;
+  void* mem = malloc(bytes);
+  ASSERT_NOT_NULL(mem);
+  tlsf_t alloc = mm_create_with_pool_ex(mem, bytes, MM_FLAG_THREAD_SAFE);
+  ASSERT_NOT_NULL(alloc);
+
+  pthread_t threads[TS_THREADS];
+  ts_worker_t workers[TS_THREADS];
+  for (int i = 0; i < TS_THREADS; i++) {
+    workers[i].alloc = alloc;
+    workers[i].seed = 0x9e3779b9u * (unsigned int)(i + 1);
+    workers[i].failed = 0;
+    ASSERT_EQ(pthread_create(&threads[i], NULL, ts_churn_worker, &workers[i]), 0);
+  }
+  for (int i = 0; i < TS_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    ASSERT_EQ(workers[i].failed, 0);
+  }
+
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  free(mem);
+  return 1;
+}
+
+typedef struct {
+  int rounds;
+  volatile int* stop;
+} ts_registry_worker_t;
+
+static void* ts_registry_churn(void* arg) {
+  ts_registry_worker_t* w = (ts_registry_worker_t*)arg;
+  uint8_t buffer[32768] __attribute__((aligned(16)));
+  uint8_t extra[8192] __attribute__((aligned(16)));
+
+  for (int i = 0; i < w->rounds; i++) {
+    /* Private instances: only the process-wide pool registry is shared between threads. */
+    tlsf_t alloc = mm_create_with_pool(buffer, sizeof(buffer));
+    pool_t pool = mm_add_pool(alloc, extra, sizeof(extra));
+    if (pool && !mm_validate_pool(pool)) *w->stop = 1;
+    mm_remove_pool(alloc, pool);
+    (mm_destroy)(alloc);
+  }
+  return NULL;
+}
+
+static int test_pool_registry_concurrent_add_remove(void) {
+  volatile int stop = 0;
+  pthread_t threads[TS_THREADS];
+  ts_registry_worker_t workers[TS_THREADS];
+  for (int i = 0; i < TS_THREADS; i++) {
+    workers[i].rounds = 2000;
+    workers[i].stop = &stop;
+    ASSERT_EQ(pthread_create(&threads[i], NULL, ts_registry_churn, &workers[i]), 0);
+  }
+  for (int i = 0; i < TS_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  ASSERT_EQ(stop, 0);
+
+  /* The test suite's own pool must still be reachable through the registry. */
+  ASSERT((mm_validate)(sys_allocator));
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Thread-safe mode");
+  RUN_TEST(test_create_ex_rejects_unknown_flags);
+  RUN_TEST(test_thread_safe_shared_heap);
+  RUN_TEST(test_pool_registry_concurrent_add_remove);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -0,0 +1,231 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include "../extras/mm_trace.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 256
+
+typedef struct event_log_t {
+  mm_trace_event_t events[MAX_EVENTS];
+  size_t count;
+  size_t dropped;
+} event_log_t;
+
+static void log_hook(void* user, const mm_trace_event_t* event) {
+  event_log_t* log = (event_log_t*)user;
+  if (log->count < MAX_EVENTS) log->events[log->count++] = *event;
+  else log->dropped++;
+}
+
+static int test_hook_sees_each_operation(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  static event_log_t log;
+  memset(&log, 0, sizeof(log));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  mm_set_trace_hook(alloc, log_hook, &log);
+
+  void* a = (mm_malloc)(alloc, 100);
+  void* b = (mm_memalign)(alloc, 128, 40);
+  void* c = (mm_realloc)(alloc, a, 300);
+  void* big = (mm_malloc)(alloc, sizeof(backing));
+  (mm_free)(alloc, b);
+  (mm_free)(alloc, NULL);
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+  ASSERT_NOT_NULL(c);
+  ASSERT_NULL(big);
+
+  ASSERT_EQ(log.count, 5);
+  ASSERT_EQ(log.events[0].op, MM_OP_MALLOC);
+  ASSERT_EQ(log.events[0].result, a);
+  ASSERT_EQ(log.events[0].size, 100);
+  ASSERT_EQ(log.events[1].op, MM_OP_MEMALIGN);
+  ASSERT_EQ(log.events[1].result, b);
+  ASSERT_EQ(log.events[1].align, 128);
+  ASSERT_EQ(log.events[2].op, MM_OP_REALLOC);
+  ASSERT_EQ(log.events[2].ptr, a);
+  ASSERT_EQ(log.events[2].result, c);
+  ASSERT_EQ(log.events[2].size, 300);
+  ASSERT_EQ(log.events[3].op, MM_OP_MALLOC);
+  ASSERT_NULL(log.events[3].result);
+  ASSERT_EQ(log.events[4].op, MM_OP_FREE);
+  ASSERT_EQ(log.events[4].ptr, b);
+
+  /* Removing the hook stops reporting. */
+  mm_set_trace_hook(alloc, NULL, NULL);
+  (mm_free)(alloc, c);
+  ASSERT_EQ(log.count, 5);
+
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_batch_and_tcache_report_blocks(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  static uint8_t cache_mem[16 * 1024] __attribute__((aligned(16)));
+  static event_log_t log;
+  memset(&log, 0, sizeof(log));
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  mm_set_trace_hook(alloc, log_hook, &log);
+
+  void* ptrs[8];
+  ASSERT_EQ(mm_malloc_batch(alloc, 64, 8, ptrs), 8);
+  ASSERT_EQ(log.count, 8);
+  mm_free_batch(alloc, ptrs, 8);
+  ASSERT_EQ(log.count, 16);
+  for (size_t i = 8; i < 16; i++) ASSERT_EQ(log.events[i].op, MM_OP_FREE);
+
+  /* A cache miss refills several blocks at once; the hit that follows never reaches the heap. */
+  ASSERT_LE(mm_tcache_size(), sizeof(cache_mem));
+  mm_tcache_t cache = mm_tcache_create(cache_mem, alloc);
+  ASSERT_NOT_NULL(cache);
+  void* x = mm_tcache_malloc(cache, 32);
+  ASSERT_NOT_NULL(x);
+  size_t after_refill = log.count;
+  ASSERT_GT(after_refill, 16);
+  void* y = mm_tcache_malloc(cache, 32);
+  ASSERT_NOT_NULL(y);
+  ASSERT_EQ(log.count, after_refill);
+
+  mm_tcache_free(cache, x);
+  mm_tcache_free(cache, y);
+  mm_tcache_destroy(cache);
+  /* Every block the refill took is released again by the flush. */
+  size_t mallocs = 0;
+  size_t frees = 0;
+  for (size_t i = 16; i < log.count; i++) {
+    if (log.events[i].op == MM_OP_MALLOC) mallocs++;
+    if (log.events[i].op == MM_OP_FREE) frees++;
+  }
+  ASSERT_EQ(mallocs, frees);
+  ASSERT_EQ(log.dropped, 0);
+
+  mm_stats_t st;
+  mm_get_stats(alloc, &st);
+  ASSERT_EQ(st.bytes_in_use, 0);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_trace_file_round_trip(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  char path[] = "/tmp/mm_trace_testXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  tlsf_t alloc = mm_create_with_pool(backing, sizeof(backing));
+  ASSERT_NOT_NULL(alloc);
+  mm_trace_writer_t* writer = mm_trace_writer_open(path);
+  ASSERT_NOT_NULL(writer);
+  mm_set_trace_hook(alloc, mm_trace_writer_hook, writer);
+
+  void* a = (mm_malloc)(alloc, 64);             /* id 1 */
+  void* b = (mm_realloc)(alloc, NULL, 32);      /* malloc, id 2 */
+  void* c = (mm_memalign)(alloc, 256, 16);      /* id 3 */
+  a = (mm_realloc)(alloc, a, 2048);             /* keeps id 1 */
+  ASSERT_NULL((mm_realloc)(alloc, b, 1 << 20)); /* failed, id 2 still live */
+  ASSERT_NULL((mm_realloc)(alloc, b, 0));       /* free of id 2 */
+  (mm_free)(alloc, c);
+  (mm_free)(alloc, a);
+
+  mm_set_trace_hook(alloc, NULL, NULL);
+  ASSERT_EQ(mm_trace_writer_close(writer), 1);
+  (mm_destroy)(alloc);
+
+  mm_trace_t trace;
+  ASSERT_EQ(mm_trace_load(path, &trace), 1);
+  unlink(path);
+  ASSERT_EQ(trace.count, 8);
+  ASSERT_EQ(trace.id_count, 4);
+
+  const mm_trace_record_t* r = trace.records;
+  ASSERT_EQ(r[0].op, MM_OP_MALLOC);
+  ASSERT_EQ(r[0].id, 1);
+  ASSERT_EQ(r[0].size, 64);
+  ASSERT_EQ(r[1].op, MM_OP_MALLOC);
+  ASSERT_EQ(r[1].id, 2);
+  ASSERT_EQ(r[2].op, MM_OP_MEMALIGN);
+  ASSERT_EQ(r[2].id, 3);
+  ASSERT_EQ(r[2].align, 256);
+  ASSERT_EQ(r[3].op, MM_OP_REALLOC);
+  ASSERT_EQ(r[3].src_id, 1);
+  ASSERT_EQ(r[3].id, 1);
+  ASSERT_EQ(r[3].failed, 0);
+  ASSERT_EQ(r[4].op, MM_OP_REALLOC);
+  ASSERT_EQ(r[4].src_id, 2);
+  ASSERT_EQ(r[4].failed, 1);
+  ASSERT_EQ(r[5].op, MM_OP_FREE);
+  ASSERT_EQ(r[5].id, 2);
+  ASSERT_EQ(r[6].op, MM_OP_FREE);
+  ASSERT_EQ(r[6].id, 3);
+  ASSERT_EQ(r[7].op, MM_OP_FREE);
+  ASSERT_EQ(r[7].id, 1);
+  for (size_t i = 1; i < trace.count; i++) ASSERT_GE(r[i].time_ns, r[i - 1].time_ns);
+
+  mm_trace_unload(&trace);
+  ASSERT_NULL(trace.records);
+  return 1;
+}
+
+static int test_load_rejects_foreign_files(void) {
+  char path[] = "/tmp/mm_trace_badXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "not a trace file at all, sorry", 30), 30);
+  close(fd);
+
+  mm_trace_t trace;
+  ASSERT_EQ(mm_trace_load(path, &trace), 0);
+  ASSERT_EQ(mm_trace_load("/nonexistent/dir/trace", &trace), 0);
+  unlink(path);
+  return 1;
+}
+
+#define TRACE_THREADS 4
+#define TRACE_OPS 2000
+
+static void count_hook(void* user, const mm_trace_event_t* event) {
+  (void)event;
+  /* Called under the instance lock, so a plain increment is safe. */
+  (*(size_t*)user)++;
+}
+
+static void* trace_worker(void* arg) {
+  tlsf_t alloc = (tlsf_t)arg;
+  for (int i = 0; i < TRACE_OPS; i++) (mm_free)(alloc, (mm_malloc)(alloc, 16 + (size_t)(i % 32) * 8));
+  return NULL;
+}
+
+static int test_hook_serialized_on_thread_safe_instance(void) {
+  static uint8_t backing[512 * 1024] __attribute__((aligned(16)));
+  static size_t events = 0;
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_THREAD_SAFE);
+  ASSERT_NOT_NULL(alloc);
+  mm_set_trace_hook(alloc, count_hook, &events);
+
+  pthread_t threads[TRACE_THREADS];
+  for (int i = 0; i < TRACE_THREADS; i++) ASSERT_EQ(pthread_create(&threads[i], NULL, trace_worker, alloc), 0);
+  for (int i = 0; i < TRACE_THREADS; i++) pthread_join(threads[i], NULL);
+
+  ASSERT_EQ(events, (size_t)TRACE_THREADS * TRACE_OPS * 2);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Trace hook");
+  RUN_TEST(test_hook_sees_each_operation);
+  RUN_TEST(test_batch_and_tcache_report_blocks);
+  RUN_TEST(test_trace_file_round_trip);
+  RUN_TEST(test_load_rejects_foreign_files);
+  RUN_TEST(test_hook_serialized_on_thread_safe_instance);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
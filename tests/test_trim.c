@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define TRIM_POOL_BYTES (16 * 1024 * 1024)
+
+/* Current resident set in KiB (ru_maxrss is a high-water mark and never drops). Returns -1 if unavailable. */
+static long current_rss_kb(void) {
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (!f) return -1;
+  long total = 0, resident = 0;
+  int n = fscanf(f, "%ld %ld", &total, &resident);
+  fclose(f);
+  if (n != 2) return -1;
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void* map_pool(size_t bytes) {
+  void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+static int test_trim_drops_rss_after_spike(void) {
+  void* mem = map_pool(TRIM_POOL_BYTES);
+  ASSERT_NOT_NULL(mem);
+  tlsf_t alloc = mm_create_with_pool(mem, TRIM_POOL_BYTES);
+  ASSERT_NOT_NULL(alloc);
+
+  /* Load spike: touch 12 MiB, then free it all. */
+  enum { N = 12 };
+  void* ptrs[N];
+  for (int i = 0; i < N; i++) {
+    ptrs[i] = (mm_malloc)(alloc, 1024 * 1024);
+    ASSERT_NOT_NULL(ptrs[i]);
+    memset(ptrs[i], 0x5A, 1024 * 1024);
+  }
+  void* keep = (mm_malloc)(alloc, 64);
+  ASSERT_NOT_NULL(keep);
+  for (int i = 0; i < N; i++) (mm_free)(alloc, ptrs[i]);
+
+  long rss_before = current_rss_kb();
+  size_t released = mm_trim(alloc, 0);
+  long rss_after = current_rss_kb();
+  printf("  trimmed %zu KB, RSS %ld KB -> %ld KB\n", released / 1024, rss_before, rss_after);
+
+  ASSERT_GE(released, (size_t)N * 1024 * 1024 - 64 * 1024);
+  if (rss_before >= 0 && rss_after >= 0) ASSERT_GE(rss_before - rss_after, 8 * 1024);
+
+  /* Headers, links and footers survived: the heap is intact and reusable. */
+  ASSERT((mm_validate)(alloc));
+  unsigned char* p = (mm_malloc)(alloc, 8 * 1024 * 1024);
+  ASSERT_NOT_NULL(p);
+  memset(p, 0x11, 8 * 1024 * 1024);
+  ASSERT_EQ(p[4 * 1024 * 1024], 0x11);
+  (mm_free)(alloc, p);
+  (mm_free)(alloc, keep);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ((mm_reset)(alloc), 1);
+
+  (mm_destroy)(alloc);
+  munmap(mem, TRIM_POOL_BYTES);
+  return 1;
+}
+
+static int test_trim_respects_keep_bytes(void) {
+  void* mem = map_pool(TRIM_POOL_BYTES);
+  ASSERT_NOT_NULL(mem);
+  tlsf_t alloc = mm_create_with_pool(mem, TRIM_POOL_BYTES);
+  ASSERT_NOT_NULL(alloc);
+
+  /* Free blocks of 64 KiB and ~4 MiB separated by live blocks. */
+  void* small = (mm_malloc)(alloc, 64 * 1024);
+  void* sep1 = (mm_malloc)(alloc, 64);
+  void* large = (mm_malloc)(alloc, 4 * 1024 * 1024);
+  void* sep2 = (mm_malloc)(alloc, 64);
+  ASSERT_NOT_NULL(sep2);
+  (mm_free)(alloc, small);
+  (mm_free)(alloc, large);
+
+  /* Everything free is kept: nothing advised. */
+  ASSERT_EQ(mm_trim(alloc, TRIM_POOL_BYTES), 0);
+
+  /* Keeping 64 KiB keeps the smallest block and trims the larger ones. */
+  size_t all = mm_trim(alloc, 0);
+  size_t partial = mm_trim(alloc, 64 * 1024);
+  ASSERT_GT(partial, 0);
+  ASSERT_LT(partial, all);
+  ASSERT_GE(all - partial, 48 * 1024);
+
+  /* Blocks too small to span a page are left alone. */
+  void* tiny = (mm_malloc)(alloc, 200);
+  void* sep3 = (mm_malloc)(alloc, 64);
+  ASSERT_NOT_NULL(sep3);
+  (mm_free)(alloc, tiny);
+  ASSERT((mm_validate)(alloc));
+
+  (mm_free)(alloc, sep1);
+  (mm_free)(alloc, sep2);
+  (mm_free)(alloc, sep3);
+  ASSERT_EQ((mm_reset)(alloc), 1);
+  ASSERT_EQ(mm_trim(NULL, 0), 0);
+  (mm_destroy)(alloc);
+  munmap(mem, TRIM_POOL_BYTES);
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Trimming");
+  RUN_TEST(test_trim_drops_rss_after_spike);
+  RUN_TEST(test_trim_respects_keep_bytes);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
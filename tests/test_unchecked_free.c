@@ -0,0 +1,131 @@
+#include "test_framework.h"
+#include "../src/memoman.h"
+#include <stdint.h>
+
+static int test_unchecked_free_coalesces_both_sides(void) {
+  uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_UNCHECKED_FREE);
+  ASSERT_NOT_NULL(alloc);
+
+  mm_stats_t before;
+  mm_get_stats(alloc, &before);
+
+  void* a = (mm_malloc)(alloc, 128);
+  void* b = (mm_malloc)(alloc, 256);
+  void* c = (mm_malloc)(alloc, 512);
+  void* d = (mm_malloc)(alloc, 64);
+  ASSERT_NOT_NULL(a);
+  ASSERT_NOT_NULL(b);
+  ASSERT_NOT_NULL(c);
+  ASSERT_NOT_NULL(d);
+
+  /* Free the outer neighbours first so freeing `b` merges prev and next in one call. */
+  (mm_free)(alloc, a);
+  (mm_free)(alloc, c);
+  ASSERT((mm_validate)(alloc));
+  (mm_free)(alloc, b);
+  ASSERT((mm_validate)(alloc));
+  (mm_free)(alloc, d);
+  ASSERT((mm_validate)(alloc));
+
+  mm_stats_t after;
+  mm_get_stats(alloc, &after);
+  ASSERT_EQ(after.bytes_in_use, 0);
+  ASSERT_EQ(after.largest_free_block, before.largest_free_block);
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_unchecked_free_random_churn(void) {
+  static uint8_t backing[512 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_UNCHECKED_FREE);
+  ASSERT_NOT_NULL(alloc);
+
+  void* live[256] = {0};
+  uint32_t seed = 12345u;
+  for (int i = 0; i < 20000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int slot = (int)((seed >> 16) % 256);
+    (mm_free)(alloc, live[slot]);
+    live[slot] = (mm_malloc)(alloc, 1 + (seed >> 4) % 1500);
+    if (live[slot]) memset(live[slot], slot, 1);
+    if ((i & 1023) == 0) ASSERT((mm_validate)(alloc));
+  }
+  for (int i = 0; i < 256; i++) (mm_free)(alloc, live[i]);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_unchecked_free_tracks_pool_liveness(void) {
+  static uint8_t backing[64 * 1024] __attribute__((aligned(16)));
+  static uint8_t extra[32 * 1024] __attribute__((aligned(16)));
+  ASSERT_LE(mm_size() + 4096, sizeof(backing));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, mm_size() + 4096, MM_FLAG_UNCHECKED_FREE);
+  ASSERT_NOT_NULL(alloc);
+  pool_t pool = mm_add_pool(alloc, extra, sizeof(extra));
+  ASSERT_NOT_NULL(pool);
+
+  /* Too large for the first pool (~4KB of heap), so it comes from `extra`. */
+  void* big = (mm_malloc)(alloc, 16 * 1024);
+  void* small = (mm_malloc)(alloc, 64);
+  ASSERT_NOT_NULL(big);
+  ASSERT_NOT_NULL(small);
+  ASSERT_EQ(mm_get_pool_for_ptr(alloc, big), pool);
+  ASSERT_EQ(mm_pool_is_empty(alloc, pool), 0);
+
+  (mm_free)(alloc, big);
+  ASSERT_EQ(mm_pool_is_empty(alloc, pool), 1);
+  mm_remove_pool(alloc, pool);
+
+  (mm_free)(alloc, small);
+  ASSERT((mm_validate)(alloc));
+  ASSERT_EQ(mm_reset(alloc), 1);
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_unchecked_free_with_slab_and_realloc(void) {
+  static uint8_t backing[256 * 1024] __attribute__((aligned(16)));
+  tlsf_t alloc = mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_UNCHECKED_FREE | MM_FLAG_SLAB);
+  ASSERT_NOT_NULL(alloc);
+
+  void* s = (mm_malloc)(alloc, 32);
+  void* t = (mm_malloc)(alloc, 4096);
+  ASSERT_NOT_NULL(s);
+  ASSERT_NOT_NULL(t);
+  memset(t, 0x3C, 4096);
+
+  /* Moving realloc frees the old block through the unchecked path. */
+  void* blocker = (mm_malloc)(alloc, 4096);
+  ASSERT_NOT_NULL(blocker);
+  void* grown = (mm_realloc)(alloc, t, 16384);
+  ASSERT_NOT_NULL(grown);
+  ASSERT_EQ(((unsigned char*)grown)[4095], 0x3C);
+
+  (mm_free)(alloc, s);
+  (mm_free)(alloc, blocker);
+  (mm_free)(alloc, grown);
+  ASSERT((mm_validate)(alloc));
+  (mm_destroy)(alloc);
+  return 1;
+}
+
+static int test_unknown_flags_still_rejected(void) {
+  uint8_t backing[32 * 1024] __attribute__((aligned(16)));
+  ASSERT_NULL(mm_create_with_pool_ex(backing, sizeof(backing), MM_FLAG_MASK + 1u));
+  return 1;
+}
+
+int main(void) {
+  TEST_SUITE_BEGIN("Unchecked free");
+  RUN_TEST(test_unchecked_free_coalesces_both_sides);
+  RUN_TEST(test_unchecked_free_random_churn);
+  RUN_TEST(test_unchecked_free_tracks_pool_liveness);
+  RUN_TEST(test_unchecked_free_with_slab_and_realloc);
+  RUN_TEST(test_unknown_flags_still_rejected);
+  TEST_SUITE_END();
+  TEST_MAIN_END();
+}
@@ -21,7 +21,7 @@ static int test_detects_fl_sl_bitmap_mismatch(void) {
 
   /* Force an inconsistent bitmap state. */
   ctrl->sl_bitmap[0] |= 1u;
-  ctrl->fl_bitmap &= ~(1u << 0);
+  ctrl->fl_bitmap &= ~MM_BIT(0);
   ASSERT(!(mm_validate)(alloc));
   return 1;
 }
@@ -82,12 +82,12 @@ static int test_corrupt_free_list() {
   mm_get_mapping_indices(64, &fl, &sl);
 
   struct mm_allocator_t* ctrl = (struct mm_allocator_t*)sys_allocator;
-  ctrl->sl_bitmap[fl] &= ~(1U << sl);
+  ctrl->sl_bitmap[fl] &= ~MM_BIT(sl);
   
   int result = mm_validate();
 
   /* Restore bit */
-  ctrl->sl_bitmap[fl] |= (1u << sl);
+  ctrl->sl_bitmap[fl] |= MM_BIT(sl);
 
   ASSERT(result == 0);
 